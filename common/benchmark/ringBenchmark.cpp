@@ -0,0 +1,287 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Throughput and latency benchmark of the SPSC and MPMC rings.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "ring/mpmcRing.hpp"
+#include "ring/spscRing.hpp"
+
+#include <algorithm>
+#include <argparse/argparse.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::chrono::milliseconds WAIT_TIMEOUT {100};
+
+struct BenchmarkConfig {
+	uint64_t operations;
+	size_t capacity;
+	size_t batchSize;
+	size_t producers;
+	size_t consumers;
+};
+
+void printThroughput(const std::string& name, uint64_t operations, Clock::duration duration)
+{
+	const double seconds = std::chrono::duration<double>(duration).count();
+	std::cout << std::left << std::setw(32) << name << std::right << std::setw(10) << std::fixed
+			  << std::setprecision(2) << static_cast<double>(operations) / seconds / 1e6
+			  << " M/s\n";
+}
+
+/**
+ * @brief Pushes the elements 1..operations by the producers and pops them by the consumers.
+ *
+ * The push and pop operations are given as callables taking the ring and a batch buffer, so the
+ * same driver measures the single element, batch, spinning and blocking variants. The sum of the
+ * popped elements is checked to catch lost or duplicated elements.
+ */
+template <typename Ring, typename Push, typename Pop>
+void runThroughput(
+	const std::string& name,
+	const BenchmarkConfig& config,
+	size_t producers,
+	size_t consumers,
+	Push push,
+	Pop pop)
+{
+	Ring ring(config.capacity);
+	const uint64_t perProducer = config.operations / producers;
+	const uint64_t operations = perProducer * producers;
+	std::atomic<uint64_t> popped {0};
+	std::atomic<uint64_t> sum {0};
+	// blocking consumers may sleep for the wait timeout after the last element, so the test
+	// ends when the last element is popped rather than when the threads finish
+	std::atomic<Clock::rep> endTime {0};
+
+	const auto start = Clock::now();
+	std::vector<std::thread> threads;
+	for (size_t producer = 0; producer < producers; producer++) {
+		threads.emplace_back([&, producer]() {
+			std::vector<uint64_t> batch(config.batchSize);
+			uint64_t next = producer * perProducer + 1;
+			const uint64_t end = next + perProducer;
+			while (next < end) {
+				const size_t count = std::min<uint64_t>(config.batchSize, end - next);
+				for (size_t index = 0; index < count; index++) {
+					batch[index] = next + index;
+				}
+				size_t pushed = 0;
+				while (pushed < count) {
+					pushed += push(ring, batch.data() + pushed, count - pushed);
+				}
+				next += count;
+			}
+		});
+	}
+	for (size_t consumer = 0; consumer < consumers; consumer++) {
+		threads.emplace_back([&]() {
+			std::vector<uint64_t> batch(config.batchSize);
+			uint64_t localSum = 0;
+			while (popped.load(std::memory_order_relaxed) < operations) {
+				const size_t count = pop(ring, batch.data(), batch.size());
+				for (size_t index = 0; index < count; index++) {
+					localSum += batch[index];
+				}
+				if (count > 0
+					&& popped.fetch_add(count, std::memory_order_relaxed) + count == operations) {
+					endTime.store(Clock::now().time_since_epoch().count());
+				}
+			}
+			sum.fetch_add(localSum);
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	const auto duration = Clock::time_point(Clock::duration(endTime.load())) - start;
+
+	if (sum.load() != operations * (operations + 1) / 2) {
+		std::cerr << name << ": popped elements do not match the pushed ones\n";
+		std::exit(EXIT_FAILURE);
+	}
+	printThroughput(name, operations, duration);
+}
+
+template <typename Ring>
+size_t pushOne(Ring& ring, const uint64_t* elements, size_t count)
+{
+	(void) count;
+	return ring.tryPush(*elements) ? 1 : 0;
+}
+
+template <typename Ring>
+size_t popOne(Ring& ring, uint64_t* elements, size_t maxCount)
+{
+	(void) maxCount;
+	return ring.tryPop(*elements) ? 1 : 0;
+}
+
+template <typename Ring>
+size_t pushBatch(Ring& ring, const uint64_t* elements, size_t count)
+{
+	return ring.tryPushBatch(elements, count);
+}
+
+template <typename Ring>
+size_t popBatch(Ring& ring, uint64_t* elements, size_t maxCount)
+{
+	return ring.tryPopBatch(elements, maxCount);
+}
+
+template <typename Ring>
+size_t pushWait(Ring& ring, const uint64_t* elements, size_t count)
+{
+	(void) count;
+	return ring.push(*elements, WAIT_TIMEOUT) ? 1 : 0;
+}
+
+template <typename Ring>
+size_t popBatchWait(Ring& ring, uint64_t* elements, size_t maxCount)
+{
+	return ring.popBatch(elements, maxCount, WAIT_TIMEOUT);
+}
+
+/**
+ * @brief Measures the one-way latency as half of the round trip of an element over two rings.
+ */
+template <typename Ring>
+void runLatency(const std::string& name, const BenchmarkConfig& config)
+{
+	Ring request(config.capacity);
+	Ring response(config.capacity);
+	const uint64_t roundTrips = std::max<uint64_t>(config.operations / 100, 1);
+
+	std::thread echo([&]() {
+		uint64_t element = 0;
+		for (uint64_t index = 0; index < roundTrips; index++) {
+			while (!request.tryPop(element)) {
+			}
+			while (!response.tryPush(element)) {
+			}
+		}
+	});
+
+	std::vector<uint64_t> latencies;
+	latencies.reserve(roundTrips);
+	uint64_t element = 0;
+	for (uint64_t index = 0; index < roundTrips; index++) {
+		const auto start = Clock::now();
+		while (!request.tryPush(index)) {
+		}
+		while (!response.tryPop(element)) {
+		}
+		latencies.push_back(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()
+			/ 2);
+	}
+	echo.join();
+
+	std::sort(latencies.begin(), latencies.end());
+	std::cout << std::left << std::setw(32) << name << std::right << std::setw(10)
+			  << latencies[latencies.size() / 2] << " ns p50" << std::setw(10)
+			  << latencies[latencies.size() * 99 / 100] << " ns p99\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	argparse::ArgumentParser program("ring-benchmark");
+
+	program.add_argument("-n", "--operations")
+		.help("Number of elements passed through the ring in every throughput test.")
+		.default_value(uint64_t(10'000'000))
+		.scan<'u', uint64_t>();
+	program.add_argument("-c", "--capacity")
+		.help("Capacity of the rings, a power of two.")
+		.default_value(size_t(4096))
+		.scan<'u', size_t>();
+	program.add_argument("-b", "--batch")
+		.help("Number of elements of a batch operation.")
+		.default_value(size_t(32))
+		.scan<'u', size_t>();
+	program.add_argument("-p", "--producers")
+		.help("Number of producer threads of the MPMC tests.")
+		.default_value(size_t(2))
+		.scan<'u', size_t>();
+	program.add_argument("-C", "--consumers")
+		.help("Number of consumer threads of the MPMC tests.")
+		.default_value(size_t(2))
+		.scan<'u', size_t>();
+
+	BenchmarkConfig config {};
+	try {
+		program.parse_args(argc, argv);
+		config.operations = program.get<uint64_t>("--operations");
+		config.capacity = program.get<size_t>("--capacity");
+		config.batchSize = std::max<size_t>(program.get<size_t>("--batch"), 1);
+		config.producers = std::max<size_t>(program.get<size_t>("--producers"), 1);
+		config.consumers = std::max<size_t>(program.get<size_t>("--consumers"), 1);
+	} catch (const std::exception& ex) {
+		std::cerr << ex.what() << "\n" << program;
+		return EXIT_FAILURE;
+	}
+
+	using Spsc = Nm::SpscRing<uint64_t>;
+	using BlockingSpsc = Nm::SpscRing<uint64_t, true>;
+	using Mpmc = Nm::MpmcRing<uint64_t>;
+	using BlockingMpmc = Nm::MpmcRing<uint64_t, true>;
+
+	try {
+		runThroughput<Spsc>("spsc", config, 1, 1, pushOne<Spsc>, popOne<Spsc>);
+		runThroughput<Spsc>("spsc batch", config, 1, 1, pushBatch<Spsc>, popBatch<Spsc>);
+		runThroughput<BlockingSpsc>(
+			"spsc blocking batch",
+			config,
+			1,
+			1,
+			pushBatch<BlockingSpsc>,
+			popBatchWait<BlockingSpsc>);
+		runThroughput<Mpmc>("mpmc 1:1", config, 1, 1, pushOne<Mpmc>, popOne<Mpmc>);
+		runThroughput<Mpmc>(
+			"mpmc " + std::to_string(config.producers) + ":" + std::to_string(config.consumers),
+			config,
+			config.producers,
+			config.consumers,
+			pushOne<Mpmc>,
+			popOne<Mpmc>);
+		runThroughput<Mpmc>(
+			"mpmc batch " + std::to_string(config.producers) + ":"
+				+ std::to_string(config.consumers),
+			config,
+			config.producers,
+			config.consumers,
+			pushBatch<Mpmc>,
+			popBatch<Mpmc>);
+		runThroughput<BlockingMpmc>(
+			"mpmc blocking " + std::to_string(config.producers) + ":"
+				+ std::to_string(config.consumers),
+			config,
+			config.producers,
+			config.consumers,
+			pushWait<BlockingMpmc>,
+			popBatchWait<BlockingMpmc>);
+		runLatency<Spsc>("spsc latency", config);
+		runLatency<Mpmc>("mpmc latency", config);
+	} catch (const std::exception& ex) {
+		std::cerr << ex.what() << "\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Counters written by one thread and read consistently by others.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace Nm {
+
+/**
+ * @brief Block of counters updated by a single thread and read by any thread.
+ *
+ * The owning thread updates its private copy of the counters by plain writes and publishes it
+ * from time to time, e.g. every few hundred records and whenever the input is idle. Readers,
+ * typically telemetry callbacks running on the appFs thread, take a snapshot of the published
+ * copy under a sequence lock, so all counters of a snapshot come from the same publication and
+ * readers never block the owner.
+ *
+ * Only publish() touches shared memory, so the per-record path has no atomic operations or
+ * fences.
+ *
+ * @tparam Counters Trivially copyable structure of the counters.
+ */
+template <typename Counters>
+class CounterBlock {
+	static_assert(std::is_trivially_copyable_v<Counters>, "Counters must be trivially copyable");
+
+public:
+	/**
+	 * @brief Returns the private copy of the counters, must only be used by the owning thread.
+	 */
+	Counters& local() noexcept { return m_local; }
+
+	/**
+	 * @brief Returns the private copy of the counters, must only be used by the owning thread.
+	 */
+	const Counters& local() const noexcept { return m_local; }
+
+	/**
+	 * @brief Publishes the private copy to readers, must only be called by the owning thread.
+	 */
+	void publish() noexcept
+	{
+		std::array<uint64_t, WORDS> words {};
+		std::memcpy(words.data(), &m_local, sizeof(Counters));
+
+		const uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+		// an odd sequence marks a publication in progress
+		m_sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t index = 0; index < WORDS; index++) {
+			m_published[index].store(words[index], std::memory_order_relaxed);
+		}
+		m_sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Returns the last published counters, can be called by any thread.
+	 */
+	Counters snapshot() const noexcept
+	{
+		std::array<uint64_t, WORDS> words {};
+		uint64_t sequence = 0;
+		do {
+			do {
+				sequence = m_sequence.load(std::memory_order_acquire);
+			} while ((sequence & 1) != 0);
+
+			for (size_t index = 0; index < WORDS; index++) {
+				words[index] = m_published[index].load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+		} while (m_sequence.load(std::memory_order_relaxed) != sequence);
+
+		Counters counters;
+		std::memcpy(static_cast<void*>(&counters), words.data(), sizeof(Counters));
+		return counters;
+	}
+
+private:
+	static constexpr size_t WORDS = (sizeof(Counters) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	Counters m_local {};
+	// the published copy is written only by publish(), keep it off the cache line of m_local
+	alignas(64) std::atomic<uint64_t> m_sequence {0};
+	std::array<std::atomic<uint64_t>, WORDS> m_published {};
+};
+
+} // namespace Nm
@@ -0,0 +1,46 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Rate of a monotonic counter between telemetry reads.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace Nm {
+
+/**
+ * @brief Derives the rate of a monotonic counter, e.g. records/s or bytes/s, between reads.
+ *
+ * Every update() returns the increase of the counter per second since the previous update, so
+ * a telemetry file that updates the rate on each read reports the average rate between the
+ * reads. Updates less than 100 ms after the previous one return the previous rate. Updates are
+ * serialized, so the rate can be read from several threads.
+ */
+class CounterRate {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Updates the rate by the current value of the counter.
+	 * @param value Current value of the counter.
+	 * @param now Current time.
+	 * @return Increase of the counter per second since the previous update, zero on the first
+	 * update or if the counter decreased.
+	 */
+	double update(uint64_t value, Clock::time_point now = Clock::now());
+
+private:
+	std::mutex m_mutex;
+	bool m_initialized = false;
+	uint64_t m_lastValue = 0;
+	Clock::time_point m_lastUpdate;
+	double m_lastRate = 0;
+};
+
+} // namespace Nm
@@ -0,0 +1,29 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the parser of plugin parameters.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+
+namespace Nm {
+
+/**
+ * @brief Parses a string of plugin parameters in the form NAME=VALUE,NAME=VALUE,... into a map.
+ *
+ * Spaces around the names and the values are ignored, spaces inside a value are kept, e.g. in
+ * "keyFields=uint32 DST_ASN". The parameters are passed to the plugins created by a
+ * PluginFactory.
+ *
+ * @param params A string containing the parameters.
+ * @return A map of parameter names and values.
+ * @throw std::invalid_argument If the parameters are malformed or a name is repeated.
+ */
+std::map<std::string, std::string> parsePluginParams(const std::string& params);
+
+} // namespace Nm
@@ -0,0 +1,45 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Cheap timestamps for measuring short sections of code.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Nm {
+
+/**
+ * @brief Returns the current value of the time stamp counter.
+ *
+ * On x86 the TSC is read, which takes a few nanoseconds and runs at a constant rate on all
+ * current CPUs. Elsewhere the steady clock in nanoseconds is returned. Differences of the values
+ * are converted to time by getCyclesPerNanosecond().
+ */
+inline uint64_t readCycles() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+									 std::chrono::steady_clock::now().time_since_epoch())
+									 .count());
+#endif
+}
+
+/**
+ * @brief Returns the rate of readCycles(), measured against the steady clock on the first call.
+ *
+ * The first call takes about 20 ms.
+ */
+double getCyclesPerNanosecond();
+
+} // namespace Nm
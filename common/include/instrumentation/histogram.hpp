@@ -0,0 +1,176 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Histogram with logarithmic buckets split linearly.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Nm {
+
+/**
+ * @brief Histogram of 64-bit values written by one thread and read by any thread.
+ *
+ * Every power of two range is split into 16 linear buckets, so a quantile is reported with
+ * a relative error below 1/16 for any magnitude of the values while the histogram has
+ * a fixed size of under 8 KiB and recording a value is a few instructions. Values below 16
+ * have buckets of their own.
+ *
+ * The counts are atomics written by relaxed loads and stores, which are plain moves on common
+ * CPUs, so a reader gets every count untorn but not necessarily all counts of the same moment.
+ */
+class LogLinearHistogram {
+public:
+	static constexpr unsigned SUB_BUCKET_BITS = 4;
+	static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+	static constexpr size_t BUCKETS = SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+	/**
+	 * @brief Returns the bucket of the value.
+	 */
+	static size_t getBucket(uint64_t value) noexcept
+	{
+		if (value < SUB_BUCKETS) {
+			return static_cast<size_t>(value);
+		}
+		const unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(value));
+		const unsigned shift = exponent - SUB_BUCKET_BITS;
+		// value >> shift lies in [SUB_BUCKETS, 2 * SUB_BUCKETS)
+		return shift * SUB_BUCKETS + static_cast<size_t>(value >> shift);
+	}
+
+	/**
+	 * @brief Returns the smallest value of the bucket.
+	 */
+	static uint64_t getLowerBound(size_t bucket) noexcept
+	{
+		if (bucket < SUB_BUCKETS) {
+			return bucket;
+		}
+		const size_t shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+		return uint64_t(SUB_BUCKETS + (bucket - SUB_BUCKETS) % SUB_BUCKETS) << shift;
+	}
+
+	/**
+	 * @brief Returns the largest value of the bucket.
+	 */
+	static uint64_t getUpperBound(size_t bucket) noexcept
+	{
+		return bucket + 1 < BUCKETS ? getLowerBound(bucket + 1) - 1 : UINT64_MAX;
+	}
+
+	/**
+	 * @brief Adds the value, must only be called by the owning thread.
+	 */
+	void record(uint64_t value) noexcept
+	{
+		increment(m_counts[getBucket(value)], 1);
+		increment(m_count, 1);
+		increment(m_sum, value);
+		if (value > m_max.load(std::memory_order_relaxed)) {
+			m_max.store(value, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * @brief Returns the count of the bucket.
+	 */
+	uint64_t getCount(size_t bucket) const noexcept
+	{
+		return m_counts[bucket].load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Returns the number of recorded values.
+	 */
+	uint64_t getCount() const noexcept { return m_count.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Returns the sum of the recorded values.
+	 */
+	uint64_t getSum() const noexcept { return m_sum.load(std::memory_order_relaxed); }
+
+	/**
+	 * @brief Returns the largest recorded value.
+	 */
+	uint64_t getMax() const noexcept { return m_max.load(std::memory_order_relaxed); }
+
+private:
+	static void increment(std::atomic<uint64_t>& counter, uint64_t value) noexcept
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	std::array<std::atomic<uint64_t>, BUCKETS> m_counts {};
+	std::atomic<uint64_t> m_count {0};
+	std::atomic<uint64_t> m_sum {0};
+	std::atomic<uint64_t> m_max {0};
+};
+
+/**
+ * @brief Sum of the histograms of several threads, from which the quantiles are read.
+ */
+class HistogramSummary {
+public:
+	/**
+	 * @brief Adds the counts of the histogram.
+	 */
+	void merge(const LogLinearHistogram& histogram) noexcept
+	{
+		for (size_t bucket = 0; bucket < LogLinearHistogram::BUCKETS; bucket++) {
+			m_counts[bucket] += histogram.getCount(bucket);
+		}
+		m_count += histogram.getCount();
+		m_sum += histogram.getSum();
+		m_max = std::max(m_max, histogram.getMax());
+	}
+
+	/**
+	 * @brief Returns the value below or equal to which the given fraction of the values lies.
+	 *
+	 * The upper bound of the bucket of the quantile is returned, so the quantile is never
+	 * underestimated.
+	 *
+	 * @param fraction Fraction of the values, e.g. 0.99 for the 99th percentile.
+	 */
+	uint64_t getQuantile(double fraction) const noexcept
+	{
+		uint64_t total = 0;
+		for (const uint64_t count : m_counts) {
+			total += count;
+		}
+		if (total == 0) {
+			return 0;
+		}
+
+		const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * total + 0.5));
+		uint64_t seen = 0;
+		for (size_t bucket = 0; bucket < LogLinearHistogram::BUCKETS; bucket++) {
+			seen += m_counts[bucket];
+			if (seen >= rank) {
+				return std::min(LogLinearHistogram::getUpperBound(bucket), m_max);
+			}
+		}
+		return m_max;
+	}
+
+	uint64_t getCount() const noexcept { return m_count; }
+	uint64_t getSum() const noexcept { return m_sum; }
+	uint64_t getMax() const noexcept { return m_max; }
+
+private:
+	std::array<uint64_t, LogLinearHistogram::BUCKETS> m_counts {};
+	uint64_t m_count = 0;
+	uint64_t m_sum = 0;
+	uint64_t m_max = 0;
+};
+
+} // namespace Nm
@@ -0,0 +1,271 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Latency probes, scoped timers and counters of hot paths exported via telemetry.
+ *
+ * The instrumentation is compiled in only if NM_INSTRUMENTATION is defined, i.e. the project is
+ * configured with ENABLE_INSTRUMENTATION. Otherwise all classes are empty and their functions
+ * do nothing, so the instrumented code is the same as the uninstrumented one.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "cycles.hpp"
+#include "histogram.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <telemetry.hpp>
+
+namespace Nm {
+
+#ifdef NM_INSTRUMENTATION
+
+/**
+ * @brief Maximal number of threads with separate data of a probe or a counter.
+ *
+ * Further threads share the data of the first ones and their updates may be lost.
+ */
+constexpr size_t INSTRUMENTATION_MAX_THREADS = 64;
+
+/**
+ * @brief Returns the index of the data of the calling thread in probes and counters.
+ */
+inline size_t getInstrumentationThreadSlot() noexcept
+{
+	static std::atomic<size_t> nextSlot {0};
+	thread_local const size_t slot
+		= nextSlot.fetch_add(1, std::memory_order_relaxed) % INSTRUMENTATION_MAX_THREADS;
+	return slot;
+}
+
+/**
+ * @brief Distribution of the duration of a section of code, e.g. the processing of a record.
+ *
+ * Every thread records into a histogram of its own, allocated on its first record, so recording
+ * costs no synchronization. The telemetry file of the probe merges the histograms of all
+ * threads and reports the p50, p99 and maximal duration and the cycles per record, which is
+ * the total duration divided by the number of records processed in the measured sections.
+ *
+ * A probe registers itself to Instrumentation on construction, so its telemetry file appears
+ * once a telemetry directory is set, no matter whether the probe was created before or after.
+ */
+class LatencyProbe {
+public:
+	/**
+	 * @brief Constructs the probe.
+	 * @param name Name of the telemetry file of the probe.
+	 */
+	explicit LatencyProbe(const char* name);
+	~LatencyProbe();
+
+	LatencyProbe(const LatencyProbe&) = delete;
+	LatencyProbe& operator=(const LatencyProbe&) = delete;
+
+	/**
+	 * @brief Records the duration of a section.
+	 * @param cycles Duration in readCycles() units.
+	 * @param records Number of records processed in the section.
+	 */
+	void record(uint64_t cycles, uint64_t records = 1) noexcept
+	{
+		auto& slot = m_threads[getInstrumentationThreadSlot()];
+		ThreadData* data = slot.load(std::memory_order_acquire);
+		if (data == nullptr && (data = allocateThreadData()) == nullptr) {
+			return;
+		}
+		data->histogram.record(cycles);
+		data->records.store(
+			data->records.load(std::memory_order_relaxed) + records,
+			std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Returns the name of the probe.
+	 */
+	const std::string& getName() const noexcept { return m_name; }
+
+	/**
+	 * @brief Returns the telemetry content of the probe, can be called by any thread.
+	 */
+	telemetry::Content getTelemetry() const;
+
+private:
+	struct ThreadData {
+		LogLinearHistogram histogram;
+		std::atomic<uint64_t> records {0};
+	};
+
+	ThreadData* allocateThreadData() noexcept;
+
+	const std::string m_name;
+	std::array<std::atomic<ThreadData*>, INSTRUMENTATION_MAX_THREADS> m_threads {};
+};
+
+/**
+ * @brief Counter of events, e.g. of records dropped by a stage, summed over all threads.
+ *
+ * The counters are reported together in the `counters` telemetry file.
+ */
+class EventCounter {
+public:
+	/**
+	 * @brief Constructs the counter.
+	 * @param name Name of the counter in the telemetry.
+	 */
+	explicit EventCounter(const char* name);
+	~EventCounter();
+
+	EventCounter(const EventCounter&) = delete;
+	EventCounter& operator=(const EventCounter&) = delete;
+
+	/**
+	 * @brief Adds to the counter of the calling thread.
+	 */
+	void add(uint64_t value = 1) noexcept
+	{
+		auto& counter = m_threads[getInstrumentationThreadSlot()].value;
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Returns the name of the counter.
+	 */
+	const std::string& getName() const noexcept { return m_name; }
+
+	/**
+	 * @brief Returns the sum of the counters of all threads, can be called by any thread.
+	 */
+	uint64_t getValue() const noexcept;
+
+private:
+	// every thread writes to a cache line of its own
+	struct alignas(64) ThreadCounter {
+		std::atomic<uint64_t> value {0};
+	};
+
+	const std::string m_name;
+	std::array<ThreadCounter, INSTRUMENTATION_MAX_THREADS> m_threads {};
+};
+
+/**
+ * @brief Measures the duration of its scope by a LatencyProbe.
+ */
+class ScopedTimer {
+public:
+	/**
+	 * @brief Starts the measurement.
+	 * @param probe Probe the duration is recorded to.
+	 * @param records Number of records processed in the scope.
+	 */
+	explicit ScopedTimer(LatencyProbe& probe, uint64_t records = 1) noexcept
+		: m_probe(&probe)
+		, m_records(records)
+		, m_start(readCycles())
+	{
+	}
+
+	~ScopedTimer() { stop(); }
+
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+	/**
+	 * @brief Sets the number of records processed in the scope, if not known at its start.
+	 */
+	void setRecords(uint64_t records) noexcept { m_records = records; }
+
+	/**
+	 * @brief Discards the measurement, e.g. if the scope only waited for input.
+	 */
+	void cancel() noexcept { m_probe = nullptr; }
+
+	/**
+	 * @brief Records the measurement before the end of the scope.
+	 */
+	void stop() noexcept
+	{
+		if (m_probe != nullptr) {
+			m_probe->record(readCycles() - m_start, m_records);
+			m_probe = nullptr;
+		}
+	}
+
+private:
+	LatencyProbe* m_probe;
+	uint64_t m_records;
+	uint64_t m_start;
+};
+
+/**
+ * @brief Registry publishing all probes and counters of the process via telemetry.
+ */
+class Instrumentation {
+public:
+	/**
+	 * @brief Creates the `instrumentation` directory in the given directory and the telemetry
+	 * files of all existing and future probes and counters in it.
+	 */
+	static void setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory);
+
+	static void add(LatencyProbe& probe);
+	static void remove(LatencyProbe& probe);
+	static void add(EventCounter& counter);
+	static void remove(EventCounter& counter);
+};
+
+#else
+
+class LatencyProbe {
+public:
+	explicit LatencyProbe(const char* name) { (void) name; }
+	void record(uint64_t cycles, uint64_t records = 1) noexcept
+	{
+		(void) cycles;
+		(void) records;
+	}
+};
+
+class EventCounter {
+public:
+	explicit EventCounter(const char* name) { (void) name; }
+	void add(uint64_t value = 1) noexcept { (void) value; }
+};
+
+class ScopedTimer {
+public:
+	explicit ScopedTimer(LatencyProbe& probe, uint64_t records = 1) noexcept
+	{
+		(void) probe;
+		(void) records;
+	}
+	void setRecords(uint64_t records) noexcept { (void) records; }
+	void cancel() noexcept {}
+	void stop() noexcept {}
+};
+
+class Instrumentation {
+public:
+	static void setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory)
+	{
+		(void) directory;
+	}
+};
+
+#endif // NM_INSTRUMENTATION
+
+/// Receiving of a record from the input interface, waiting for an idle input is not included.
+inline LatencyProbe g_receiveProbe("receive");
+/// Processing of a record by the module, including sending it.
+inline LatencyProbe g_processProbe("process");
+/// Sending of a record to an output interface.
+inline LatencyProbe g_sendProbe("send");
+
+} // namespace Nm
@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Event a thread can sleep on until another thread signals a change of shared state.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Nm {
+
+/**
+ * @brief Lets threads sleep in the kernel until a condition on lock-free state becomes true.
+ *
+ * The signalling thread first updates the shared state and then calls notify(). Waiting threads
+ * register themselves before they check the condition, so notify() enters the kernel only when
+ * somebody sleeps and costs a fence and a load otherwise. A notification cannot be lost: either
+ * the waiter sees the updated state, or notify() sees the registered waiter and changes the
+ * futex word before waking it up.
+ */
+class FutexEvent {
+public:
+	/**
+	 * @brief Wakes up all threads waiting for the event.
+	 *
+	 * Must be called after the change of the shared state the waiters check.
+	 */
+	void notify() noexcept
+	{
+		// orders the preceding update of the state before the load of the waiter count, pairs
+		// with the fence in wait()
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_waiters.load(std::memory_order_relaxed) == 0) {
+			return;
+		}
+		m_epoch.fetch_add(1, std::memory_order_release);
+		futex(FUTEX_WAKE_PRIVATE, INT_MAX, nullptr);
+	}
+
+	/**
+	 * @brief Sleeps until the condition holds or the timeout expires.
+	 * @param condition Callable returning true once the awaited state is reached. It is evaluated
+	 * by the waiting thread and may e.g. try to pop an element.
+	 * @param timeout Maximal time to wait.
+	 * @return The last value of the condition.
+	 */
+	template <typename Condition>
+	bool wait(Condition&& condition, std::chrono::nanoseconds timeout)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+		while (true) {
+			m_waiters.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const uint32_t epoch = m_epoch.load(std::memory_order_acquire);
+
+			if (condition()) {
+				m_waiters.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+
+			const auto remaining = deadline - std::chrono::steady_clock::now();
+			if (remaining <= std::chrono::nanoseconds::zero()) {
+				m_waiters.fetch_sub(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(remaining);
+			const timespec relativeTimeout {
+				static_cast<time_t>(seconds.count()),
+				static_cast<long>((remaining - seconds).count()),
+			};
+			// returns immediately if notify() changed the epoch after it was read
+			futexWait(epoch, &relativeTimeout);
+			m_waiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+private:
+	void futexWait(uint32_t epoch, const timespec* timeout) noexcept
+	{
+		futex(FUTEX_WAIT_PRIVATE, epoch, timeout);
+	}
+
+	long futex(int operation, uint32_t value, const timespec* timeout) noexcept
+	{
+		// std::atomic<uint32_t> is lock-free and has the layout of uint32_t
+		return syscall(
+			SYS_futex,
+			reinterpret_cast<uint32_t*>(&m_epoch),
+			operation,
+			value,
+			timeout,
+			nullptr,
+			0);
+	}
+
+	static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+	std::atomic<uint32_t> m_epoch {0};
+	std::atomic<uint32_t> m_waiters {0};
+};
+
+/**
+ * @brief Replaces FutexEvent in structures built without blocking waits, notify() is a no-op.
+ */
+struct NullEvent {
+	void notify() noexcept {}
+};
+
+} // namespace Nm
@@ -0,0 +1,269 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Bounded lock-free multi-producer multi-consumer ring.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "futexEvent.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace Nm {
+
+/**
+ * @brief Bounded lock-free ring for any number of producer and consumer threads.
+ *
+ * Every slot carries a sequence number telling whether it is free for the producer of the
+ * current lap or holds an element for the consumer of the current lap (D. Vyukov's bounded
+ * MPMC queue). Producers and consumers claim slots by a compare-and-swap of the tail and the
+ * head, which live on separate cache lines, and then access their slots without further
+ * synchronization. A batch operation claims consecutive slots with a single compare-and-swap.
+ *
+ * An element claimed by a producer but not yet written blocks the consumers of the later
+ * elements, so the producers should not be preempted between claiming and writing, which holds
+ * unless T has an expensive copy assignment.
+ *
+ * A blocking ring can additionally wait in the kernel for an element or a free slot. Every
+ * successful operation of a blocking ring then costs a full fence to check for sleeping threads
+ * and wakes up all of them, use the batch operations to amortize it.
+ *
+ * @tparam T Type of the elements, must be default constructible and move assignable.
+ * @tparam Blocking Whether push() and pop() waiting for the other side are available.
+ */
+template <typename T, bool Blocking = false>
+class MpmcRing {
+public:
+	/**
+	 * @brief Constructs an empty ring.
+	 * @param capacity Maximal number of elements, must be a power of two.
+	 * @throw std::invalid_argument If the capacity is not a power of two.
+	 */
+	explicit MpmcRing(size_t capacity)
+		: m_mask(capacity - 1)
+		, m_slots(std::make_unique<Slot[]>(capacity))
+	{
+		if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+			throw std::invalid_argument("MpmcRing: capacity must be a power of two");
+		}
+		for (size_t index = 0; index < capacity; index++) {
+			m_slots[index].sequence.store(index, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * @brief Appends the element.
+	 * @return False if the ring is full.
+	 */
+	bool tryPush(const T& element) noexcept(std::is_nothrow_copy_assignable_v<T>)
+	{
+		return tryPushBatch(&element, 1) == 1;
+	}
+
+	/**
+	 * @brief Appends as many of the elements as fit into consecutive slots.
+	 * @param elements Elements to append.
+	 * @param count Number of the elements.
+	 * @return Number of appended elements, the first ones of the array.
+	 */
+	size_t tryPushBatch(const T* elements, size_t count) noexcept(
+		std::is_nothrow_copy_assignable_v<T>)
+	{
+		count = std::min(count, m_mask + 1);
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		while (count > 0) {
+			const intptr_t lag = slotLag(tail, 0);
+			if (lag < 0) {
+				// the slot holds an element of the previous lap
+				return 0;
+			}
+			if (lag > 0) {
+				// another producer has claimed the slot
+				tail = m_tail.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			const size_t available = countReady(tail, count, 0);
+			if (m_tail.compare_exchange_weak(tail, tail + available, std::memory_order_relaxed)) {
+				for (size_t index = 0; index < available; index++) {
+					Slot& claimed = slot(tail + index);
+					claimed.element = elements[index];
+					claimed.sequence.store(tail + index + 1, std::memory_order_release);
+				}
+				m_notEmpty.notify();
+				return available;
+			}
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief Removes the oldest element.
+	 * @return False if the ring is empty.
+	 */
+	bool tryPop(T& element) noexcept(std::is_nothrow_move_assignable_v<T>)
+	{
+		return tryPopBatch(&element, 1) == 1;
+	}
+
+	/**
+	 * @brief Removes up to `maxCount` oldest elements.
+	 * @param elements Array receiving the elements in the order they were pushed.
+	 * @param maxCount Maximal number of removed elements.
+	 * @return Number of removed elements, zero if the ring is empty.
+	 */
+	size_t tryPopBatch(T* elements, size_t maxCount) noexcept(std::is_nothrow_move_assignable_v<T>)
+	{
+		maxCount = std::min(maxCount, m_mask + 1);
+		size_t head = m_head.load(std::memory_order_relaxed);
+		while (maxCount > 0) {
+			const intptr_t lag = slotLag(head, 1);
+			if (lag < 0) {
+				// the slot is free or its element is still being written
+				return 0;
+			}
+			if (lag > 0) {
+				// another consumer has claimed the slot
+				head = m_head.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			const size_t available = countReady(head, maxCount, 1);
+			if (m_head.compare_exchange_weak(head, head + available, std::memory_order_relaxed)) {
+				for (size_t index = 0; index < available; index++) {
+					Slot& claimed = slot(head + index);
+					elements[index] = std::move(claimed.element);
+					claimed.sequence.store(head + index + m_mask + 1, std::memory_order_release);
+				}
+				m_notFull.notify();
+				return available;
+			}
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief Appends the element, waits while the ring is full.
+	 * @param element Element to append.
+	 * @param timeout Maximal time to wait for a free slot.
+	 * @return False if the ring stayed full for the whole timeout.
+	 */
+	bool push(const T& element, std::chrono::nanoseconds timeout)
+	{
+		static_assert(Blocking, "MpmcRing: push() requires a blocking ring");
+		return tryPush(element) || m_notFull.wait([&] { return tryPush(element); }, timeout);
+	}
+
+	/**
+	 * @brief Removes the oldest element, waits while the ring is empty.
+	 * @param element Removed element.
+	 * @param timeout Maximal time to wait for an element.
+	 * @return False if the ring stayed empty for the whole timeout.
+	 */
+	bool pop(T& element, std::chrono::nanoseconds timeout)
+	{
+		static_assert(Blocking, "MpmcRing: pop() requires a blocking ring");
+		return tryPop(element) || m_notEmpty.wait([&] { return tryPop(element); }, timeout);
+	}
+
+	/**
+	 * @brief Removes up to `maxCount` oldest elements, waits while the ring is empty.
+	 * @param elements Array receiving the elements in the order they were pushed.
+	 * @param maxCount Maximal number of removed elements.
+	 * @param timeout Maximal time to wait for an element.
+	 * @return Number of removed elements, zero if the ring stayed empty for the whole timeout.
+	 */
+	size_t popBatch(T* elements, size_t maxCount, std::chrono::nanoseconds timeout)
+	{
+		static_assert(Blocking, "MpmcRing: popBatch() requires a blocking ring");
+		size_t count = tryPopBatch(elements, maxCount);
+		if (count == 0) {
+			m_notEmpty.wait(
+				[&] { return (count = tryPopBatch(elements, maxCount)) > 0; },
+				timeout);
+		}
+		return count;
+	}
+
+	/**
+	 * @brief Returns the maximal number of elements.
+	 */
+	size_t capacity() const noexcept { return m_mask + 1; }
+
+	/**
+	 * @brief Returns the number of queued elements, can be called by any thread.
+	 *
+	 * The value is only approximate while the ring is in use.
+	 */
+	size_t sizeApprox() const noexcept
+	{
+		const size_t head = m_head.load(std::memory_order_acquire);
+		const size_t tail = m_tail.load(std::memory_order_acquire);
+		return tail >= head ? tail - head : 0;
+	}
+
+private:
+	static constexpr size_t CACHE_LINE_SIZE = 64;
+
+	using Event = std::conditional_t<Blocking, FutexEvent, NullEvent>;
+
+	struct Slot {
+		std::atomic<size_t> sequence {0};
+		T element {};
+	};
+
+	Slot& slot(size_t position) noexcept { return m_slots[position & m_mask]; }
+
+	/**
+	 * @brief Compares the sequence of the slot at `position` to the one the caller expects.
+	 *
+	 * Zero if the slot is ready for the caller, negative if the slot is still used by the
+	 * previous lap and positive if another thread has already claimed it. The offset is zero
+	 * for producers and one for consumers.
+	 */
+	intptr_t slotLag(size_t position, size_t offset) noexcept
+	{
+		return static_cast<intptr_t>(
+			slot(position).sequence.load(std::memory_order_acquire) - position - offset);
+	}
+
+	/**
+	 * @brief Counts the consecutive slots from `position` that are ready for the caller.
+	 *
+	 * A slot at position p is ready for a producer if its sequence is p and for a consumer if it
+	 * is p + 1. The first slot is known to be ready. The counted slots stay ready until the tail,
+	 * respectively the head, moves past `position`, so they belong to the caller once its
+	 * compare-and-swap from `position` succeeds.
+	 */
+	size_t countReady(size_t position, size_t maxCount, size_t offset) noexcept
+	{
+		size_t count = 1;
+		while (count < maxCount
+			   && slot(position + count).sequence.load(std::memory_order_acquire)
+				   == position + count + offset) {
+			count++;
+		}
+		return count;
+	}
+
+	const size_t m_mask;
+	const std::unique_ptr<Slot[]> m_slots;
+
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head {0};
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail {0};
+
+	alignas(CACHE_LINE_SIZE) Event m_notEmpty;
+	Event m_notFull;
+};
+
+} // namespace Nm
@@ -0,0 +1,228 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Bounded lock-free single-producer single-consumer ring.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "futexEvent.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace Nm {
+
+/**
+ * @brief Bounded lock-free ring for exactly one producer and one consumer thread.
+ *
+ * The producer and the consumer indices live on separate cache lines and each side caches the
+ * last seen index of the other one, so the shared cache lines are touched only when the cached
+ * value does not suffice. The batch operations move several elements with a single update of
+ * the index, which amortizes the cache line transfer to the other side.
+ *
+ * A blocking ring can additionally wait in the kernel for an element or a free slot, e.g. so
+ * that an idle worker does not spin. Every successful operation of a blocking ring then costs
+ * a full fence to check for sleeping threads, use the batch operations to amortize it.
+ *
+ * @tparam T Type of the elements, must be default constructible and move assignable.
+ * @tparam Blocking Whether push() and pop() waiting for the other side are available.
+ */
+template <typename T, bool Blocking = false>
+class SpscRing {
+public:
+	/**
+	 * @brief Constructs an empty ring.
+	 * @param capacity Maximal number of elements, must be a power of two.
+	 * @throw std::invalid_argument If the capacity is not a power of two.
+	 */
+	explicit SpscRing(size_t capacity)
+		: m_mask(capacity - 1)
+		, m_buffer(std::make_unique<T[]>(capacity))
+	{
+		if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+			throw std::invalid_argument("SpscRing: capacity must be a power of two");
+		}
+	}
+
+	/**
+	 * @brief Appends the element, called only by the producer.
+	 * @return False if the ring is full.
+	 */
+	bool tryPush(const T& element) noexcept(std::is_nothrow_copy_assignable_v<T>)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_cachedHead > m_mask) {
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			if (tail - m_cachedHead > m_mask) {
+				return false;
+			}
+		}
+
+		m_buffer[tail & m_mask] = element;
+		m_tail.store(tail + 1, std::memory_order_release);
+		m_notEmpty.notify();
+		return true;
+	}
+
+	/**
+	 * @brief Appends as many of the elements as fit, called only by the producer.
+	 * @param elements Elements to append.
+	 * @param count Number of the elements.
+	 * @return Number of appended elements, the first ones of the array.
+	 */
+	size_t tryPushBatch(const T* elements, size_t count) noexcept(
+		std::is_nothrow_copy_assignable_v<T>)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (m_mask + 1 - (tail - m_cachedHead) < count) {
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+		}
+		count = std::min(count, m_mask + 1 - (tail - m_cachedHead));
+		if (count == 0) {
+			return 0;
+		}
+
+		for (size_t index = 0; index < count; index++) {
+			m_buffer[(tail + index) & m_mask] = elements[index];
+		}
+		m_tail.store(tail + count, std::memory_order_release);
+		m_notEmpty.notify();
+		return count;
+	}
+
+	/**
+	 * @brief Removes the oldest element, called only by the consumer.
+	 * @return False if the ring is empty.
+	 */
+	bool tryPop(T& element) noexcept(std::is_nothrow_move_assignable_v<T>)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_cachedTail) {
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			if (head == m_cachedTail) {
+				return false;
+			}
+		}
+
+		element = std::move(m_buffer[head & m_mask]);
+		m_head.store(head + 1, std::memory_order_release);
+		m_notFull.notify();
+		return true;
+	}
+
+	/**
+	 * @brief Removes up to `maxCount` oldest elements, called only by the consumer.
+	 * @param elements Array receiving the elements in the order they were pushed.
+	 * @param maxCount Maximal number of removed elements.
+	 * @return Number of removed elements, zero if the ring is empty.
+	 */
+	size_t tryPopBatch(T* elements, size_t maxCount) noexcept(std::is_nothrow_move_assignable_v<T>)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (m_cachedTail - head < maxCount) {
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+		}
+		const size_t count = std::min(maxCount, m_cachedTail - head);
+		if (count == 0) {
+			return 0;
+		}
+
+		for (size_t index = 0; index < count; index++) {
+			elements[index] = std::move(m_buffer[(head + index) & m_mask]);
+		}
+		m_head.store(head + count, std::memory_order_release);
+		m_notFull.notify();
+		return count;
+	}
+
+	/**
+	 * @brief Appends the element, waits while the ring is full, called only by the producer.
+	 * @param element Element to append.
+	 * @param timeout Maximal time to wait for a free slot.
+	 * @return False if the ring stayed full for the whole timeout.
+	 */
+	bool push(const T& element, std::chrono::nanoseconds timeout)
+	{
+		static_assert(Blocking, "SpscRing: push() requires a blocking ring");
+		return tryPush(element) || m_notFull.wait([&] { return tryPush(element); }, timeout);
+	}
+
+	/**
+	 * @brief Removes the oldest element, waits while the ring is empty, called only by the
+	 * consumer.
+	 * @param element Removed element.
+	 * @param timeout Maximal time to wait for an element.
+	 * @return False if the ring stayed empty for the whole timeout.
+	 */
+	bool pop(T& element, std::chrono::nanoseconds timeout)
+	{
+		static_assert(Blocking, "SpscRing: pop() requires a blocking ring");
+		return tryPop(element) || m_notEmpty.wait([&] { return tryPop(element); }, timeout);
+	}
+
+	/**
+	 * @brief Removes up to `maxCount` oldest elements, waits while the ring is empty, called
+	 * only by the consumer.
+	 * @param elements Array receiving the elements in the order they were pushed.
+	 * @param maxCount Maximal number of removed elements.
+	 * @param timeout Maximal time to wait for an element.
+	 * @return Number of removed elements, zero if the ring stayed empty for the whole timeout.
+	 */
+	size_t popBatch(T* elements, size_t maxCount, std::chrono::nanoseconds timeout)
+	{
+		static_assert(Blocking, "SpscRing: popBatch() requires a blocking ring");
+		size_t count = tryPopBatch(elements, maxCount);
+		if (count == 0) {
+			m_notEmpty.wait(
+				[&] { return (count = tryPopBatch(elements, maxCount)) > 0; },
+				timeout);
+		}
+		return count;
+	}
+
+	/**
+	 * @brief Returns the maximal number of elements.
+	 */
+	size_t capacity() const noexcept { return m_mask + 1; }
+
+	/**
+	 * @brief Returns the number of queued elements, can be called by any thread.
+	 *
+	 * The value is only approximate while the ring is in use.
+	 */
+	size_t sizeApprox() const noexcept
+	{
+		const size_t head = m_head.load(std::memory_order_acquire);
+		const size_t tail = m_tail.load(std::memory_order_acquire);
+		return tail >= head ? tail - head : 0;
+	}
+
+private:
+	static constexpr size_t CACHE_LINE_SIZE = 64;
+
+	using Event = std::conditional_t<Blocking, FutexEvent, NullEvent>;
+
+	const size_t m_mask;
+	const std::unique_ptr<T[]> m_buffer;
+
+	// written by the consumer
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head {0};
+	size_t m_cachedTail = 0;
+
+	// written by the producer
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail {0};
+	size_t m_cachedHead = 0;
+
+	alignas(CACHE_LINE_SIZE) Event m_notEmpty;
+	Event m_notFull;
+};
+
+} // namespace Nm
@@ -0,0 +1,85 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the Stage interface of modules chained in a single process.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "factory/pluginFactory.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <telemetry.hpp>
+#include <unirec++/unirec.hpp>
+
+namespace Nm {
+
+/**
+ * @brief Core of a module run as a filter over the records of a chain.
+ *
+ * A stage is created by the PluginFactory<Stage> from its parameters string and registered by
+ * a PluginFactoryRegistrator in the module that implements it. The chain passes every received
+ * record view to its stages in order and sends the very same view when all of them accept it,
+ * so records are neither serialized nor copied between stages. A stage must not keep the view
+ * after processRecord() returns, it is valid only until the next receive.
+ */
+class Stage {
+public:
+	virtual ~Stage() = default;
+
+	/**
+	 * @brief Returns the Unirec template fields required by the stage, e.g. "ipaddr SRC_IP".
+	 *
+	 * The required formats of all stages are merged into the required format of the input.
+	 */
+	virtual std::string getRequiredFormat() const { return {}; }
+
+	/**
+	 * @brief Resolves the fields used by the stage in a new template.
+	 * @param unirecTemplate Template of the received records.
+	 * @throw std::runtime_error If a field needed by the stage is missing.
+	 */
+	virtual void changeTemplate(const ur_template_t* unirecTemplate) { (void) unirecTemplate; }
+
+	/**
+	 * @brief Processes a received record.
+	 * @param unirecRecordView The received record.
+	 * @return True if the record is passed to the next stage, false if it is dropped.
+	 */
+	virtual bool processRecord(const Nemea::UnirecRecordView& unirecRecordView) = 0;
+
+	/**
+	 * @brief Called after every round of receives of the chain.
+	 * @param idle True if the round ended because no record was available within the timeout.
+	 */
+	virtual void endRound(bool idle) { (void) idle; }
+
+	/**
+	 * @brief Sets the telemetry directory of the stage.
+	 * @param directory Directory for the stage telemetry.
+	 */
+	virtual void setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory)
+	{
+		(void) directory;
+	}
+
+protected:
+	/**
+	 * @brief Parses a string of parameters in the form NAME=VALUE,NAME=VALUE,... into a map.
+	 * @param params A string containing the parameters.
+	 * @return A map of parameter names and values.
+	 * @throw std::invalid_argument If the parameters are malformed or a name is repeated.
+	 */
+	static std::map<std::string, std::string> parseParams(const std::string& params);
+};
+
+/**
+ * @brief Factory of the stages registered by the linked modules.
+ */
+using StageFactory = PluginFactory<Stage>;
+
+} // namespace Nm
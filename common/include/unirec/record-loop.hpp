@@ -0,0 +1,102 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Receive loop passing Unirec records to a statically dispatched handler.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "instrumentation/instrumentation.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <unirec++/unirec.hpp>
+
+namespace Nm {
+
+/**
+ * @brief Base of the handlers of processRecords() with no-op optional callbacks.
+ *
+ * A handler has to implement `void processRecord(Nemea::UnirecRecordView&)` and
+ * `void changeTemplate()`, the other callbacks can be overridden by hiding. The callbacks are
+ * resolved statically, without a virtual call per record.
+ */
+struct RecordHandler {
+	/**
+	 * @brief Called after every round of receives.
+	 * @param idle True if the round ended because no record was available within the timeout.
+	 */
+	void endRound(bool idle) { (void) idle; }
+
+	/**
+	 * @brief Called once when the end of the input is received.
+	 */
+	void endOfInput() {}
+};
+
+/**
+ * @brief Default maximal number of records received between two checks of the stop flag.
+ */
+constexpr size_t DEFAULT_ROUND_SIZE = 256;
+
+/**
+ * @brief Receives and processes records one at a time until the end of the input or a stop.
+ *
+ * The records are passed to `handler.processRecord()` one at a time as they are received, they
+ * are neither received nor sent as a batch. A round of up to `roundSize` receives runs between
+ * two checks of the stop flag and `handler.endRound()` is called after every round, which ends
+ * early when the receive times out. A format change ends the round and calls
+ * `handler.changeTemplate()`. The loop does not flush the outputs, TRAP buffers and flushes
+ * them itself.
+ *
+ * A received record is valid only until the next receive, so the handler has to finish or copy
+ * it in processRecord().
+ *
+ * The receive of a record and its processing are measured by g_receiveProbe and g_processProbe
+ * if the instrumentation is enabled.
+ *
+ * @param input Input interface, Nemea::UnirecInputInterface or
+ * Nemea::UnirecBidirectionalInterface.
+ * @param handler Handler of the records, see RecordHandler.
+ * @param stopFlag Flag requesting the loop to stop.
+ * @param roundSize Maximal number of records received between two checks of the stop flag.
+ */
+template <typename InputInterface, typename Handler>
+void processRecords(
+	InputInterface& input,
+	Handler& handler,
+	const std::atomic<bool>& stopFlag,
+	size_t roundSize = DEFAULT_ROUND_SIZE)
+{
+	while (!stopFlag.load(std::memory_order_relaxed)) {
+		try {
+			bool idle = false;
+			for (size_t received = 0; received < roundSize; received++) {
+				ScopedTimer receiveTimer(g_receiveProbe);
+				std::optional<Nemea::UnirecRecordView> unirecRecord = input.receive();
+				if (!unirecRecord) {
+					receiveTimer.cancel();
+					idle = true;
+					break;
+				}
+				receiveTimer.stop();
+
+				const ScopedTimer processTimer(g_processProbe);
+				handler.processRecord(*unirecRecord);
+			}
+			handler.endRound(idle);
+		} catch (const Nemea::FormatChangeException&) {
+			handler.endRound(false);
+			handler.changeTemplate();
+		} catch (const Nemea::EoFException&) {
+			handler.endRound(false);
+			handler.endOfInput();
+			return;
+		}
+	}
+}
+
+} // namespace Nm
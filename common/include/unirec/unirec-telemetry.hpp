@@ -14,16 +14,29 @@
  * missed = XX %
  * @endcode
  *
+ * The overloads taking InterfaceRates also report `recordsPerSecond` and `bytesPerSecond` since
+ * the previous read.
+ *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
 #pragma once
 
+#include "counters/counterRate.hpp"
+
 #include <telemetry.hpp>
 #include <unirec++/unirec.hpp>
 
 namespace Nm {
 
+/**
+ * @brief Rates of an interface derived between telemetry reads.
+ */
+struct InterfaceRates {
+	CounterRate records; ///< Received records per second.
+	CounterRate bytes; ///< Received bytes per second.
+};
+
 /**
  * @brief Retrieves telemetry data for an input Unirec interface.
  *
@@ -44,4 +57,24 @@ telemetry::Content getInterfaceTelemetry(const Nemea::UnirecInputInterface& inte
  */
 telemetry::Content getInterfaceTelemetry(const Nemea::UnirecBidirectionalInterface& interface);
 
+/**
+ * @brief Retrieves telemetry data and rates for an input Unirec interface.
+ *
+ * @param interface The input Unirec interface.
+ * @param rates Rates of the interface updated by the read.
+ * @return telemetry::Content The telemetry data of the interface.
+ */
+telemetry::Content
+getInterfaceTelemetry(const Nemea::UnirecInputInterface& interface, InterfaceRates& rates);
+
+/**
+ * @brief Retrieves telemetry data and rates for a bidirectional Unirec interface.
+ *
+ * @param interface The bidirectional Unirec interface.
+ * @param rates Rates of the interface updated by the read.
+ * @return telemetry::Content The telemetry data of the interface.
+ */
+telemetry::Content
+getInterfaceTelemetry(const Nemea::UnirecBidirectionalInterface& interface, InterfaceRates& rates);
+
 } // namespace Nm
@@ -0,0 +1,43 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the CounterRate class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "counters/counterRate.hpp"
+
+namespace {
+
+constexpr double MIN_INTERVAL = 0.1;
+
+} // namespace
+
+namespace Nm {
+
+double CounterRate::update(uint64_t value, Clock::time_point now)
+{
+	const std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_initialized || value < m_lastValue) {
+		m_initialized = true;
+		m_lastValue = value;
+		m_lastUpdate = now;
+		m_lastRate = 0;
+		return m_lastRate;
+	}
+
+	const double elapsed = std::chrono::duration<double>(now - m_lastUpdate).count();
+	// reads following each other closely report the previous rate instead of noise
+	if (elapsed < MIN_INTERVAL) {
+		return m_lastRate;
+	}
+
+	m_lastRate = static_cast<double>(value - m_lastValue) / elapsed;
+	m_lastValue = value;
+	m_lastUpdate = now;
+	return m_lastRate;
+}
+
+} // namespace Nm
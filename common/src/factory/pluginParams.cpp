@@ -0,0 +1,59 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the parser of plugin parameters.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "factory/pluginParams.hpp"
+
+#include <stdexcept>
+
+namespace {
+
+std::string trim(const std::string& text)
+{
+	const size_t first = text.find_first_not_of(" \t");
+	if (first == std::string::npos) {
+		return {};
+	}
+	const size_t last = text.find_last_not_of(" \t");
+	return text.substr(first, last - first + 1);
+}
+
+} // namespace
+
+namespace Nm {
+
+std::map<std::string, std::string> parsePluginParams(const std::string& params)
+{
+	std::map<std::string, std::string> map;
+	if (trim(params).empty()) {
+		return map;
+	}
+
+	size_t start = 0;
+	size_t end = 0;
+	while (end != std::string::npos) {
+		end = params.find(',', start);
+		const std::string tmp = params.substr(start, end - start);
+
+		const size_t mid = tmp.find('=');
+		const std::string name = trim(tmp.substr(0, mid));
+		const std::string value = mid == std::string::npos ? "" : trim(tmp.substr(mid + 1));
+		if (name.empty() || value.empty()) {
+			throw std::invalid_argument("parsePluginParams() has failed: '" + trim(tmp) + "'");
+		}
+
+		auto ret = map.emplace(name, value);
+		if (!ret.second) {
+			throw std::invalid_argument("parsePluginParams() has failed: '" + trim(tmp) + "'");
+		}
+		start = end + 1;
+	}
+
+	return map;
+}
+
+} // namespace Nm
@@ -0,0 +1,221 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the instrumentation probes, counters and their telemetry.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "instrumentation/instrumentation.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Nm {
+
+double getCyclesPerNanosecond()
+{
+	static const double cyclesPerNanosecond = []() {
+		const auto startTime = std::chrono::steady_clock::now();
+		const uint64_t startCycles = readCycles();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		const uint64_t cycles = readCycles() - startCycles;
+		const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+									 std::chrono::steady_clock::now() - startTime)
+									 .count();
+		return static_cast<double>(cycles) / static_cast<double>(nanoseconds);
+	}();
+	return cyclesPerNanosecond;
+}
+
+#ifdef NM_INSTRUMENTATION
+
+namespace {
+
+struct Registry {
+	std::mutex mutex;
+	std::vector<LatencyProbe*> probes;
+	std::vector<EventCounter*> counters;
+	std::shared_ptr<telemetry::Directory> directory;
+	std::shared_ptr<telemetry::File> countersFile;
+	// the file of a probe is removed together with the probe
+	std::map<const LatencyProbe*, std::shared_ptr<telemetry::File>> probeFiles;
+};
+
+Registry& getRegistry()
+{
+	static Registry registry;
+	return registry;
+}
+
+void addProbeFile(Registry& registry, LatencyProbe& probe)
+{
+	const telemetry::FileOps fileOps = {[&probe]() { return probe.getTelemetry(); }, nullptr};
+	registry.probeFiles[&probe] = registry.directory->addFile(probe.getName(), fileOps);
+}
+
+telemetry::Content getCountersTelemetry()
+{
+	Registry& registry = getRegistry();
+	const std::lock_guard<std::mutex> lock(registry.mutex);
+
+	telemetry::Dict dict;
+	for (const EventCounter* counter : registry.counters) {
+		dict[counter->getName()] = counter->getValue();
+	}
+	return dict;
+}
+
+} // namespace
+
+LatencyProbe::LatencyProbe(const char* name)
+	: m_name(name)
+{
+	Instrumentation::add(*this);
+}
+
+LatencyProbe::~LatencyProbe()
+{
+	Instrumentation::remove(*this);
+	for (auto& data : m_threads) {
+		delete data.load(std::memory_order_relaxed);
+	}
+}
+
+LatencyProbe::ThreadData* LatencyProbe::allocateThreadData() noexcept
+{
+	auto& slot = m_threads[getInstrumentationThreadSlot()];
+	auto* data = new (std::nothrow) ThreadData();
+	if (data == nullptr) {
+		return nullptr;
+	}
+
+	// the slot may be shared by more threads than INSTRUMENTATION_MAX_THREADS
+	ThreadData* expected = nullptr;
+	if (!slot.compare_exchange_strong(expected, data, std::memory_order_acq_rel)) {
+		delete data;
+		return expected;
+	}
+	return data;
+}
+
+telemetry::Content LatencyProbe::getTelemetry() const
+{
+	auto summary = std::make_unique<HistogramSummary>();
+	uint64_t records = 0;
+	for (const auto& slot : m_threads) {
+		const ThreadData* data = slot.load(std::memory_order_acquire);
+		if (data != nullptr) {
+			summary->merge(data->histogram);
+			records += data->records.load(std::memory_order_relaxed);
+		}
+	}
+
+	const double cyclesPerNanosecond = getCyclesPerNanosecond();
+	const auto toNanoseconds = [cyclesPerNanosecond](uint64_t cycles) {
+		return telemetry::ScalarWithUnit {static_cast<double>(cycles) / cyclesPerNanosecond, "ns"};
+	};
+
+	telemetry::Dict dict;
+	dict["samples"] = summary->getCount();
+	dict["records"] = records;
+	dict["p50"] = toNanoseconds(summary->getQuantile(0.5));
+	dict["p99"] = toNanoseconds(summary->getQuantile(0.99));
+	dict["max"] = toNanoseconds(summary->getMax());
+	if (records > 0) {
+		dict["cyclesPerRecord"] = static_cast<double>(summary->getSum()) / records;
+	}
+	return dict;
+}
+
+EventCounter::EventCounter(const char* name)
+	: m_name(name)
+{
+	Instrumentation::add(*this);
+}
+
+EventCounter::~EventCounter()
+{
+	Instrumentation::remove(*this);
+}
+
+uint64_t EventCounter::getValue() const noexcept
+{
+	uint64_t value = 0;
+	for (const auto& counter : m_threads) {
+		value += counter.value.load(std::memory_order_relaxed);
+	}
+	return value;
+}
+
+void Instrumentation::setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory)
+{
+	// calibrate now rather than in the first telemetry read
+	getCyclesPerNanosecond();
+
+	Registry& registry = getRegistry();
+	const std::lock_guard<std::mutex> lock(registry.mutex);
+
+	registry.directory = directory->addDir("instrumentation");
+	for (LatencyProbe* probe : registry.probes) {
+		addProbeFile(registry, *probe);
+	}
+	const telemetry::FileOps countersOps = {getCountersTelemetry, nullptr};
+	registry.countersFile = registry.directory->addFile("counters", countersOps);
+}
+
+void Instrumentation::add(LatencyProbe& probe)
+{
+	Registry& registry = getRegistry();
+	const std::lock_guard<std::mutex> lock(registry.mutex);
+
+	registry.probes.push_back(&probe);
+	if (registry.directory) {
+		addProbeFile(registry, probe);
+	}
+}
+
+void Instrumentation::remove(LatencyProbe& probe)
+{
+	Registry& registry = getRegistry();
+	std::shared_ptr<telemetry::File> probeFile;
+	{
+		const std::lock_guard<std::mutex> lock(registry.mutex);
+
+		auto& probes = registry.probes;
+		probes.erase(std::remove(probes.begin(), probes.end(), &probe), probes.end());
+		auto file = registry.probeFiles.find(&probe);
+		if (file != registry.probeFiles.end()) {
+			probeFile = std::move(file->second);
+			registry.probeFiles.erase(file);
+		}
+	}
+	// the file is released without the registry lock, a telemetry read of the counters may
+	// hold a lock of the telemetry and wait for the registry lock
+	probeFile.reset();
+}
+
+void Instrumentation::add(EventCounter& counter)
+{
+	Registry& registry = getRegistry();
+	const std::lock_guard<std::mutex> lock(registry.mutex);
+
+	registry.counters.push_back(&counter);
+}
+
+void Instrumentation::remove(EventCounter& counter)
+{
+	Registry& registry = getRegistry();
+	const std::lock_guard<std::mutex> lock(registry.mutex);
+
+	auto& counters = registry.counters;
+	counters.erase(std::remove(counters.begin(), counters.end(), &counter), counters.end());
+}
+
+#endif // NM_INSTRUMENTATION
+
+} // namespace Nm
@@ -0,0 +1,20 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the Stage interface.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "stage/stage.hpp"
+
+#include "factory/pluginParams.hpp"
+
+namespace Nm {
+
+std::map<std::string, std::string> Stage::parseParams(const std::string& params)
+{
+	return parsePluginParams(params);
+}
+
+} // namespace Nm
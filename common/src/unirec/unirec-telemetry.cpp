@@ -8,6 +8,8 @@
 
 #include "unirec/unirec-telemetry.hpp"
 
+#include <variant>
+
 namespace Nm {
 
 static double getMissedPercentage(const Nemea::InputInteraceStats& stats)
@@ -33,6 +35,19 @@ static telemetry::Content createInterfaceTelemetry(const Nemea::InputInteraceSta
 	return dict;
 }
 
+static telemetry::Content
+createInterfaceTelemetry(const Nemea::InputInteraceStats& stats, InterfaceRates& rates)
+{
+	const auto now = CounterRate::Clock::now();
+	auto content = createInterfaceTelemetry(stats);
+	auto& dict = std::get<telemetry::Dict>(content);
+	dict["recordsPerSecond"]
+		= telemetry::ScalarWithUnit(rates.records.update(stats.receivedRecords, now), "records/s");
+	dict["bytesPerSecond"]
+		= telemetry::ScalarWithUnit(rates.bytes.update(stats.receivedBytes, now), "B/s");
+	return content;
+}
+
 telemetry::Content getInterfaceTelemetry(const Nemea::UnirecBidirectionalInterface& interface)
 {
 	const auto stats = interface.getInputInterfaceStats();
@@ -45,4 +60,18 @@ telemetry::Content getInterfaceTelemetry(const Nemea::UnirecInputInterface& inte
 	return createInterfaceTelemetry(stats);
 }
 
+telemetry::Content
+getInterfaceTelemetry(const Nemea::UnirecBidirectionalInterface& interface, InterfaceRates& rates)
+{
+	const auto stats = interface.getInputInterfaceStats();
+	return createInterfaceTelemetry(stats, rates);
+}
+
+telemetry::Content
+getInterfaceTelemetry(const Nemea::UnirecInputInterface& interface, InterfaceRates& rates)
+{
+	const auto stats = interface.getInputInterfaceStats();
+	return createInterfaceTelemetry(stats, rates);
+}
+
 } // namespace Nm
@@ -0,0 +1,271 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Chain Module: Run cores of several modules in a single process
+ *
+ * This file contains the main function and supporting functions for the Unirec Chain Module.
+ * The module receives Unirec records through a bidirectional interface and passes them through
+ * a sequence of stages, e.g. a whitelist and a sampler, each of which can drop a record. Records
+ * accepted by all stages are forwarded. The stages share the received record view, so there is
+ * no serialization, copying or context switch between them as between separate modules.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "instrumentation/instrumentation.hpp"
+#include "logger/logger.hpp"
+#include "stage/stage.hpp"
+#include "unirec/record-loop.hpp"
+#include "unirec/unirec-telemetry.hpp"
+
+#include <algorithm>
+#include <appFs.hpp>
+#include <argparse/argparse.hpp>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <telemetry.hpp>
+#include <unirec++/unirec.hpp>
+#include <utility>
+#include <vector>
+
+using namespace Nemea;
+
+std::atomic<bool> g_stopFlag(false);
+
+void signalHandler(int signum)
+{
+	Nm::loggerGet("signalHandler")->info("Interrupt signal {} received", signum);
+	g_stopFlag.store(true);
+}
+
+/**
+ * @brief Handler of the received records passing them through the stages of the chain.
+ *
+ * A record is offered to the stages in order until one of them drops it. Records accepted by
+ * all stages are forwarded through the bidirectional interface. On a format change, the template
+ * of the bidirectional interface is adjusted and the stages resolve their fields.
+ */
+class ChainHandler : public Nm::RecordHandler {
+public:
+	ChainHandler(
+		UnirecBidirectionalInterface& biInterface,
+		std::vector<std::unique_ptr<Nm::Stage>>& stages)
+		: m_biInterface(biInterface)
+		, m_stages(stages)
+	{
+	}
+
+	void processRecord(UnirecRecordView& unirecRecord)
+	{
+		for (const auto& stage : m_stages) {
+			if (!stage->processRecord(unirecRecord)) {
+				return;
+			}
+		}
+		const Nm::ScopedTimer sendTimer(Nm::g_sendProbe);
+		m_biInterface.send(unirecRecord);
+	}
+
+	void changeTemplate()
+	{
+		m_biInterface.changeTemplate();
+		const ur_template_t* unirecTemplate = m_biInterface.getTemplate();
+		for (const auto& stage : m_stages) {
+			stage->changeTemplate(unirecTemplate);
+		}
+	}
+
+	void endRound(bool idle)
+	{
+		for (const auto& stage : m_stages) {
+			stage->endRound(idle);
+		}
+	}
+
+private:
+	UnirecBidirectionalInterface& m_biInterface;
+	std::vector<std::unique_ptr<Nm::Stage>>& m_stages;
+};
+
+/**
+ * @brief Process Unirec records by the stages of the chain.
+ *
+ * The `processUnirecRecords` function continuously receives Unirec records one at a time through
+ * the provided bidirectional interface (`biInterface`) and passes them through the stages. The
+ * loop runs until an end-of-file condition is encountered or the module is interrupted.
+ *
+ * @param biInterface Bidirectional interface for Unirec communication.
+ * @param stages Stages of the chain in the order the records pass them.
+ */
+static void processUnirecRecords(
+	UnirecBidirectionalInterface& biInterface,
+	std::vector<std::unique_ptr<Nm::Stage>>& stages)
+{
+	ChainHandler handler(biInterface, stages);
+	Nm::processRecords(biInterface, handler, g_stopFlag);
+}
+
+std::pair<std::string, std::string> splitStageParams(const std::string& stageParams)
+{
+	const std::size_t position = stageParams.find_first_of(':');
+	if (position == std::string::npos) {
+		return std::make_pair(stageParams, "");
+	}
+
+	return std::make_pair(
+		std::string(stageParams, 0, position),
+		std::string(stageParams, position + 1));
+}
+
+/**
+ * @brief Merges the Unirec fields required by the stages, every field is listed once.
+ * @param stages Stages of the chain.
+ * @return Comma-separated list of the required fields in the form "type NAME".
+ */
+std::string getRequiredFormat(const std::vector<std::unique_ptr<Nm::Stage>>& stages)
+{
+	std::vector<std::string> fields;
+	for (const auto& stage : stages) {
+		std::istringstream stream(stage->getRequiredFormat());
+		std::string field;
+		while (std::getline(stream, field, ',')) {
+			if (!field.empty() && std::find(fields.begin(), fields.end(), field) == fields.end()) {
+				fields.push_back(field);
+			}
+		}
+	}
+
+	std::string requiredFormat;
+	for (const auto& field : fields) {
+		requiredFormat += requiredFormat.empty() ? field : "," + field;
+	}
+	return requiredFormat;
+}
+
+void showStageUsage()
+{
+	auto& stageFactory = Nm::StageFactory::instance();
+
+	std::cout << "\nStages:\n";
+	for (const auto& stage : stageFactory.getRegisteredPlugins()) {
+		stage.pluginUsage();
+		std::cout << "\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	argparse::ArgumentParser program("Chain");
+
+	Nm::loggerInit();
+	auto logger = Nm::loggerGet("main");
+
+	signal(SIGINT, signalHandler);
+
+	try {
+		program.add_argument("-s", "--stage")
+			.required()
+			.help(
+				"Adds a stage given by its name and parameters. Can be repeated, records pass the "
+				"stages in the given order.")
+			.metavar("NAME:PARAM_NAME=PARAM_VALUE,...")
+			.append();
+
+		program.add_argument("-m", "--appfs-mountpoint")
+			.required()
+			.help("path where the appFs directory will be mounted")
+			.default_value(std::string(""));
+	} catch (const std::exception& ex) {
+		logger->error(ex.what());
+		return EXIT_FAILURE;
+	}
+
+	Unirec unirec({1, 1, "Chain", "Unirec chain of module stages"});
+
+	try {
+		unirec.init(argc, argv);
+	} catch (HelpException& ex) {
+		std::cerr << program;
+		showStageUsage();
+		return EXIT_SUCCESS;
+	} catch (std::exception& ex) {
+		logger->error(ex.what());
+		return EXIT_FAILURE;
+	}
+
+	try {
+		program.parse_args(argc, argv);
+	} catch (const std::exception& ex) {
+		logger->error(ex.what());
+		return EXIT_FAILURE;
+	}
+
+	std::shared_ptr<telemetry::Directory> telemetryRootDirectory;
+	telemetryRootDirectory = telemetry::Directory::create();
+
+	std::unique_ptr<telemetry::appFs::AppFsFuse> appFs;
+
+	try {
+		auto mountPoint = program.get<std::string>("--appfs-mountpoint");
+		if (!mountPoint.empty()) {
+			const bool tryToUnmountOnStart = true;
+			const bool createMountPoint = true;
+			appFs = std::make_unique<telemetry::appFs::AppFsFuse>(
+				telemetryRootDirectory,
+				mountPoint,
+				tryToUnmountOnStart,
+				createMountPoint);
+			appFs->start();
+		}
+	} catch (std::exception& ex) {
+		logger->error(ex.what());
+		return EXIT_FAILURE;
+	}
+
+	try {
+		auto& stageFactory = Nm::StageFactory::instance();
+
+		std::vector<std::string> stageNames;
+		std::vector<std::unique_ptr<Nm::Stage>> stages;
+		for (const auto& stageSpecification : program.get<std::vector<std::string>>("--stage")) {
+			const auto& [stageName, stageParams] = splitStageParams(stageSpecification);
+			stages.push_back(stageFactory.createPlugin(stageName, stageParams));
+			stageNames.push_back(stageName);
+		}
+
+		UnirecBidirectionalInterface biInterface = unirec.buildBidirectionalInterface();
+		const std::string requiredFormat = getRequiredFormat(stages);
+		if (!requiredFormat.empty()) {
+			biInterface.setRequieredFormat(requiredFormat);
+		}
+
+		auto telemetryInputDirectory = telemetryRootDirectory->addDir("input");
+		const telemetry::FileOps inputFileOps
+			= {[&biInterface]() { return Nm::getInterfaceTelemetry(biInterface); }, nullptr};
+		const auto inputFile = telemetryInputDirectory->addFile("stats", inputFileOps);
+		Nm::Instrumentation::setTelemetryDirectory(telemetryRootDirectory);
+
+		// stages of the same type are told apart by their position in the chain
+		auto telemetryStagesDirectory = telemetryRootDirectory->addDir("stages");
+		std::vector<std::shared_ptr<telemetry::Directory>> telemetryStageDirectories;
+		for (size_t index = 0; index < stages.size(); index++) {
+			telemetryStageDirectories.push_back(telemetryStagesDirectory->addDir(
+				std::to_string(index) + "-" + stageNames[index]));
+			stages[index]->setTelemetryDirectory(telemetryStageDirectories.back());
+		}
+
+		processUnirecRecords(biInterface, stages);
+
+	} catch (std::exception& ex) {
+		logger->error(ex.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the function defining the Unirec fields used by the sampler.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "fieldDefinition.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <unirec/unirec.h>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const std::unordered_map<std::string, std::string> WELL_KNOWN_TYPES = {
+	{"SRC_IP", "ipaddr"},
+	{"DST_IP", "ipaddr"},
+	{"SRC_PORT", "uint16"},
+	{"DST_PORT", "uint16"},
+	{"PROTOCOL", "uint8"},
+	{"TCP_FLAGS", "uint8"},
+	{"TCP_FLAGS_REV", "uint8"},
+	{"BYTES", "uint64"},
+	{"BYTES_REV", "uint64"},
+	{"PACKETS", "uint32"},
+	{"PACKETS_REV", "uint32"},
+	{"TIME_FIRST", "time"},
+	{"TIME_LAST", "time"},
+	{"LINK_BIT_FIELD", "uint64"},
+	{"DIR_BIT_FIELD", "uint8"},
+};
+
+} // namespace
+
+namespace Sampler {
+
+std::string defineField(std::string& field)
+{
+	// spaces around the type and the name are not significant
+	std::vector<std::string> words;
+	std::istringstream stream(field);
+	for (std::string word; stream >> word;) {
+		words.push_back(word);
+	}
+	if (words.empty() || words.size() > 2) {
+		throw std::invalid_argument("Invalid field '" + field + "', expected 'type NAME' or 'NAME'");
+	}
+	field = words.back();
+
+	std::string definition;
+	if (words.size() == 2) {
+		definition = words.front() + " " + field;
+	} else {
+		const auto it = WELL_KNOWN_TYPES.find(field);
+		if (it == WELL_KNOWN_TYPES.end()) {
+			throw std::invalid_argument(
+				"Type of field '" + field + "' is unknown, give the field as 'type " + field + "'");
+		}
+		definition = it->second + " " + field;
+	}
+
+	if (ur_define_set_fields(definition.c_str()) != UR_OK) {
+		throw std::invalid_argument("Cannot define the field '" + definition + "'");
+	}
+	return definition;
+}
+
+} // namespace Sampler
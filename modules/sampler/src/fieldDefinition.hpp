@@ -0,0 +1,28 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the function defining the Unirec fields used by the sampler.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <string>
+
+namespace Sampler {
+
+/**
+ * @brief Defines a Unirec field given as "type NAME" or by the name of a well-known field.
+ *
+ * The ids of the fields are resolved when the sampler is constructed, but the input template
+ * defines its fields only once it is received. Well-known fields of ipfixprobe, e.g. SRC_IP or
+ * BYTES, may be given without the type.
+ *
+ * @param field Specification of the field, replaced by the name of the field.
+ * @return Definition of the field in the form "type NAME".
+ * @throw std::invalid_argument If the type of the field is unknown or the definition fails.
+ */
+std::string defineField(std::string& field);
+
+} // namespace Sampler
@@ -0,0 +1,203 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the FlowKeyHasher class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "flowKeyHasher.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint64_t PRIME1 = 0x9E3779B97F4A7C15ULL;
+constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t DIRECTIONAL_SEED = 0x165667B19E3779F9ULL;
+
+constexpr const char* SOURCE_PREFIX = "SRC_";
+constexpr const char* DESTINATION_PREFIX = "DST_";
+constexpr size_t PREFIX_LENGTH = 4;
+
+uint64_t rotateLeft(uint64_t value, unsigned bits) noexcept
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t mixWord(uint64_t hash, uint64_t word) noexcept
+{
+	hash ^= word * PRIME2;
+	return rotateLeft(hash, 31) * PRIME1;
+}
+
+uint64_t finalize(uint64_t hash) noexcept
+{
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+bool isSupportedType(ur_field_type_t type) noexcept
+{
+	switch (type) {
+	case UR_TYPE_CHAR:
+	case UR_TYPE_UINT8:
+	case UR_TYPE_INT8:
+	case UR_TYPE_UINT16:
+	case UR_TYPE_INT16:
+	case UR_TYPE_UINT32:
+	case UR_TYPE_INT32:
+	case UR_TYPE_UINT64:
+	case UR_TYPE_INT64:
+	case UR_TYPE_TIME:
+	case UR_TYPE_IP:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool startsWith(const std::string& text, const char* prefix)
+{
+	return text.rfind(prefix, 0) == 0;
+}
+
+} // namespace
+
+namespace Sampler {
+
+FlowKeyHasher::FlowKeyHasher(
+	const std::vector<std::string>& fieldNames,
+	bool normalizeDirection,
+	uint64_t seed)
+	: m_seed(seed)
+{
+	if (fieldNames.empty()) {
+		throw std::invalid_argument("Flow key must contain at least one field");
+	}
+
+	auto resolve = [](const std::string& fieldName) {
+		const int fieldId = ur_get_id_by_name(fieldName.c_str());
+		if (fieldId < 0) {
+			throw std::invalid_argument("Unknown flow key field '" + fieldName + "'");
+		}
+		const auto unirecFieldId = static_cast<ur_field_id_t>(fieldId);
+		const ur_field_type_t type = ur_get_type(unirecFieldId);
+		if (!isSupportedType(type)) {
+			throw std::invalid_argument("Unsupported type of flow key field '" + fieldName + "'");
+		}
+		return KeyField {unirecFieldId, type};
+	};
+
+	auto isListed = [&fieldNames](const std::string& fieldName) {
+		return std::find(fieldNames.begin(), fieldNames.end(), fieldName) != fieldNames.end();
+	};
+
+	for (const auto& fieldName : fieldNames) {
+		if (!normalizeDirection) {
+			m_otherFields.push_back(resolve(fieldName));
+			continue;
+		}
+
+		// prefixes of both directions have the same length
+		const std::string suffix = fieldName.substr(std::min(fieldName.size(), PREFIX_LENGTH));
+		if (startsWith(fieldName, SOURCE_PREFIX) && isListed(DESTINATION_PREFIX + suffix)) {
+			m_sourceFields.push_back(resolve(fieldName));
+			m_destinationFields.push_back(resolve(DESTINATION_PREFIX + suffix));
+		} else if (!(startsWith(fieldName, DESTINATION_PREFIX) && isListed(SOURCE_PREFIX + suffix))) {
+			m_otherFields.push_back(resolve(fieldName));
+		}
+	}
+}
+
+void FlowKeyHasher::changeTemplate(const ur_template_t* unirecTemplate) const
+{
+	for (const auto* fields : {&m_sourceFields, &m_destinationFields, &m_otherFields}) {
+		for (const auto& field : *fields) {
+			if (!ur_is_present(unirecTemplate, field.id)) {
+				throw std::runtime_error(
+					std::string("Flow key field '") + ur_get_name(field.id)
+					+ "' is missing in the input template");
+			}
+		}
+	}
+}
+
+uint64_t FlowKeyHasher::hash(const Nemea::UnirecRecordView& unirecRecordView) const
+{
+	uint64_t hash = m_seed ^ DIRECTIONAL_SEED;
+	if (!m_sourceFields.empty()) {
+		const uint64_t sourceHash = hashFields(m_sourceFields, unirecRecordView, m_seed);
+		const uint64_t destinationHash = hashFields(m_destinationFields, unirecRecordView, m_seed);
+		hash = mixWord(hash, std::min(sourceHash, destinationHash));
+		hash = mixWord(hash, std::max(sourceHash, destinationHash));
+	}
+	return finalize(hashFields(m_otherFields, unirecRecordView, hash));
+}
+
+uint64_t FlowKeyHasher::hashFields(
+	const std::vector<KeyField>& fields,
+	const Nemea::UnirecRecordView& unirecRecordView,
+	uint64_t hash) const
+{
+	for (const auto& field : fields) {
+		switch (field.type) {
+		case UR_TYPE_CHAR:
+			hash = mixWord(
+				hash,
+				static_cast<uint8_t>(unirecRecordView.getFieldAsType<char>(field.id)));
+			break;
+		case UR_TYPE_UINT8:
+			hash = mixWord(hash, unirecRecordView.getFieldAsType<uint8_t>(field.id));
+			break;
+		case UR_TYPE_INT8:
+			hash = mixWord(
+				hash,
+				static_cast<uint8_t>(unirecRecordView.getFieldAsType<int8_t>(field.id)));
+			break;
+		case UR_TYPE_UINT16:
+			hash = mixWord(hash, unirecRecordView.getFieldAsType<uint16_t>(field.id));
+			break;
+		case UR_TYPE_INT16:
+			hash = mixWord(
+				hash,
+				static_cast<uint16_t>(unirecRecordView.getFieldAsType<int16_t>(field.id)));
+			break;
+		case UR_TYPE_UINT32:
+			hash = mixWord(hash, unirecRecordView.getFieldAsType<uint32_t>(field.id));
+			break;
+		case UR_TYPE_INT32:
+			hash = mixWord(
+				hash,
+				static_cast<uint32_t>(unirecRecordView.getFieldAsType<int32_t>(field.id)));
+			break;
+		case UR_TYPE_UINT64:
+			hash = mixWord(hash, unirecRecordView.getFieldAsType<uint64_t>(field.id));
+			break;
+		case UR_TYPE_INT64:
+			hash = mixWord(
+				hash,
+				static_cast<uint64_t>(unirecRecordView.getFieldAsType<int64_t>(field.id)));
+			break;
+		case UR_TYPE_TIME:
+			hash = mixWord(hash, unirecRecordView.getFieldAsType<Nemea::UrTime>(field.id).time);
+			break;
+		case UR_TYPE_IP: {
+			const ip_addr_t address = unirecRecordView.getFieldAsType<Nemea::IpAddress>(field.id).ip;
+			hash = mixWord(hash, address.ui64[0]);
+			hash = mixWord(hash, address.ui64[1]);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+	return hash;
+}
+
+} // namespace Sampler
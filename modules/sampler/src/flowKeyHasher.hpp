@@ -0,0 +1,66 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the FlowKeyHasher class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unirec++/unirec.hpp>
+#include <vector>
+
+namespace Sampler {
+
+/**
+ * @brief Computes a seeded hash of the flow key of a record.
+ *
+ * The key consists of the configured fields. With direction normalization, every `SRC_*`
+ * field that has its `DST_*` counterpart in the key forms the source endpoint and the
+ * counterparts form the destination endpoint. The endpoints are hashed separately and combined
+ * in a fixed order, so both directions of a flow get the same hash.
+ */
+class FlowKeyHasher {
+public:
+	/**
+	 * @brief Constructs the hasher and resolves the ids of the key fields.
+	 * @param fieldNames Names of the key fields.
+	 * @param normalizeDirection Whether both directions of a flow hash to the same value.
+	 * @param seed Seed of the hash, instances with the same seed compute the same hashes.
+	 * @throw std::invalid_argument If a field is unknown or of an unsupported type.
+	 */
+	FlowKeyHasher(const std::vector<std::string>& fieldNames, bool normalizeDirection, uint64_t seed);
+
+	/**
+	 * @brief Checks that the template contains all key fields.
+	 * @param unirecTemplate Template of the received records.
+	 * @throw std::runtime_error If a key field is missing in the template.
+	 */
+	void changeTemplate(const ur_template_t* unirecTemplate) const;
+
+	/**
+	 * @brief Returns the hash of the flow key of the record.
+	 */
+	uint64_t hash(const Nemea::UnirecRecordView& unirecRecordView) const;
+
+private:
+	struct KeyField {
+		ur_field_id_t id;
+		ur_field_type_t type;
+	};
+
+	uint64_t hashFields(
+		const std::vector<KeyField>& fields,
+		const Nemea::UnirecRecordView& unirecRecordView,
+		uint64_t hash) const;
+
+	std::vector<KeyField> m_sourceFields;
+	std::vector<KeyField> m_destinationFields;
+	std::vector<KeyField> m_otherFields;
+	uint64_t m_seed;
+};
+
+} // namespace Sampler
@@ -0,0 +1,90 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the FlowTable class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "flowTable.hpp"
+
+#include <stdexcept>
+
+namespace {
+
+constexpr uint64_t EMPTY_KEY = 0;
+constexpr uint64_t ZERO_KEY_REPLACEMENT = 0x9E3779B97F4A7C15ULL;
+
+} // namespace
+
+namespace Sampler {
+
+FlowTable::FlowTable(size_t capacity)
+{
+	if (capacity == 0) {
+		throw std::invalid_argument("Flow table size must be higher than zero.");
+	}
+
+	size_t buckets = 1;
+	while (buckets * BUCKET_SIZE < capacity) {
+		buckets *= 2;
+	}
+	m_keys.assign(buckets * BUCKET_SIZE, EMPTY_KEY);
+	m_states.resize(buckets);
+	m_bucketMask = buckets - 1;
+}
+
+bool FlowTable::lookup(uint64_t key) noexcept
+{
+	key = storedKey(key);
+	const size_t bucket = bucketOf(key);
+	const uint64_t* keys = &m_keys[bucket * BUCKET_SIZE];
+	for (size_t slot = 0; slot < BUCKET_SIZE; slot++) {
+		if (keys[slot] == key) {
+			m_states[bucket].referenced |= uint8_t(1U << slot);
+			return true;
+		}
+	}
+	return false;
+}
+
+void FlowTable::insert(uint64_t key) noexcept
+{
+	key = storedKey(key);
+	const size_t bucket = bucketOf(key);
+	uint64_t* keys = &m_keys[bucket * BUCKET_SIZE];
+	BucketState& state = m_states[bucket];
+
+	for (size_t slot = 0; slot < BUCKET_SIZE; slot++) {
+		if (keys[slot] == EMPTY_KEY) {
+			keys[slot] = key;
+			state.referenced |= uint8_t(1U << slot);
+			m_size++;
+			return;
+		}
+	}
+
+	// the hand clears reference bits until it finds an unreferenced slot, at most one round
+	while ((state.referenced & (1U << state.hand)) != 0) {
+		state.referenced &= uint8_t(~(1U << state.hand));
+		state.hand = uint8_t((state.hand + 1) % BUCKET_SIZE);
+	}
+	keys[state.hand] = key;
+	state.referenced |= uint8_t(1U << state.hand);
+	state.hand = uint8_t((state.hand + 1) % BUCKET_SIZE);
+	m_evictions++;
+}
+
+uint64_t FlowTable::storedKey(uint64_t key) noexcept
+{
+	// zero marks an empty slot
+	return key == EMPTY_KEY ? ZERO_KEY_REPLACEMENT : key;
+}
+
+size_t FlowTable::bucketOf(uint64_t key) const noexcept
+{
+	// keys are finalized hashes, so their low bits are uniformly distributed
+	return static_cast<size_t>(key) & m_bucketMask;
+}
+
+} // namespace Sampler
@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the FlowTable class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Sampler {
+
+/**
+ * @brief Fixed-size table of flow key hashes with CLOCK eviction.
+ *
+ * The table is open-addressed with buckets of eight slots, a key is stored only in the bucket
+ * selected by its hash, so a lookup reads a single cache line. When the bucket is full, the
+ * inserted key replaces the first slot not referenced since the clock hand of the bucket last
+ * passed it, which approximates LRU eviction without reordering the slots.
+ */
+class FlowTable {
+public:
+	/// Number of slots in a bucket, the keys of a bucket fill one cache line.
+	static constexpr size_t BUCKET_SIZE = 8;
+
+	/**
+	 * @brief Constructs an empty table.
+	 * @param capacity Minimal number of keys the table holds, rounded up to a power of two.
+	 * @throw std::invalid_argument If the capacity is zero.
+	 */
+	explicit FlowTable(size_t capacity);
+
+	/**
+	 * @brief Looks up a key and marks it as recently used.
+	 * @return True if the key is in the table.
+	 */
+	bool lookup(uint64_t key) noexcept;
+
+	/**
+	 * @brief Inserts a key that is not in the table, evicting another key if the bucket is full.
+	 */
+	void insert(uint64_t key) noexcept;
+
+	/**
+	 * @brief Returns the number of keys the table holds.
+	 */
+	size_t capacity() const noexcept { return m_keys.size(); }
+
+	/**
+	 * @brief Returns the number of keys in the table.
+	 */
+	size_t size() const noexcept { return m_size; }
+
+	/**
+	 * @brief Returns the number of keys evicted to make room for new ones.
+	 */
+	uint64_t evictions() const noexcept { return m_evictions; }
+
+private:
+	struct BucketState {
+		uint8_t referenced = 0; ///< Bit per slot set when the slot is used.
+		uint8_t hand = 0; ///< Slot where the next eviction search starts.
+	};
+
+	static uint64_t storedKey(uint64_t key) noexcept;
+	size_t bucketOf(uint64_t key) const noexcept;
+
+	std::vector<uint64_t> m_keys;
+	std::vector<BucketState> m_states;
+	size_t m_bucketMask;
+	size_t m_size = 0;
+	uint64_t m_evictions = 0;
+};
+
+} // namespace Sampler
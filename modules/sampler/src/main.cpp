@@ -5,103 +5,380 @@
  * @brief Sampling Module: Sample flowdata
  *
  * This file contains the main function and supporting functions for the Unirec Sampling Module.
- * This module process Unirec records thourgh a bidirectional interface and samples them accoring
- * to user specified sampling rate. It utilizes the Unirec++ library for
+ * This module receives Unirec records through an input interface and samples them accoring
+ * to user specified sampling rate. Every output interface has its own sampler and all of them
+ * are fed by a single receive. It utilizes the Unirec++ library for
  * record handling, argparse for command-line argument parsing.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#include "counters/counterRate.hpp"
+#include "fieldDefinition.hpp"
+#include "instrumentation/instrumentation.hpp"
 #include "logger/logger.hpp"
+#include "renormalizer.hpp"
 #include "sampler.hpp"
+#include "unirec/record-loop.hpp"
 #include "unirec/unirec-telemetry.hpp"
 
+#include <algorithm>
 #include <appFs.hpp>
 #include <argparse/argparse.hpp>
 #include <atomic>
+#include <chrono>
+#include <cmath>
 #include <csignal>
+#include <cstdlib>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 #include <telemetry.hpp>
 #include <unirec++/unirec.hpp>
+#include <vector>
 
 using namespace Nemea;
 
 std::atomic<bool> g_stopFlag(false);
 
+// receive timeout in microseconds, statistics are published and windows of the stratified mode
+// end even if no records are received
+const int RECEIVE_TIMEOUT = 100'000;
+
 void signalHandler(int signum)
 {
 	Nm::loggerGet("signalHandler")->info("Interrupt signal {} received", signum);
 	g_stopFlag.store(true);
 }
 
+/**
+ * @brief Output interface together with the sampler that selects the records sent through it.
+ */
+struct SamplerOutput {
+	SamplerOutput(
+		UnirecOutputInterface outputInterface,
+		const Sampler::SamplerConfig& config,
+		std::optional<Sampler::Renormalizer> outputRenormalizer)
+		: interface(std::move(outputInterface))
+		, sampler(config)
+		, renormalizer(std::move(outputRenormalizer))
+	{
+	}
+
+	UnirecOutputInterface interface;
+	Sampler::Sampler sampler;
+	/// Renormalizer of the sampled records, empty if records are forwarded unchanged.
+	std::optional<Sampler::Renormalizer> renormalizer;
+	Nm::CounterRate receivedRate; ///< Rate of received records reported by the telemetry.
+	Nm::CounterRate sampledRate; ///< Rate of sampled records reported by the telemetry.
+};
+
+/**
+ * @brief Sends the records stored by the stratified outputs whose window has ended.
+ *
+ * @param outputs Outputs of the module.
+ * @param force Flush all reservoirs regardless of their windows.
+ */
+void flushReservoirs(std::deque<SamplerOutput>& outputs, bool force)
+{
+	const auto now = Sampler::StratifiedReservoir::Clock::now();
+	for (auto& output : outputs) {
+		auto* reservoir = output.sampler.getReservoir();
+		if (reservoir == nullptr || !(force || reservoir->windowEnded(now))) {
+			continue;
+		}
+		reservoir->flush(now, [&output](UnirecRecordView& unirecRecordView) {
+			const Nm::ScopedTimer sendTimer(Nm::g_sendProbe);
+			output.interface.send(unirecRecordView);
+		});
+		output.sampler.publishStats();
+	}
+}
+
 /**
  * @brief Handle a format change exception by adjusting the template.
  *
  * This function is called when a `FormatChangeException` is caught in the main loop.
- * It adjusts the template in the bidirectional interface to handle the format change.
+ * It flushes the reservoirs of the stratified outputs, adjusts the template of the input
+ * interface, sets the same template on every output interface and resolves the fields used by
+ * the samplers in the new template.
  *
- * @param biInterface Bidirectional interface for Unirec communication.
+ * @param iInterface Input interface for Unirec communication.
+ * @param outputs Outputs of the module.
  */
-void handleFormatChange(UnirecBidirectionalInterface& biInterface)
+void handleFormatChange(UnirecInputInterface& iInterface, std::deque<SamplerOutput>& outputs)
 {
-	biInterface.changeTemplate();
+	// stored records have to be sent before their template is replaced
+	flushReservoirs(outputs, true);
+
+	iInterface.changeTemplate();
+	const ur_template_t* unirecTemplate = iInterface.getTemplate();
+
+	const std::unique_ptr<char, decltype(&free)> templateSpecification(
+		ur_template_string(unirecTemplate),
+		&free);
+	if (!templateSpecification) {
+		throw std::runtime_error("Unable to get the specification of the input template");
+	}
+
+	for (auto& output : outputs) {
+		output.interface.changeTemplate(templateSpecification.get());
+		output.sampler.changeTemplate(unirecTemplate);
+		if (output.renormalizer) {
+			output.renormalizer->changeTemplate(
+				unirecTemplate,
+				output.interface.createUnirecRecord());
+		}
+	}
 }
 
 /**
- * @brief Process the next Unirec record and sample them.
+ * @brief Handler of the received records sampling them for every output.
+ *
+ * Every output decides whether to forward the received record and all outputs send the same
+ * received record without a copy, only records sampled with a probability lower than one have
+ * their counters renormalized in a copy. The reservoirs of the stratified outputs are flushed
+ * at the ends of their windows, which is checked in endRound().
+ */
+class SamplerHandler : public Nm::RecordHandler {
+public:
+	SamplerHandler(UnirecInputInterface& iInterface, std::deque<SamplerOutput>& outputs)
+		: m_iInterface(iInterface)
+		, m_outputs(outputs)
+		, m_stratified(std::any_of(outputs.begin(), outputs.end(), [](auto& output) {
+			return output.sampler.getReservoir() != nullptr;
+		}))
+	{
+	}
+
+	void processRecord(UnirecRecordView& unirecRecord)
+	{
+		for (auto& output : m_outputs) {
+			if (!output.sampler.shouldBeSampled(unirecRecord)) {
+				continue;
+			}
+
+			if (output.renormalizer && output.sampler.getWeight() != 1) {
+				auto& renormalized
+					= output.renormalizer->apply(unirecRecord, output.sampler.getWeight());
+				const Nm::ScopedTimer sendTimer(Nm::g_sendProbe);
+				output.interface.send(renormalized);
+				continue;
+			}
+			const Nm::ScopedTimer sendTimer(Nm::g_sendProbe);
+			output.interface.send(unirecRecord);
+		}
+	}
+
+	void endRound(bool idle)
+	{
+		if (m_stratified) {
+			flushReservoirs(m_outputs, false);
+		}
+		if (idle) {
+			// the input is idle, so the statistics would not be published by the samplers
+			publishStats();
+		}
+	}
+
+	void changeTemplate() { handleFormatChange(m_iInterface, m_outputs); }
+
+	void endOfInput()
+	{
+		flushReservoirs(m_outputs, true);
+		publishStats();
+	}
+
+private:
+	void publishStats()
+	{
+		for (auto& output : m_outputs) {
+			output.sampler.publishStats();
+		}
+	}
+
+	UnirecInputInterface& m_iInterface;
+	std::deque<SamplerOutput>& m_outputs;
+	const bool m_stratified;
+};
+
+/**
+ * @brief Process Unirec records.
  *
- * This function receives the next Unirec record through the bidirectional interface
- * and performs sampling.
+ * The `processUnirecRecords` function continuously receives Unirec records one at a time through
+ * the provided input interface (`iInterface`) and performs sampling for every output. The loop
+ * runs indefinitely until an end-of-file condition is encountered.
  *
- * @param biInterface Bidirectional interface for Unirec communication.
- * @param sampler Sampler class for sampling.
+ * @param iInterface Input interface for Unirec communication.
+ * @param outputs Outputs of the module.
  */
+void processUnirecRecords(UnirecInputInterface& iInterface, std::deque<SamplerOutput>& outputs)
+{
+	SamplerHandler handler(iInterface, outputs);
+	Nm::processRecords(iInterface, handler, g_stopFlag);
+}
 
-void processNextRecord(UnirecBidirectionalInterface& biInterface, Sampler::Sampler& sampler)
+/**
+ * @brief Counts the occurrences of an argument on the command line.
+ *
+ * The number of output interfaces has to be known before the arguments are parsed. The short
+ * form is counted also with an attached value ("-ofoo", "-o=foo"), the long form also with an
+ * assigned value ("--output=foo"). Arguments after "--" are not options.
+ */
+int countArgument(int argc, char** argv, const std::string& shortName, const std::string& longName)
 {
-	std::optional<UnirecRecordView> unirecRecord = biInterface.receive();
-	if (!unirecRecord) {
-		return;
+	int count = 0;
+	for (int i = 1; i < argc; i++) {
+		const std::string argument = argv[i];
+		if (argument == "--") {
+			break;
+		}
+		if (argument.rfind(shortName, 0) == 0 || argument == longName
+			|| argument.rfind(longName + "=", 0) == 0) {
+			count++;
+		}
 	}
+	return count;
+}
 
-	if (sampler.shouldBeSampled()) {
-		biInterface.send(*unirecRecord);
+/**
+ * @brief Splits a comma-separated list of field names.
+ */
+std::vector<std::string> parseFieldList(const std::string& fieldList)
+{
+	std::vector<std::string> fieldNames;
+	std::istringstream stream(fieldList);
+	std::string fieldName;
+	while (std::getline(stream, fieldName, ',')) {
+		if (!fieldName.empty()) {
+			fieldNames.push_back(fieldName);
+		}
 	}
+	return fieldNames;
 }
 
 /**
- * @brief Process Unirec records.
+ * @brief Configures the sampler of an output from its specification.
  *
- * The `processUnirecRecords` function continuously receives Unirec records through the provided
- * bidirectional interface (`biInterface`) and performs sampling. The loop runs indefinitely until
- * an end-of-file condition is encountered.
+ * The specification has the form `<mode>[:<value>]`, where the value is the sampling rate in
+ * the count, hash, random and hold mode, the target rate in the adaptive mode, the threshold in
+ * the priority mode and the reservoir size in the stratified mode. The other parameters are taken from the common configuration.
  *
- * @param biInterface Bidirectional interface for Unirec communication.
- * @param sampler Sampler class for sampling.
+ * @throw std::invalid_argument If the specification is invalid.
  */
-void processUnirecRecords(UnirecBidirectionalInterface& biInterface, Sampler::Sampler& sampler)
+Sampler::SamplerConfig
+parseOutputSpecification(const std::string& specification, Sampler::SamplerConfig config)
 {
-	while (!g_stopFlag.load()) {
-		try {
-			processNextRecord(biInterface, sampler);
-		} catch (FormatChangeException& ex) {
-			handleFormatChange(biInterface);
-		} catch (EoFException& ex) {
-			break;
-		} catch (std::exception& ex) {
-			throw;
+	const auto separator = specification.find(':');
+	config.mode = Sampler::parseSamplingMode(specification.substr(0, separator));
+	if (separator == std::string::npos) {
+		return config;
+	}
+
+	const std::string valueText = specification.substr(separator + 1);
+	size_t parsedLength = 0;
+	double value = 0;
+	try {
+		value = std::stod(valueText, &parsedLength);
+	} catch (const std::exception&) {
+		parsedLength = 0;
+	}
+	if (valueText.empty() || parsedLength != valueText.size()) {
+		throw std::invalid_argument("Invalid value in output specification '" + specification + "'");
+	}
+
+	switch (config.mode) {
+	case Sampler::SamplingMode::Adaptive:
+		config.targetRate = value;
+		break;
+	case Sampler::SamplingMode::Priority:
+		config.threshold = value;
+		break;
+	case Sampler::SamplingMode::Stratified:
+		if (!(value >= 1) || value != std::floor(value)) {
+			throw std::invalid_argument(
+				"Invalid reservoir size in output specification '" + specification + "'");
 		}
+		config.reservoir.reservoirSize = static_cast<size_t>(value);
+		break;
+	default:
+		config.samplingRate = value;
+		break;
 	}
+	return config;
 }
 
-telemetry::Content getSamplerTelemetry(const Sampler::Sampler& sampler)
+/**
+ * @brief Parses the definition of the strata given as `<field>[/<IPv4 length>[/<IPv6 length>]]`.
+ * @throw std::invalid_argument If the definition is invalid.
+ */
+void parseStratum(const std::string& stratum, Sampler::StratifiedReservoirConfig& config)
 {
-	auto stats = sampler.getStats();
+	std::istringstream stream(stratum);
+	std::getline(stream, config.stratumField, '/');
+
+	std::string prefixLength;
+	try {
+		if (std::getline(stream, prefixLength, '/')) {
+			config.prefixLength4 = static_cast<unsigned>(std::stoul(prefixLength));
+		}
+		if (std::getline(stream, prefixLength, '/')) {
+			config.prefixLength6 = static_cast<unsigned>(std::stoul(prefixLength));
+		}
+	} catch (const std::exception&) {
+		throw std::invalid_argument("Invalid stratum '" + stratum + "'");
+	}
+}
+
+telemetry::Content getSamplerTelemetry(SamplerOutput& output)
+{
+	auto stats = output.sampler.getStats();
+	const auto now = Nm::CounterRate::Clock::now();
 
 	telemetry::Dict dict;
 	dict["totalRecords"] = stats.totalRecords;
 	dict["sampledRecords"] = stats.sampledRecords;
+	dict["receivedRecordsPerSecond"] = telemetry::ScalarWithUnit {
+		output.receivedRate.update(stats.totalRecords, now),
+		"records/s"};
+	dict["sampledRecordsPerSecond"] = telemetry::ScalarWithUnit {
+		output.sampledRate.update(stats.sampledRecords, now),
+		"records/s"};
+	dict["samplingProbability"] = stats.samplingProbability;
+	dict["appliedRate"] = 1 / stats.samplingProbability;
+	if (stats.inputRate > 0) {
+		dict["inputRate"] = telemetry::ScalarWithUnit {stats.inputRate, "records/s"};
+		dict["throttledRecords"] = stats.throttledRecords;
+	}
+	if (stats.flowTableCapacity > 0) {
+		dict["flowTableCapacity"] = uint64_t(stats.flowTableCapacity);
+		dict["flowTableOccupancy"] = telemetry::ScalarWithUnit {
+			100.0 * static_cast<double>(stats.flowTableSize) / stats.flowTableCapacity,
+			"%"};
+		dict["flowTableHits"] = stats.flowTableHits;
+		dict["flowTableEvictions"] = stats.flowTableEvictions;
+		if (stats.totalRecords > 0) {
+			dict["flowTableHitRate"] = telemetry::ScalarWithUnit {
+				100.0 * static_cast<double>(stats.flowTableHits) / stats.totalRecords,
+				"%"};
+		}
+	}
+	if (stats.maxStrata > 0) {
+		dict["strata"] = uint64_t(stats.strata);
+		dict["maxStrata"] = uint64_t(stats.maxStrata);
+		dict["droppedRecords"] = stats.droppedRecords;
+		dict["reservoirMemory"] = telemetry::ScalarWithUnit {
+			static_cast<double>(stats.reservoirBytes) / (1 << 20),
+			"MiB"};
+	}
+	if (stats.sampledRecords > 0) {
+		dict["effectiveRate"] = static_cast<double>(stats.totalRecords) / stats.sampledRecords;
+	}
 	return dict;
 }
 
@@ -109,7 +386,8 @@ int main(int argc, char** argv)
 {
 	argparse::ArgumentParser program("Unirec Sampler");
 
-	Unirec unirec({1, 1, "sampler", "Unirec sampling module"});
+	const int outputCount = std::max(1, countArgument(argc, argv, "-o", "--output"));
+	Unirec unirec({1, outputCount, "sampler", "Unirec sampling module"});
 
 	Nm::loggerInit();
 	auto logger = Nm::loggerGet("main");
@@ -118,10 +396,87 @@ int main(int argc, char** argv)
 
 	try {
 		program.add_argument("-r", "--rate")
-			.required()
+			.default_value(1.0)
+			.help(
+				"Specify the sampling rate 1:r. Every -rth sample will be forwarded to the output. "
+				"The rate can be fractional in the random mode.")
+			.scan<'g', double>();
+		program.add_argument("--mode")
+			.help(
+				"Sampling mode: 'count' forwards every r-th record, 'hash' forwards all records of "
+				"flows whose key hashes to zero modulo r, 'random' forwards every record with "
+				"probability 1/r, 'adaptive' samples randomly with the probability adjusted to "
+				"hold the target rate, 'priority' forwards every record with probability "
+				"min(1, weight / threshold) and renormalizes its counters, 'hold' forwards every "
+				"record with probability 1/r and all later records of flows held in the flow "
+				"table, 'stratified' forwards a uniform sample of at most reservoir size records "
+				"per stratum at the end of every window.")
+			.default_value(std::string("count"));
+		program.add_argument("--key-fields")
+			.help("Comma-separated fields of the flow key used by the hash and hold mode.")
+			.default_value(std::string("SRC_IP,DST_IP,SRC_PORT,DST_PORT,PROTOCOL"));
+		program.add_argument("--directional")
+			.help("Hash both directions of a flow separately in the hash mode.")
+			.default_value(false)
+			.implicit_value(true);
+		program.add_argument("--seed")
 			.help(
-				"Specify the sampling rate 1:r. Every -rth sample will be forwarded to the output.")
-			.scan<'i', int>();
+				"Seed of the flow key hash, instances with the same seed sample the same flows. "
+				"Seed of the random generator in the random mode, random if not given.")
+			.default_value(uint64_t(0))
+			.scan<'u', uint64_t>();
+		program.add_argument("--target-rate")
+			.help(
+				"Target output rate in records per second of the adaptive mode, implies the "
+				"adaptive mode.")
+			.default_value(0.0)
+			.scan<'g', double>();
+		program.add_argument("--weight-field")
+			.help("Field the priority mode samples proportionally to.")
+			.default_value(std::string("BYTES"));
+		program.add_argument("--threshold")
+			.help("Weight from which records are always forwarded in the priority mode.")
+			.default_value(0.0)
+			.scan<'g', double>();
+		program.add_argument("--table-size")
+			.help("Number of flows held in the flow table of the hold mode.")
+			.default_value(size_t(65536))
+			.scan<'u', size_t>();
+		program.add_argument("--stratum")
+			.help(
+				"IP address field and the IPv4 and IPv6 prefix lengths defining the strata of the "
+				"stratified mode, given as <field>[/<IPv4 length>[/<IPv6 length>]].")
+			.default_value(std::string("SRC_IP/24/64"));
+		program.add_argument("--reservoir-size")
+			.help("Maximal number of records forwarded per stratum and window.")
+			.default_value(size_t(100))
+			.scan<'u', size_t>();
+		program.add_argument("--max-strata")
+			.help("Maximal number of strata in a window, records of other strata are dropped.")
+			.default_value(size_t(65536))
+			.scan<'u', size_t>();
+		program.add_argument("--reservoir-memory")
+			.help("Maximal memory of the reservoirs in MiB.")
+			.default_value(size_t(256))
+			.scan<'u', size_t>();
+		program.add_argument("--window")
+			.help("Length of a window of the stratified mode in seconds.")
+			.default_value(uint64_t(60))
+			.scan<'u', uint64_t>();
+		program.add_argument("-o", "--output")
+			.help(
+				"Adds an output interface with its own sampler given as <mode>[:<value>], where the "
+				"value is the rate in the count, hash, random and hold mode, the target rate in the "
+				"adaptive mode, the threshold in the priority mode and the reservoir size in the "
+				"stratified mode. Can be repeated, every "
+				"received record is offered to all outputs. The other options are shared by all "
+				"outputs.")
+			.append();
+		program.add_argument("--renormalize-fields")
+			.help(
+				"Comma-separated counters multiplied by the inverse sampling probability in the "
+				"priority mode, so that their sums stay unbiased.")
+			.default_value(std::string("BYTES,PACKETS"));
 		program.add_argument("-m", "--appfs-mountpoint")
 			.required()
 			.help("path where the appFs directory will be mounted")
@@ -171,27 +526,114 @@ int main(int argc, char** argv)
 	}
 
 	try {
-		const int samplingRate = program.get<int>("--rate");
-		if (samplingRate <= 0) {
-			std::cerr << "Sampling rate must be higher than zero.\n";
-			return EXIT_FAILURE;
+		Sampler::SamplerConfig samplerConfig;
+		samplerConfig.mode = Sampler::parseSamplingMode(program.get<std::string>("--mode"));
+		samplerConfig.samplingRate = program.get<double>("--rate");
+		samplerConfig.keyFields = parseFieldList(program.get<std::string>("--key-fields"));
+		samplerConfig.normalizeDirection = !program.get<bool>("--directional");
+		samplerConfig.seed = program.get<uint64_t>("--seed");
+		samplerConfig.targetRate = program.get<double>("--target-rate");
+		samplerConfig.weightField = program.get<std::string>("--weight-field");
+		samplerConfig.threshold = program.get<double>("--threshold");
+		samplerConfig.flowTableSize = program.get<size_t>("--table-size");
+		parseStratum(program.get<std::string>("--stratum"), samplerConfig.reservoir);
+		samplerConfig.reservoir.reservoirSize = program.get<size_t>("--reservoir-size");
+		samplerConfig.reservoir.maxStrata = program.get<size_t>("--max-strata");
+		samplerConfig.reservoir.memoryLimit = program.get<size_t>("--reservoir-memory") << 20;
+		samplerConfig.reservoir.windowLength
+			= std::chrono::seconds(program.get<uint64_t>("--window"));
+		if (program.is_used("--target-rate")) {
+			if (program.is_used("--mode") && samplerConfig.mode != Sampler::SamplingMode::Adaptive) {
+				logger->error("Target rate can be used only in the adaptive mode.");
+				return EXIT_FAILURE;
+			}
+			samplerConfig.mode = Sampler::SamplingMode::Adaptive;
 		}
 
-		Sampler::Sampler sampler(samplingRate);
+		std::vector<Sampler::SamplerConfig> outputConfigs;
+		if (program.is_used("--output")) {
+			const auto specifications = program.get<std::vector<std::string>>("--output");
+			if (specifications.size() != static_cast<size_t>(outputCount)) {
+				logger->error(
+					"Cannot determine the number of outputs, give every output as -o <mode>.");
+				return EXIT_FAILURE;
+			}
+			for (const auto& specification : specifications) {
+				outputConfigs.push_back(parseOutputSpecification(specification, samplerConfig));
+			}
+		} else {
+			outputConfigs.push_back(samplerConfig);
+		}
 
-		UnirecBidirectionalInterface biInterface = unirec.buildBidirectionalInterface();
+		auto renormalizeFields = parseFieldList(program.get<std::string>("--renormalize-fields"));
+		const bool priorityOutput = std::any_of(
+			outputConfigs.begin(),
+			outputConfigs.end(),
+			[](const auto& outputConfig) {
+				return outputConfig.mode == Sampler::SamplingMode::Priority;
+			});
+		if (priorityOutput) {
+			for (auto& field : renormalizeFields) {
+				Sampler::defineField(field);
+			}
+		}
+
+		UnirecInputInterface iInterface = unirec.buildInputInterface();
+		iInterface.setTimeout(RECEIVE_TIMEOUT);
+
+		std::random_device randomDevice;
+		// samplers are neither copyable nor movable, the deque constructs them in place
+		std::deque<SamplerOutput> outputs;
+		for (size_t index = 0; index < outputConfigs.size(); index++) {
+			auto& outputConfig = outputConfigs[index];
+			const bool randomMode = outputConfig.mode == Sampler::SamplingMode::Random
+				|| outputConfig.mode == Sampler::SamplingMode::Adaptive
+				|| outputConfig.mode == Sampler::SamplingMode::Priority
+				|| outputConfig.mode == Sampler::SamplingMode::Hold
+				|| outputConfig.mode == Sampler::SamplingMode::Stratified;
+			// hash outputs share the seed and thus select nested sets of flows, random outputs
+			// must draw independently
+			if (randomMode && !program.is_used("--seed")) {
+				outputConfig.seed = (uint64_t(randomDevice()) << 32) | randomDevice();
+			} else if (randomMode) {
+				outputConfig.seed += 2 * index;
+			}
+			outputConfig.reservoir.seed = outputConfig.seed;
+			// the samplers resolve their fields on construction, before any template is received
+			Sampler::defineSamplerFields(outputConfig);
+
+			std::optional<Sampler::Renormalizer> renormalizer;
+			if (outputConfig.mode == Sampler::SamplingMode::Priority) {
+				renormalizer.emplace(renormalizeFields, outputConfig.seed + 1);
+			}
+			outputs.emplace_back(
+				unirec.buildOutputInterface(),
+				outputConfig,
+				std::move(renormalizer));
+		}
 
 		auto telemetryInputDirectory = telemetryRootDirectory->addDir("input");
+		Nm::InterfaceRates inputRates;
 		const telemetry::FileOps inputFileOps
-			= {[&biInterface]() { return Nm::getInterfaceTelemetry(biInterface); }, nullptr};
+			= {[&iInterface, &inputRates]() {
+				   return Nm::getInterfaceTelemetry(iInterface, inputRates);
+			   },
+			   nullptr};
 		const auto inputFile = telemetryInputDirectory->addFile("stats", inputFileOps);
+		Nm::Instrumentation::setTelemetryDirectory(telemetryRootDirectory);
 
 		auto telemetrySamplerDirectory = telemetryRootDirectory->addDir("sampler");
-		const telemetry::FileOps samplerFileOps
-			= {[&sampler]() { return getSamplerTelemetry(sampler); }, nullptr};
-		const auto samplerFile = telemetrySamplerDirectory->addFile("stats", samplerFileOps);
+		std::vector<std::shared_ptr<telemetry::File>> samplerFiles;
+		for (size_t index = 0; index < outputs.size(); index++) {
+			auto& output = outputs[index];
+			const telemetry::FileOps samplerFileOps
+				= {[&output]() { return getSamplerTelemetry(output); }, nullptr};
+			const std::string fileName
+				= outputs.size() == 1 ? "stats" : "output" + std::to_string(index);
+			samplerFiles.push_back(telemetrySamplerDirectory->addFile(fileName, samplerFileOps));
+		}
 
-		processUnirecRecords(biInterface, sampler);
+		processUnirecRecords(iInterface, outputs);
 
 	} catch (std::exception& ex) {
 		logger->error(ex.what());
@@ -0,0 +1,144 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the NumericField class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "numericField.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+template <typename T>
+void setClamped(Nemea::UnirecRecord& unirecRecord, ur_field_id_t fieldId, double value)
+{
+	if constexpr (std::is_integral_v<T>) {
+		constexpr auto MIN = static_cast<double>(std::numeric_limits<T>::min());
+		constexpr auto MAX = static_cast<double>(std::numeric_limits<T>::max());
+		if (value >= MAX) {
+			unirecRecord.setFieldFromType(std::numeric_limits<T>::max(), fieldId);
+			return;
+		}
+		unirecRecord.setFieldFromType(static_cast<T>(std::max(MIN, value)), fieldId);
+	} else {
+		unirecRecord.setFieldFromType(static_cast<T>(value), fieldId);
+	}
+}
+
+} // namespace
+
+namespace Sampler {
+
+NumericField::NumericField(const std::string& fieldName)
+	: m_name(fieldName)
+{
+	const int fieldId = ur_get_id_by_name(fieldName.c_str());
+	if (fieldId < 0) {
+		throw std::invalid_argument("Unknown field '" + fieldName + "'");
+	}
+	m_id = static_cast<ur_field_id_t>(fieldId);
+	m_type = ur_get_type(m_id);
+
+	switch (m_type) {
+	case UR_TYPE_UINT8:
+	case UR_TYPE_INT8:
+	case UR_TYPE_UINT16:
+	case UR_TYPE_INT16:
+	case UR_TYPE_UINT32:
+	case UR_TYPE_INT32:
+	case UR_TYPE_UINT64:
+	case UR_TYPE_INT64:
+	case UR_TYPE_FLOAT:
+	case UR_TYPE_DOUBLE:
+		break;
+	default:
+		throw std::invalid_argument("Field '" + fieldName + "' is not numeric");
+	}
+}
+
+void NumericField::checkTemplate(const ur_template_t* unirecTemplate) const
+{
+	if (!ur_is_present(unirecTemplate, m_id)) {
+		throw std::runtime_error("Field '" + m_name + "' is missing in the input template");
+	}
+}
+
+double NumericField::get(const Nemea::UnirecRecordView& unirecRecordView) const
+{
+	switch (m_type) {
+	case UR_TYPE_UINT8:
+		return unirecRecordView.getFieldAsType<uint8_t>(m_id);
+	case UR_TYPE_INT8:
+		return unirecRecordView.getFieldAsType<int8_t>(m_id);
+	case UR_TYPE_UINT16:
+		return unirecRecordView.getFieldAsType<uint16_t>(m_id);
+	case UR_TYPE_INT16:
+		return unirecRecordView.getFieldAsType<int16_t>(m_id);
+	case UR_TYPE_UINT32:
+		return unirecRecordView.getFieldAsType<uint32_t>(m_id);
+	case UR_TYPE_INT32:
+		return unirecRecordView.getFieldAsType<int32_t>(m_id);
+	case UR_TYPE_UINT64:
+		return static_cast<double>(unirecRecordView.getFieldAsType<uint64_t>(m_id));
+	case UR_TYPE_INT64:
+		return static_cast<double>(unirecRecordView.getFieldAsType<int64_t>(m_id));
+	case UR_TYPE_FLOAT:
+		return unirecRecordView.getFieldAsType<float>(m_id);
+	case UR_TYPE_DOUBLE:
+		return unirecRecordView.getFieldAsType<double>(m_id);
+	default:
+		return 0;
+	}
+}
+
+void NumericField::set(Nemea::UnirecRecord& unirecRecord, double value) const
+{
+	switch (m_type) {
+	case UR_TYPE_UINT8:
+		setClamped<uint8_t>(unirecRecord, m_id, value);
+		break;
+	case UR_TYPE_INT8:
+		setClamped<int8_t>(unirecRecord, m_id, value);
+		break;
+	case UR_TYPE_UINT16:
+		setClamped<uint16_t>(unirecRecord, m_id, value);
+		break;
+	case UR_TYPE_INT16:
+		setClamped<int16_t>(unirecRecord, m_id, value);
+		break;
+	case UR_TYPE_UINT32:
+		setClamped<uint32_t>(unirecRecord, m_id, value);
+		break;
+	case UR_TYPE_INT32:
+		setClamped<int32_t>(unirecRecord, m_id, value);
+		break;
+	case UR_TYPE_UINT64:
+		setClamped<uint64_t>(unirecRecord, m_id, value);
+		break;
+	case UR_TYPE_INT64:
+		setClamped<int64_t>(unirecRecord, m_id, value);
+		break;
+	case UR_TYPE_FLOAT:
+		setClamped<float>(unirecRecord, m_id, value);
+		break;
+	case UR_TYPE_DOUBLE:
+		setClamped<double>(unirecRecord, m_id, value);
+		break;
+	default:
+		break;
+	}
+}
+
+bool NumericField::isInteger() const noexcept
+{
+	return m_type != UR_TYPE_FLOAT && m_type != UR_TYPE_DOUBLE;
+}
+
+} // namespace Sampler
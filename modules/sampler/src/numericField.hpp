@@ -0,0 +1,55 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the NumericField class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <string>
+#include <unirec++/unirec.hpp>
+
+namespace Sampler {
+
+/**
+ * @brief Numeric Unirec field read and written as a double regardless of its type.
+ */
+class NumericField {
+public:
+	/**
+	 * @brief Resolves the id and the type of the field.
+	 * @param fieldName Name of the field.
+	 * @throw std::invalid_argument If the field is unknown or not numeric.
+	 */
+	explicit NumericField(const std::string& fieldName);
+
+	/**
+	 * @brief Checks that the template contains the field.
+	 * @throw std::runtime_error If the field is missing in the template.
+	 */
+	void checkTemplate(const ur_template_t* unirecTemplate) const;
+
+	/**
+	 * @brief Returns the value of the field.
+	 */
+	double get(const Nemea::UnirecRecordView& unirecRecordView) const;
+
+	/**
+	 * @brief Sets the field, the value is clamped to the range of an integer field.
+	 */
+	void set(Nemea::UnirecRecord& unirecRecord, double value) const;
+
+	/**
+	 * @brief Returns whether the field holds an integer.
+	 */
+	bool isInteger() const noexcept;
+
+private:
+	ur_field_id_t m_id;
+	ur_field_type_t m_type;
+	std::string m_name;
+};
+
+} // namespace Sampler
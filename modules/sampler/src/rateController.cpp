@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the RateController class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "rateController.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+using Seconds = std::chrono::duration<double>;
+
+constexpr double CHECK_INTERVAL = 0.01;
+constexpr double UPDATE_INTERVAL = 0.1;
+constexpr double TIME_CONSTANT = 0.3;
+constexpr double BUCKET_SECONDS = 0.2;
+constexpr double MAX_CHECK_RECORDS = 4096;
+
+} // namespace
+
+namespace Sampler {
+
+RateController::RateController(double targetRate, Clock::time_point now)
+	: m_targetRate(targetRate)
+	, m_bucketSize(std::max(1.0, targetRate * BUCKET_SECONDS))
+	, m_inputRate(targetRate)
+	, m_tokens(m_bucketSize)
+	, m_lastRefill(now)
+	, m_lastUpdate(now)
+{
+	if (!(targetRate > 0)) {
+		throw std::invalid_argument("Target rate must be higher than zero.");
+	}
+}
+
+bool RateController::update(Clock::time_point now)
+{
+	const double sinceRefill = Seconds(now - m_lastRefill).count();
+	m_tokens = std::min(m_bucketSize, m_tokens + sinceRefill * m_targetRate);
+	m_lastRefill = now;
+
+	bool changed = false;
+	const double sinceUpdate = Seconds(now - m_lastUpdate).count();
+	if (sinceUpdate >= UPDATE_INTERVAL) {
+		const double currentRate = static_cast<double>(m_records) / sinceUpdate;
+		const double weight = 1 - std::exp(-sinceUpdate / TIME_CONSTANT);
+		m_inputRate += weight * (currentRate - m_inputRate);
+		m_records = 0;
+		m_lastUpdate = now;
+
+		const double probability = m_inputRate > m_targetRate ? m_targetRate / m_inputRate : 1;
+		changed = probability != m_probability;
+		m_probability = probability;
+	}
+
+	m_recordsUntilCheck
+		= static_cast<uint64_t>(std::clamp(m_inputRate * CHECK_INTERVAL, 1.0, MAX_CHECK_RECORDS));
+	return changed;
+}
+
+} // namespace Sampler
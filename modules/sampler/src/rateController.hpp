@@ -0,0 +1,107 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the RateController class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace Sampler {
+
+/**
+ * @brief Adjusts the sampling probability so that the output holds a target rate.
+ *
+ * The input rate is smoothed by an exponentially weighted moving average and the sampling
+ * probability is set to the ratio of the target and the input rate. Until the average catches
+ * up with a sudden surge, the output is bounded by a token bucket that refills at the target
+ * rate and holds at most 200 ms worth of records.
+ *
+ * The clock is read only once per roughly 10 ms worth of records, so the per-record cost is a
+ * counter decrement.
+ */
+class RateController {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Constructs the controller.
+	 * @param targetRate Target output rate in records per second.
+	 * @param now Current time.
+	 * @throw std::invalid_argument If the target rate is not positive.
+	 */
+	explicit RateController(double targetRate, Clock::time_point now = Clock::now());
+
+	/**
+	 * @brief Accounts a received record.
+	 * @return True if the sampling probability changed.
+	 */
+	bool onRecord()
+	{
+		m_records++;
+		if (--m_recordsUntilCheck > 0) {
+			return false;
+		}
+		return update(Clock::now());
+	}
+
+	/**
+	 * @brief Takes a token for a sampled record.
+	 * @return False if the bucket is empty and the record has to be dropped.
+	 */
+	bool tryConsume() noexcept
+	{
+		if (m_tokens < 1) {
+			m_throttledRecords++;
+			return false;
+		}
+		m_tokens -= 1;
+		return true;
+	}
+
+	/**
+	 * @brief Updates the rates and refills the bucket.
+	 * @param now Current time.
+	 * @return True if the sampling probability changed.
+	 */
+	bool update(Clock::time_point now);
+
+	/**
+	 * @brief Returns the currently applied sampling probability.
+	 */
+	double probability() const noexcept { return m_probability; }
+
+	/**
+	 * @brief Returns the smoothed input rate in records per second.
+	 */
+	double inputRate() const noexcept { return m_inputRate; }
+
+	/**
+	 * @brief Returns the target output rate in records per second.
+	 */
+	double targetRate() const noexcept { return m_targetRate; }
+
+	/**
+	 * @brief Returns the number of sampled records dropped by the token bucket.
+	 */
+	uint64_t throttledRecords() const noexcept { return m_throttledRecords; }
+
+private:
+	const double m_targetRate;
+	const double m_bucketSize;
+
+	double m_inputRate;
+	double m_probability = 1;
+	double m_tokens;
+	uint64_t m_records = 0;
+	uint64_t m_recordsUntilCheck = 1;
+	uint64_t m_throttledRecords = 0;
+	Clock::time_point m_lastRefill;
+	Clock::time_point m_lastUpdate;
+};
+
+} // namespace Sampler
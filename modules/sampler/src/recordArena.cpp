@@ -0,0 +1,51 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the RecordArena class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "recordArena.hpp"
+
+#include <algorithm>
+
+namespace Sampler {
+
+RecordArena::RecordArena(size_t memoryLimit)
+	: m_maxChunks(std::max<size_t>(1, memoryLimit / CHUNK_SIZE))
+{
+}
+
+std::byte* RecordArena::allocate(size_t size, size_t alignment)
+{
+	if (size > CHUNK_SIZE) {
+		return nullptr;
+	}
+
+	// chunks are allocated by new, so they are aligned for any fundamental type
+	m_offset = (m_offset + alignment - 1) & ~(alignment - 1);
+	if (m_chunks.empty() || m_offset + size > CHUNK_SIZE) {
+		const size_t nextChunk = m_chunks.empty() ? 0 : m_currentChunk + 1;
+		if (nextChunk == m_maxChunks) {
+			return nullptr;
+		}
+		if (nextChunk == m_chunks.size()) {
+			m_chunks.push_back(std::make_unique<std::byte[]>(CHUNK_SIZE));
+		}
+		m_currentChunk = nextChunk;
+		m_offset = 0;
+	}
+
+	std::byte* memory = m_chunks[m_currentChunk].get() + m_offset;
+	m_offset += size;
+	return memory;
+}
+
+void RecordArena::reset() noexcept
+{
+	m_currentChunk = 0;
+	m_offset = 0;
+}
+
+} // namespace Sampler
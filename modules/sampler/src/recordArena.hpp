@@ -0,0 +1,64 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the RecordArena class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Sampler {
+
+/**
+ * @brief Bump allocator of record copies and reservoirs with bounded memory.
+ *
+ * Memory is taken from pooled chunks and released only all at once by reset(), which keeps the
+ * chunks for the next window, so the steady state allocates nothing from the heap.
+ */
+class RecordArena {
+public:
+	/// Size of a chunk, larger than the maximal size of a Unirec record.
+	static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+	/**
+	 * @brief Constructs an empty arena.
+	 * @param memoryLimit Maximal number of bytes held in chunks, at least one chunk is allowed.
+	 */
+	explicit RecordArena(size_t memoryLimit);
+
+	/**
+	 * @brief Allocates memory.
+	 * @param size Number of bytes.
+	 * @param alignment Alignment of the memory, a power of two.
+	 * @return Pointer to the memory or nullptr if the memory limit is reached.
+	 */
+	std::byte* allocate(size_t size, size_t alignment = 1);
+
+	/**
+	 * @brief Releases all allocations, the chunks are kept for reuse.
+	 */
+	void reset() noexcept;
+
+	/**
+	 * @brief Returns the number of allocated bytes.
+	 */
+	size_t usedBytes() const noexcept { return m_currentChunk * CHUNK_SIZE + m_offset; }
+
+	/**
+	 * @brief Returns the number of bytes held in chunks.
+	 */
+	size_t reservedBytes() const noexcept { return m_chunks.size() * CHUNK_SIZE; }
+
+private:
+	std::vector<std::unique_ptr<std::byte[]>> m_chunks;
+	size_t m_maxChunks;
+	size_t m_currentChunk = 0;
+	size_t m_offset = 0;
+};
+
+} // namespace Sampler
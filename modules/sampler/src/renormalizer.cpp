@@ -0,0 +1,51 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the Renormalizer class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "renormalizer.hpp"
+
+#include <cmath>
+#include <utility>
+
+namespace Sampler {
+
+Renormalizer::Renormalizer(const std::vector<std::string>& fieldNames, uint64_t seed)
+	: m_random(seed)
+{
+	for (const auto& fieldName : fieldNames) {
+		m_fields.emplace_back(fieldName);
+	}
+}
+
+void Renormalizer::changeTemplate(
+	const ur_template_t* unirecTemplate,
+	Nemea::UnirecRecord unirecRecord)
+{
+	for (const auto& field : m_fields) {
+		field.checkTemplate(unirecTemplate);
+	}
+	m_unirecRecord = std::move(unirecRecord);
+}
+
+Nemea::UnirecRecord&
+Renormalizer::apply(const Nemea::UnirecRecordView& unirecRecordView, double weight)
+{
+	m_unirecRecord.copyFieldsFrom(unirecRecordView);
+
+	for (const auto& field : m_fields) {
+		double value = field.get(unirecRecordView) * weight;
+		if (field.isInteger()) {
+			const double integral = std::floor(value);
+			// nextDouble() is in (0, 1], so a zero fraction never rounds up
+			value = integral + (m_random.nextDouble() < value - integral ? 1 : 0);
+		}
+		field.set(m_unirecRecord, value);
+	}
+	return m_unirecRecord;
+}
+
+} // namespace Sampler
@@ -0,0 +1,60 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the Renormalizer class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "numericField.hpp"
+#include "xoshiro256.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unirec++/unirec.hpp>
+#include <vector>
+
+namespace Sampler {
+
+/**
+ * @brief Scales counters of sampled records by their renormalization weight.
+ *
+ * A record sampled with probability p stands for 1/p records, so its counters are multiplied
+ * by the weight 1/p and sums over the sampled stream estimate the sums over the input without
+ * bias. Integer counters are rounded randomly, down or up with the probabilities given by the
+ * fractional part, so the rounding does not bias the estimates either.
+ */
+class Renormalizer {
+public:
+	/**
+	 * @brief Constructs the renormalizer.
+	 * @param fieldNames Names of the scaled counters.
+	 * @param seed Seed of the random rounding.
+	 * @throw std::invalid_argument If a field is unknown or not numeric.
+	 */
+	Renormalizer(const std::vector<std::string>& fieldNames, uint64_t seed);
+
+	/**
+	 * @brief Sets the template of the records.
+	 * @param unirecTemplate Template of the received records.
+	 * @param unirecRecord Output record with the same template, reused for every record.
+	 * @throw std::runtime_error If a counter is missing in the template.
+	 */
+	void changeTemplate(const ur_template_t* unirecTemplate, Nemea::UnirecRecord unirecRecord);
+
+	/**
+	 * @brief Returns a copy of the record with the counters multiplied by the weight.
+	 *
+	 * The returned record is valid until the next call.
+	 */
+	Nemea::UnirecRecord& apply(const Nemea::UnirecRecordView& unirecRecordView, double weight);
+
+private:
+	std::vector<NumericField> m_fields;
+	Nemea::UnirecRecord m_unirecRecord;
+	Xoshiro256 m_random;
+};
+
+} // namespace Sampler
@@ -8,31 +8,256 @@
 
 #include "sampler.hpp"
 
+#include "fieldDefinition.hpp"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
 namespace Sampler {
 
-Sampler::Sampler(std::size_t samplingRate)
-	: m_samplingRate(samplingRate)
+SamplingMode parseSamplingMode(const std::string& name)
 {
+	if (name == "count") {
+		return SamplingMode::Count;
+	}
+	if (name == "hash") {
+		return SamplingMode::Hash;
+	}
+	if (name == "random") {
+		return SamplingMode::Random;
+	}
+	if (name == "adaptive") {
+		return SamplingMode::Adaptive;
+	}
+	if (name == "priority") {
+		return SamplingMode::Priority;
+	}
+	if (name == "hold") {
+		return SamplingMode::Hold;
+	}
+	if (name == "stratified") {
+		return SamplingMode::Stratified;
+	}
+	throw std::invalid_argument("Unknown sampling mode '" + name + "'");
 }
 
-bool Sampler::shouldBeSampled() noexcept
+std::string defineSamplerFields(SamplerConfig& config)
 {
-	m_totalRecords++;
+	std::string requiredFormat;
+	auto define = [&requiredFormat](std::string& field) {
+		const std::string definition = defineField(field);
+		requiredFormat += requiredFormat.empty() ? definition : "," + definition;
+	};
 
-	if ((m_totalRecords % m_samplingRate) == 0) {
-		m_sampledRecords++;
-		return true;
+	if (config.mode == SamplingMode::Hash || config.mode == SamplingMode::Hold) {
+		for (auto& field : config.keyFields) {
+			define(field);
+		}
+	}
+	if (config.mode == SamplingMode::Priority) {
+		define(config.weightField);
+	}
+	if (config.mode == SamplingMode::Stratified) {
+		define(config.reservoir.stratumField);
+	}
+	return requiredFormat;
+}
+
+Sampler::Sampler(const SamplerConfig& config)
+	: m_mode(config.mode)
+	, m_samplingRate(config.samplingRate)
+	, m_period(static_cast<uint64_t>(config.samplingRate))
+	, m_threshold(config.threshold)
+	, m_random(config.seed)
+	, m_probability(1.0 / config.samplingRate)
+{
+	if (!(m_samplingRate >= 1)) {
+		throw std::invalid_argument("Sampling rate must be at least one.");
+	}
+	if (m_mode != SamplingMode::Random && m_mode != SamplingMode::Adaptive
+		&& m_mode != SamplingMode::Hold && static_cast<double>(m_period) != m_samplingRate) {
+		throw std::invalid_argument("Fractional sampling rate is supported only in the random and hold mode.");
+	}
+
+	if (m_mode == SamplingMode::Hash || m_mode == SamplingMode::Hold) {
+		m_flowKeyHasher.emplace(config.keyFields, config.normalizeDirection, config.seed);
+	}
+
+	if (m_mode == SamplingMode::Hold) {
+		m_flowTable.emplace(config.flowTableSize);
+	}
+
+	if (m_mode == SamplingMode::Stratified) {
+		m_reservoir.emplace(config.reservoir);
+	}
+
+	if (m_mode == SamplingMode::Adaptive) {
+		m_rateController.emplace(config.targetRate);
+		m_probability = m_rateController->probability();
+	}
+
+	if (m_mode == SamplingMode::Priority) {
+		if (!(m_threshold > 0)) {
+			throw std::invalid_argument("Priority sampling threshold must be higher than zero.");
+		}
+		m_weightField.emplace(config.weightField);
+	}
+
+	if (m_mode == SamplingMode::Random || m_mode == SamplingMode::Adaptive
+		|| m_mode == SamplingMode::Hold) {
+		setProbability(m_probability);
+	}
+}
+
+void Sampler::changeTemplate(const ur_template_t* unirecTemplate)
+{
+	if (m_flowKeyHasher) {
+		m_flowKeyHasher->changeTemplate(unirecTemplate);
+	}
+	if (m_weightField) {
+		m_weightField->checkTemplate(unirecTemplate);
+	}
+	if (m_reservoir) {
+		m_reservoir->changeTemplate(unirecTemplate);
+	}
+}
+
+bool Sampler::shouldBeSampled(const Nemea::UnirecRecordView& unirecRecordView)
+{
+	SamplerStats& stats = m_stats.local();
+	stats.totalRecords++;
+
+	bool sampled = false;
+	switch (m_mode) {
+	case SamplingMode::Count:
+		sampled = (stats.totalRecords % m_period) == 0;
+		break;
+	case SamplingMode::Hash:
+		sampled = (m_flowKeyHasher->hash(unirecRecordView) % m_period) == 0;
+		break;
+	case SamplingMode::Random:
+		sampled = sampleRandomly();
+		break;
+	case SamplingMode::Adaptive:
+		if (m_rateController->onRecord()) {
+			setProbability(m_rateController->probability());
+		}
+		sampled = sampleRandomly() && m_rateController->tryConsume();
+		break;
+	case SamplingMode::Priority:
+		sampled = samplePriority(m_weightField->get(unirecRecordView));
+		break;
+	case SamplingMode::Hold:
+		sampled = sampleAndHold(m_flowKeyHasher->hash(unirecRecordView));
+		break;
+	case SamplingMode::Stratified:
+		m_reservoir->offer(unirecRecordView);
+		break;
 	}
 
-	return false;
+	if (sampled) {
+		stats.sampledRecords++;
+	}
+	if (--m_recordsUntilPublish == 0) {
+		publishStats();
+	}
+	return sampled;
+}
+
+void Sampler::publishStats() noexcept
+{
+	SamplerStats& stats = m_stats.local();
+	stats.samplingProbability = m_probability;
+	if (m_rateController) {
+		stats.inputRate = m_rateController->inputRate();
+		stats.throttledRecords = m_rateController->throttledRecords();
+	}
+	if (m_flowTable) {
+		stats.flowTableCapacity = m_flowTable->capacity();
+		stats.flowTableSize = m_flowTable->size();
+		stats.flowTableEvictions = m_flowTable->evictions();
+	}
+	if (m_reservoir) {
+		const auto reservoirStats = m_reservoir->getStats();
+		stats.sampledRecords = reservoirStats.flushedRecords;
+		stats.maxStrata = reservoirStats.maxStrata;
+		stats.strata = reservoirStats.strata;
+		stats.droppedRecords = reservoirStats.droppedRecords;
+		stats.reservoirBytes = reservoirStats.usedBytes;
+	}
+
+	m_stats.publish();
+	m_recordsUntilPublish = PUBLISH_INTERVAL;
 }
 
 SamplerStats Sampler::getStats() const noexcept
 {
-	SamplerStats stats;
-	stats.totalRecords = m_totalRecords;
-	stats.sampledRecords = m_sampledRecords;
-	return stats;
+	return m_stats.snapshot();
+}
+
+bool Sampler::sampleAndHold(uint64_t flowKey) noexcept
+{
+	if (m_flowTable->lookup(flowKey)) {
+		m_stats.local().flowTableHits++;
+		return true;
+	}
+	if (!sampleRandomly()) {
+		return false;
+	}
+	m_flowTable->insert(flowKey);
+	return true;
+}
+
+bool Sampler::samplePriority(double weight) noexcept
+{
+	if (weight >= m_threshold) {
+		m_weight = 1;
+		return true;
+	}
+	if (!(weight > 0)) {
+		return false;
+	}
+
+	// nextDouble() is in (0, 1], so the record is sampled with probability weight / threshold
+	if (m_random.nextDouble() * m_threshold > weight) {
+		return false;
+	}
+	m_weight = m_threshold / weight;
+	return true;
+}
+
+bool Sampler::sampleRandomly() noexcept
+{
+	if (m_skip > 0) {
+		m_skip--;
+		return false;
+	}
+	m_skip = drawSkip();
+	return true;
+}
+
+void Sampler::setProbability(double probability) noexcept
+{
+	m_probability = probability;
+	m_logSkipProbability = std::log1p(-probability);
+	// the geometric distribution is memoryless, so the gap is simply redrawn
+	m_skip = drawSkip();
+}
+
+uint64_t Sampler::drawSkip() noexcept
+{
+	// probability 1 has zero probability of a skip, log(1 - p) is -inf
+	if (m_probability >= 1) {
+		return 0;
+	}
+
+	// inversion of the geometric distribution, number of failures before the first success
+	const double skip = std::floor(std::log(m_random.nextDouble()) / m_logSkipProbability);
+	if (skip >= static_cast<double>(std::numeric_limits<uint64_t>::max())) {
+		return std::numeric_limits<uint64_t>::max();
+	}
+	return static_cast<uint64_t>(skip);
 }
 
 } // namespace Sampler
@@ -8,16 +8,87 @@
 
 #pragma once
 
+#include "counters/counterBlock.hpp"
+#include "flowKeyHasher.hpp"
+#include "flowTable.hpp"
+#include "numericField.hpp"
+#include "rateController.hpp"
+#include "stratifiedReservoir.hpp"
+#include "xoshiro256.hpp"
+
 #include <cstdint>
+#include <optional>
+#include <string>
+#include <unirec++/unirec.hpp>
+#include <vector>
 
 namespace Sampler {
 
+/**
+ * @brief Method used to select the sampled records.
+ */
+enum class SamplingMode {
+	Count, ///< Every r-th record by arrival order.
+	Hash, ///< Records whose flow key hashes to zero modulo r.
+	Random, ///< Every record independently with probability 1/r.
+	Adaptive, ///< Random sampling with the probability adjusted to hold a target output rate.
+	Priority, ///< Records with probability proportional to a weight field, e.g. bytes.
+	Hold, ///< Records with probability 1/r and all later records of their flows.
+	Stratified, ///< A bounded number of records per stratum, e.g. source /24, and time window.
+};
+
+/**
+ * @brief Parses the name of a sampling mode.
+ * @throw std::invalid_argument If the name is unknown.
+ */
+SamplingMode parseSamplingMode(const std::string& name);
+
+/**
+ * @brief Configuration of the sampler.
+ */
+struct SamplerConfig {
+	SamplingMode mode = SamplingMode::Count; ///< Method used to select the sampled records.
+	double samplingRate = 1; ///< The 1:r sampling rate, fractional only in the random mode.
+	/// Fields of the flow key hashed in the hash mode.
+	std::vector<std::string> keyFields = {"SRC_IP", "DST_IP", "SRC_PORT", "DST_PORT", "PROTOCOL"};
+	bool normalizeDirection = true; ///< Whether both directions of a flow share the decision.
+	uint64_t seed = 0; ///< Seed of the flow key hash or of the random generator.
+	double targetRate = 0; ///< Target output rate in records per second of the adaptive mode.
+	std::string weightField = "BYTES"; ///< Field the priority mode samples proportionally to.
+	double threshold = 0; ///< Weight from which records are always sampled in the priority mode.
+	size_t flowTableSize = 65536; ///< Number of flows held in the sample-and-hold mode.
+	StratifiedReservoirConfig reservoir; ///< Strata and reservoirs of the stratified mode.
+};
+
+/**
+ * @brief Defines the Unirec fields the sampler of the configuration resolves on construction.
+ *
+ * Fields may be given as "type NAME" or by the name of a well-known field, the types are
+ * stripped from the configuration.
+ *
+ * @param config Configuration of the sampler.
+ * @return Comma-separated definitions of the fields in the form "type NAME".
+ * @throw std::invalid_argument If a field cannot be defined.
+ */
+std::string defineSamplerFields(SamplerConfig& config);
+
 /**
  * @brief Structure to hold sampling statistics.
  */
 struct SamplerStats {
 	uint64_t sampledRecords = 0;
 	uint64_t totalRecords = 0;
+	double samplingProbability = 1; ///< Currently applied probability that a record is sampled.
+	double inputRate = 0; ///< Smoothed input rate in records per second, adaptive mode only.
+	uint64_t throttledRecords = 0; ///< Sampled records dropped to hold the target rate.
+	size_t flowTableCapacity = 0; ///< Number of flows the table holds, sample-and-hold mode only.
+	size_t flowTableSize = 0; ///< Number of held flows.
+	uint64_t flowTableHits = 0; ///< Records forwarded because their flow is held.
+	uint64_t flowTableEvictions = 0; ///< Held flows evicted to make room for new ones.
+	size_t maxStrata = 0; ///< Maximal number of strata in a window, stratified mode only.
+	size_t strata = 0; ///< Number of strata in the current window.
+	uint64_t droppedRecords = 0; ///< Records not sampled because a memory bound was reached.
+	size_t reservoirBytes = 0; ///< Bytes of the reservoirs in the current window.
 };
 
 /**
@@ -26,10 +97,18 @@ struct SamplerStats {
 class Sampler {
 public:
 	/**
-	 * @brief Constructs a Sampler object with the given sampling rate.
-	 * @param samplingRate The 1:r rate at which records should be sampled.
+	 * @brief Constructs a Sampler object with the given configuration.
+	 * @param config Configuration of the sampler.
+	 * @throw std::invalid_argument If the configuration is invalid.
 	 */
-	explicit Sampler(std::size_t samplingRate);
+	explicit Sampler(const SamplerConfig& config);
+
+	/**
+	 * @brief Resolves the fields used by the sampler in a new template.
+	 * @param unirecTemplate Template of the received records.
+	 * @throw std::runtime_error If a field needed by the sampler is missing.
+	 */
+	void changeTemplate(const ur_template_t* unirecTemplate);
 
 	/**
 	 * @brief Determines whether the current record should be sampled.
@@ -37,21 +116,77 @@ public:
 	 * This function increments the total records counter and checks if the current record
 	 * should be sampled based on the sampling rate.
 	 *
-	 * Every -rth record will be sampled.
+	 * In the count mode, every -rth record will be sampled. In the hash mode, a record is sampled
+	 * if the hash of its flow key is zero modulo r, so all records of a flow share the decision
+	 * and every sampler instance with the same seed samples the same flows. In the random mode,
+	 * every record is sampled with probability 1/r. The number of records skipped before the
+	 * next sampled one is drawn from the geometric distribution, so only one random number is
+	 * drawn per sampled record and the other records just decrement a counter. The adaptive mode
+	 * samples randomly too, with the probability continuously adjusted by a RateController. The
+	 * priority mode samples a record with probability `min(1, weight / threshold)`, so large
+	 * flows are kept and small ones are sampled. The sample-and-hold mode forwards every record
+	 * of a flow held in the flow table and samples the other records randomly, the flow of
+	 * a sampled record enters the table. Large flows are thus captured almost entirely after
+	 * their first sampled record. In the stratified mode, records are offered to the reservoir
+	 * returned by getReservoir() and forwarded when its window ends, so this function returns
+	 * false.
 	 *
+	 * @param unirecRecordView The received record.
 	 * @return True if the current record should be sampled, false otherwise.
 	 */
-	bool shouldBeSampled() noexcept;
+	bool shouldBeSampled(const Nemea::UnirecRecordView& unirecRecordView);
+
+	/**
+	 * @brief Returns the renormalization weight of the last sampled record.
+	 *
+	 * The weight is the inverse of the probability the record was sampled with in the priority
+	 * mode and one in the other modes.
+	 */
+	double getWeight() const noexcept { return m_weight; }
+
+	/**
+	 * @brief Returns the reservoir of the stratified mode or nullptr in the other modes.
+	 */
+	StratifiedReservoir* getReservoir() noexcept { return m_reservoir ? &*m_reservoir : nullptr; }
+
+	/**
+	 * @brief Publishes the statistics to getStats().
+	 *
+	 * The statistics are published every 256 records, the owner of the sampler publishes them
+	 * also when the input is idle and after the reservoir is flushed.
+	 */
+	void publishStats() noexcept;
 
 	/**
-	 * @brief Returns the current sampling statistics.
+	 * @brief Returns the last published sampling statistics, can be called by any thread.
 	 */
 	SamplerStats getStats() const noexcept;
 
 private:
-	const std::size_t m_samplingRate;
-	uint64_t m_totalRecords = 0;
-	uint64_t m_sampledRecords = 0;
+	static constexpr uint64_t PUBLISH_INTERVAL = 256;
+
+	bool sampleAndHold(uint64_t flowKey) noexcept;
+	bool samplePriority(double weight) noexcept;
+	bool sampleRandomly() noexcept;
+	void setProbability(double probability) noexcept;
+	uint64_t drawSkip() noexcept;
+
+	const SamplingMode m_mode;
+	const double m_samplingRate;
+	const uint64_t m_period;
+	std::optional<FlowKeyHasher> m_flowKeyHasher;
+	std::optional<FlowTable> m_flowTable;
+	std::optional<StratifiedReservoir> m_reservoir;
+	std::optional<RateController> m_rateController;
+	std::optional<NumericField> m_weightField;
+	const double m_threshold;
+	double m_weight = 1;
+	Xoshiro256 m_random;
+	double m_probability;
+	double m_logSkipProbability = 0;
+	uint64_t m_skip = 0;
+	uint64_t m_recordsUntilPublish = PUBLISH_INTERVAL;
+	Nm::CounterBlock<SamplerStats> m_stats;
 };
 
 } // namespace Sampler
@@ -0,0 +1,172 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the SamplerStage class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "samplerStage.hpp"
+
+#include "factory/pluginFactoryRegistrator.hpp"
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace Sampler {
+
+namespace {
+
+double parseNumber(const std::string& name, const std::string& value)
+{
+	size_t parsedLength = 0;
+	double number = 0;
+	try {
+		number = std::stod(value, &parsedLength);
+	} catch (const std::exception&) {
+		parsedLength = 0;
+	}
+	if (parsedLength != value.size()) {
+		throw std::invalid_argument("SamplerStage: invalid value of " + name + ": '" + value + "'");
+	}
+	return number;
+}
+
+uint64_t parseInteger(const std::string& name, const std::string& value)
+{
+	size_t parsedLength = 0;
+	uint64_t number = 0;
+	try {
+		number = std::stoull(value, &parsedLength);
+	} catch (const std::exception&) {
+		parsedLength = 0;
+	}
+	if (parsedLength != value.size() || value.front() == '-') {
+		throw std::invalid_argument("SamplerStage: invalid value of " + name + ": '" + value + "'");
+	}
+	return number;
+}
+
+std::vector<std::string> parseKeyFields(const std::string& keyFields)
+{
+	std::vector<std::string> fieldNames;
+	std::istringstream stream(keyFields);
+	std::string fieldName;
+	while (std::getline(stream, fieldName, '/')) {
+		if (!fieldName.empty()) {
+			fieldNames.push_back(fieldName);
+		}
+	}
+	return fieldNames;
+}
+
+telemetry::Content getStageTelemetry(const Sampler& sampler)
+{
+	const auto stats = sampler.getStats();
+
+	telemetry::Dict dict;
+	dict["totalRecords"] = stats.totalRecords;
+	dict["sampledRecords"] = stats.sampledRecords;
+	dict["samplingProbability"] = stats.samplingProbability;
+	if (stats.inputRate > 0) {
+		dict["inputRate"] = telemetry::ScalarWithUnit {stats.inputRate, "records/s"};
+		dict["throttledRecords"] = stats.throttledRecords;
+	}
+	if (stats.flowTableCapacity > 0) {
+		dict["flowTableCapacity"] = uint64_t(stats.flowTableCapacity);
+		dict["flowTableSize"] = uint64_t(stats.flowTableSize);
+		dict["flowTableHits"] = stats.flowTableHits;
+		dict["flowTableEvictions"] = stats.flowTableEvictions;
+	}
+	if (stats.sampledRecords > 0) {
+		dict["effectiveRate"] = static_cast<double>(stats.totalRecords) / stats.sampledRecords;
+	}
+	return dict;
+}
+
+} // namespace
+
+SamplerStage::SamplerStage(const std::string& params)
+{
+	SamplerConfig config;
+	bool seedGiven = false;
+
+	for (const auto& [name, value] : parseParams(params)) {
+		if (name == "mode") {
+			config.mode = parseSamplingMode(value);
+		} else if (name == "rate") {
+			config.samplingRate = parseNumber(name, value);
+		} else if (name == "seed") {
+			config.seed = parseInteger(name, value);
+			seedGiven = true;
+		} else if (name == "keyFields") {
+			config.keyFields = parseKeyFields(value);
+		} else if (name == "directional") {
+			config.normalizeDirection = value != "true";
+		} else if (name == "targetRate") {
+			config.targetRate = parseNumber(name, value);
+		} else if (name == "tableSize") {
+			config.flowTableSize = parseInteger(name, value);
+		} else {
+			throw std::invalid_argument("SamplerStage: unknown parameter '" + name + "'");
+		}
+	}
+
+	if (config.mode == SamplingMode::Priority || config.mode == SamplingMode::Stratified) {
+		throw std::invalid_argument(
+			"SamplerStage: the priority and stratified modes cannot be used in a chain");
+	}
+	if (config.mode != SamplingMode::Count && config.mode != SamplingMode::Hash && !seedGiven) {
+		std::random_device randomDevice;
+		config.seed = (uint64_t(randomDevice()) << 32) | randomDevice();
+	}
+
+	// the sampler resolves the field ids on construction, before the chain sets the required
+	// format of its input
+	m_requiredFormat = defineSamplerFields(config);
+	m_sampler = std::make_unique<Sampler>(config);
+}
+
+void SamplerStage::endRound(bool idle)
+{
+	if (idle) {
+		m_sampler->publishStats();
+	}
+}
+
+void SamplerStage::setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory)
+{
+	const telemetry::FileOps fileOps
+		= {[this]() { return getStageTelemetry(*m_sampler); }, nullptr};
+	m_holder.add(directory->addFile("stats", fileOps));
+}
+
+static void samplerStageUsage()
+{
+	std::cout << "sampler\n";
+	std::cout << "  Usage: sampler:mode=MODE,rate=RATE,...\n";
+	std::cout << "  Parameters:\n";
+	std::cout << "    mode         count, hash, random, adaptive or hold. [default: count]\n";
+	std::cout << "    rate         The 1:r sampling rate. [default: 1]\n";
+	std::cout << "    seed         Seed of the flow key hash or of the random generator.\n";
+	std::cout << "    keyFields    Flow key fields separated by '/', given as 'type NAME' unless "
+				 "well known, e.g. 'keyFields=uint32 DST_ASN/SRC_IP'. "
+				 "[default: SRC_IP/DST_IP/SRC_PORT/DST_PORT/PROTOCOL]\n";
+	std::cout << "    directional  Hash both directions of a flow separately. [default: false]\n";
+	std::cout << "    targetRate   Target output rate in records/s of the adaptive mode.\n";
+	std::cout << "    tableSize    Number of flows held in the hold mode. [default: 65536]\n";
+}
+
+static Nm::PluginManifest g_samplerStageManifest {
+	"sampler",
+	"Passes the records sampled at the given rate.",
+	"1.0.0",
+	samplerStageUsage,
+};
+
+static Nm::PluginFactoryRegistrator<Nm::Stage, SamplerStage>
+	g_samplerStageRegistration(g_samplerStageManifest);
+
+} // namespace Sampler
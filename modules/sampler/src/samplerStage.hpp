@@ -0,0 +1,58 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the SamplerStage class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "sampler.hpp"
+#include "stage/stage.hpp"
+
+#include <memory>
+#include <string>
+
+namespace Sampler {
+
+/**
+ * @brief Stage of a chain passing the sampled records.
+ *
+ * Parameters: `mode`, `rate`, `seed`, `keyFields` separated by '/', `directional`, `targetRate`
+ * and `tableSize` with the meaning of the sampler options. The priority mode is not supported,
+ * because its renormalized records differ from the received ones, neither is the stratified
+ * mode, whose records are sent when the window ends.
+ */
+class SamplerStage : public Nm::Stage {
+public:
+	/**
+	 * @brief Constructs the sampler from the parameters.
+	 * @param params Parameters of the stage.
+	 * @throw std::invalid_argument If the parameters are invalid.
+	 */
+	explicit SamplerStage(const std::string& params);
+
+	std::string getRequiredFormat() const override { return m_requiredFormat; }
+
+	void changeTemplate(const ur_template_t* unirecTemplate) override
+	{
+		m_sampler->changeTemplate(unirecTemplate);
+	}
+
+	bool processRecord(const Nemea::UnirecRecordView& unirecRecordView) override
+	{
+		return m_sampler->shouldBeSampled(unirecRecordView);
+	}
+
+	void endRound(bool idle) override;
+
+	void setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory) override;
+
+private:
+	std::unique_ptr<Sampler> m_sampler;
+	std::string m_requiredFormat;
+	telemetry::Holder m_holder;
+};
+
+} // namespace Sampler
@@ -0,0 +1,200 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the StratifiedReservoir class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "stratifiedReservoir.hpp"
+
+#include <arpa/inet.h>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint64_t PRIME1 = 0x9E3779B97F4A7C15ULL;
+constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+
+constexpr uint64_t prefixMask64(unsigned prefixLength) noexcept
+{
+	if (prefixLength == 0) {
+		return 0;
+	}
+	return prefixLength >= 64 ? ~uint64_t(0) : ~uint64_t(0) << (64 - prefixLength);
+}
+
+uint64_t hashKey(uint64_t high, uint64_t low) noexcept
+{
+	uint64_t hash = (high * PRIME1) ^ low;
+	hash *= PRIME2;
+	return hash ^ (hash >> 29);
+}
+
+} // namespace
+
+namespace Sampler {
+
+StratifiedReservoir::StratifiedReservoir(
+	const StratifiedReservoirConfig& config,
+	Clock::time_point now)
+	: m_reservoirSize(config.reservoirSize)
+	, m_maxStrata(config.maxStrata)
+	, m_windowLength(config.windowLength)
+	, m_windowEnd(now + config.windowLength)
+	, m_arena(config.memoryLimit)
+	, m_random(config.seed)
+{
+	const int fieldId = ur_get_id_by_name(config.stratumField.c_str());
+	if (fieldId < 0) {
+		throw std::invalid_argument("Unknown stratum field '" + config.stratumField + "'");
+	}
+	m_fieldId = static_cast<ur_field_id_t>(fieldId);
+	if (ur_get_type(m_fieldId) != UR_TYPE_IP) {
+		throw std::invalid_argument("Stratum field '" + config.stratumField + "' is not an IP address");
+	}
+	if (config.prefixLength4 > 32 || config.prefixLength6 > 128) {
+		throw std::invalid_argument("Invalid stratum prefix length");
+	}
+	if (m_reservoirSize == 0 || m_maxStrata == 0) {
+		throw std::invalid_argument("Reservoir size and number of strata must be higher than zero.");
+	}
+	if (m_reservoirSize * sizeof(StoredRecord) > RecordArena::CHUNK_SIZE) {
+		throw std::invalid_argument("Reservoir size is too large.");
+	}
+	if (m_windowLength.count() <= 0) {
+		throw std::invalid_argument("Window length must be higher than zero.");
+	}
+
+	m_prefixMask4 = static_cast<uint32_t>(prefixMask64(config.prefixLength4) >> 32);
+	m_prefixMask6High = prefixMask64(config.prefixLength6);
+	m_prefixMask6Low = config.prefixLength6 > 64 ? prefixMask64(config.prefixLength6 - 64) : 0;
+
+	// load factor at most one half keeps the probe sequences short
+	size_t slots = 1;
+	while (slots < 2 * m_maxStrata) {
+		slots *= 2;
+	}
+	m_slots.assign(slots, EMPTY_SLOT);
+	m_usedSlots.reserve(m_maxStrata);
+	m_strata.reserve(m_maxStrata);
+}
+
+void StratifiedReservoir::changeTemplate(const ur_template_t* unirecTemplate)
+{
+	if (!ur_is_present(unirecTemplate, m_fieldId)) {
+		throw std::runtime_error(
+			std::string("Stratum field '") + ur_get_name(m_fieldId)
+			+ "' is missing in the input template");
+	}
+	m_template = unirecTemplate;
+}
+
+void StratifiedReservoir::offer(const Nemea::UnirecRecordView& unirecRecordView)
+{
+	Stratum* stratum = findStratum(stratumKey(unirecRecordView));
+	if (stratum == nullptr) {
+		m_droppedRecords++;
+		return;
+	}
+
+	StoredRecord* records = stratum->records;
+	const uint64_t seen = ++stratum->seen;
+	if (seen <= m_reservoirSize) {
+		records[seen - 1] = {nullptr, 0};
+		store(records[seen - 1], unirecRecordView);
+		return;
+	}
+
+	// algorithm R, the record replaces a uniformly chosen one with probability size / seen
+	const auto index = static_cast<uint64_t>(
+		std::ceil(m_random.nextDouble() * static_cast<double>(seen)) - 1);
+	if (index < m_reservoirSize) {
+		store(records[index], unirecRecordView);
+	}
+}
+
+StratifiedReservoirStats StratifiedReservoir::getStats() const noexcept
+{
+	StratifiedReservoirStats stats;
+	stats.flushedRecords = m_flushedRecords;
+	stats.droppedRecords = m_droppedRecords;
+	stats.strata = m_strata.size();
+	stats.maxStrata = m_maxStrata;
+	stats.usedBytes = m_arena.usedBytes();
+	stats.reservedBytes = m_arena.reservedBytes();
+	return stats;
+}
+
+StratifiedReservoir::StratumKey
+StratifiedReservoir::stratumKey(const Nemea::UnirecRecordView& unirecRecordView) const
+{
+	const ip_addr_t address = unirecRecordView.getFieldAsType<Nemea::IpAddress>(m_fieldId).ip;
+	if (ip_is4(&address)) {
+		// the high word distinguishes IPv4 strata from the IPv6 ones
+		return {~uint64_t(0), ip_get_v4_as_int(&address) & m_prefixMask4};
+	}
+
+	const uint64_t high = (uint64_t(ntohl(address.ui32[0])) << 32) | ntohl(address.ui32[1]);
+	const uint64_t low = (uint64_t(ntohl(address.ui32[2])) << 32) | ntohl(address.ui32[3]);
+	return {high & m_prefixMask6High, low & m_prefixMask6Low};
+}
+
+StratifiedReservoir::Stratum* StratifiedReservoir::findStratum(const StratumKey& key)
+{
+	const size_t mask = m_slots.size() - 1;
+	size_t slot = hashKey(key.high, key.low) & mask;
+	while (m_slots[slot] != EMPTY_SLOT) {
+		Stratum& stratum = m_strata[m_slots[slot]];
+		if (stratum.key == key) {
+			return &stratum;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	if (m_strata.size() == m_maxStrata) {
+		return nullptr;
+	}
+	auto* records = reinterpret_cast<StoredRecord*>(
+		m_arena.allocate(m_reservoirSize * sizeof(StoredRecord), alignof(StoredRecord)));
+	if (records == nullptr) {
+		return nullptr;
+	}
+
+	m_slots[slot] = static_cast<uint32_t>(m_strata.size());
+	m_usedSlots.push_back(slot);
+	m_strata.push_back({key, 0, records});
+	return &m_strata.back();
+}
+
+void StratifiedReservoir::store(
+	StoredRecord& storedRecord,
+	const Nemea::UnirecRecordView& unirecRecordView)
+{
+	const size_t size = unirecRecordView.size();
+	if (size > storedRecord.capacity) {
+		std::byte* memory = m_arena.allocate(size);
+		if (memory == nullptr) {
+			// the previously stored record, if any, is kept
+			m_droppedRecords++;
+			return;
+		}
+		storedRecord = {memory, size};
+	}
+	std::memcpy(storedRecord.data, unirecRecordView.data(), size);
+}
+
+void StratifiedReservoir::startWindow(Clock::time_point now) noexcept
+{
+	for (const size_t slot : m_usedSlots) {
+		m_slots[slot] = EMPTY_SLOT;
+	}
+	m_usedSlots.clear();
+	m_strata.clear();
+	m_arena.reset();
+	m_windowEnd = now + m_windowLength;
+}
+
+} // namespace Sampler
@@ -0,0 +1,171 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the StratifiedReservoir class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "recordArena.hpp"
+#include "xoshiro256.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unirec++/unirec.hpp>
+#include <vector>
+
+namespace Sampler {
+
+/**
+ * @brief Configuration of the stratified reservoir.
+ */
+struct StratifiedReservoirConfig {
+	std::string stratumField = "SRC_IP"; ///< IP address field the strata are derived from.
+	unsigned prefixLength4 = 24; ///< Prefix length of IPv4 strata.
+	unsigned prefixLength6 = 64; ///< Prefix length of IPv6 strata.
+	size_t reservoirSize = 100; ///< Maximal number of records sampled per stratum and window.
+	size_t maxStrata = 65536; ///< Maximal number of strata in a window.
+	size_t memoryLimit = 256 << 20; ///< Maximal number of bytes of the reservoirs.
+	std::chrono::milliseconds windowLength = std::chrono::seconds(60); ///< Length of a window.
+	uint64_t seed = 0; ///< Seed of the random generator.
+};
+
+/**
+ * @brief Statistics of the stratified reservoir.
+ */
+struct StratifiedReservoirStats {
+	uint64_t flushedRecords = 0; ///< Records forwarded at the ends of windows.
+	uint64_t droppedRecords = 0; ///< Records not sampled because a memory bound was reached.
+	size_t strata = 0; ///< Number of strata in the current window.
+	size_t maxStrata = 0; ///< Maximal number of strata in a window.
+	size_t usedBytes = 0; ///< Bytes of the reservoirs in the current window.
+	size_t reservedBytes = 0; ///< Bytes held by the arena.
+};
+
+/**
+ * @brief Keeps a uniform sample of a bounded size per stratum over time windows.
+ *
+ * Records are divided into strata by the network prefix of an IP address field, for example the
+ * /24 of the source address, and every stratum keeps a reservoir of at most `reservoirSize`
+ * records chosen uniformly from all of its records in the window. At the end of the window,
+ * all reservoirs are flushed, so the output volume is bounded and small strata are covered as
+ * well as large ones.
+ *
+ * Strata live in an open-addressed hash table with a fixed number of entries, their reservoirs
+ * and the record copies are allocated from a pooled RecordArena, so the memory is bounded and
+ * allocated from the heap only once.
+ * Records of new strata are dropped when the table is full and sampled records are dropped
+ * when the arena is exhausted.
+ */
+class StratifiedReservoir {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Constructs an empty reservoir.
+	 * @throw std::invalid_argument If the configuration is invalid.
+	 */
+	explicit StratifiedReservoir(
+		const StratifiedReservoirConfig& config,
+		Clock::time_point now = Clock::now());
+
+	/**
+	 * @brief Resolves the stratum field in a new template.
+	 *
+	 * The stored records have to be flushed before the template of the received records is
+	 * changed, because they are sent with the current template.
+	 *
+	 * @throw std::runtime_error If the stratum field is missing in the template.
+	 */
+	void changeTemplate(const ur_template_t* unirecTemplate);
+
+	/**
+	 * @brief Offers a received record to the reservoir of its stratum.
+	 */
+	void offer(const Nemea::UnirecRecordView& unirecRecordView);
+
+	/**
+	 * @brief Returns whether the current window has ended.
+	 */
+	bool windowEnded(Clock::time_point now) const noexcept { return now >= m_windowEnd; }
+
+	/**
+	 * @brief Passes every stored record to the callback and starts a new window.
+	 * @param now Current time.
+	 * @param send Callback called with a `Nemea::UnirecRecordView&` of every stored record.
+	 */
+	template <typename Callback>
+	void flush(Clock::time_point now, Callback&& send)
+	{
+		for (const Stratum& stratum : m_strata) {
+			const size_t stored = std::min<uint64_t>(stratum.seen, m_reservoirSize);
+			for (size_t index = 0; index < stored; index++) {
+				if (stratum.records[index].data == nullptr) {
+					continue;
+				}
+				Nemea::UnirecRecordView view(stratum.records[index].data, m_template);
+				send(view);
+				m_flushedRecords++;
+			}
+		}
+		startWindow(now);
+	}
+
+	/**
+	 * @brief Returns the current statistics.
+	 */
+	StratifiedReservoirStats getStats() const noexcept;
+
+private:
+	struct StratumKey {
+		uint64_t high;
+		uint64_t low;
+		bool operator==(const StratumKey& other) const noexcept
+		{
+			return high == other.high && low == other.low;
+		}
+	};
+
+	struct StoredRecord {
+		std::byte* data;
+		size_t capacity;
+	};
+
+	struct Stratum {
+		StratumKey key;
+		uint64_t seen;
+		StoredRecord* records; ///< Reservoir of the stratum allocated from the arena.
+	};
+
+	static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+	StratumKey stratumKey(const Nemea::UnirecRecordView& unirecRecordView) const;
+	Stratum* findStratum(const StratumKey& key);
+	void store(StoredRecord& storedRecord, const Nemea::UnirecRecordView& unirecRecordView);
+	void startWindow(Clock::time_point now) noexcept;
+
+	ur_field_id_t m_fieldId;
+	const ur_template_t* m_template = nullptr;
+	uint32_t m_prefixMask4;
+	uint64_t m_prefixMask6High;
+	uint64_t m_prefixMask6Low;
+	const size_t m_reservoirSize;
+	const size_t m_maxStrata;
+	const std::chrono::milliseconds m_windowLength;
+	Clock::time_point m_windowEnd;
+
+	std::vector<uint32_t> m_slots; ///< Hash table of indexes of the strata.
+	std::vector<size_t> m_usedSlots;
+	std::vector<Stratum> m_strata;
+	RecordArena m_arena;
+	Xoshiro256 m_random;
+
+	uint64_t m_flushedRecords = 0;
+	uint64_t m_droppedRecords = 0;
+};
+
+} // namespace Sampler
@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the Xoshiro256 pseudo-random generator.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace Sampler {
+
+/**
+ * @brief Fast non-cryptographic pseudo-random generator xoshiro256**.
+ *
+ * The state is expanded from a 64-bit seed by splitmix64, so any seed, including zero, gives a
+ * well-mixed state.
+ */
+class Xoshiro256 {
+public:
+	/**
+	 * @brief Constructs the generator from a seed.
+	 */
+	explicit Xoshiro256(uint64_t seed) noexcept
+	{
+		for (auto& word : m_state) {
+			seed += 0x9E3779B97F4A7C15ULL;
+			uint64_t mixed = seed;
+			mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+			word = mixed ^ (mixed >> 31);
+		}
+	}
+
+	/**
+	 * @brief Returns the next 64-bit pseudo-random value.
+	 */
+	uint64_t next() noexcept
+	{
+		const uint64_t result = rotateLeft(m_state[1] * 5, 7) * 9;
+		const uint64_t shifted = m_state[1] << 17;
+
+		m_state[2] ^= m_state[0];
+		m_state[3] ^= m_state[1];
+		m_state[1] ^= m_state[2];
+		m_state[0] ^= m_state[3];
+		m_state[2] ^= shifted;
+		m_state[3] = rotateLeft(m_state[3], 45);
+
+		return result;
+	}
+
+	/**
+	 * @brief Returns a pseudo-random value uniformly distributed in the interval (0, 1].
+	 */
+	double nextDouble() noexcept
+	{
+		// 53 random bits fill the mantissa, zero is excluded so the value can be logarithmized
+		return static_cast<double>((next() >> 11) + 1) * 0x1.0p-53;
+	}
+
+private:
+	static uint64_t rotateLeft(uint64_t value, unsigned bits) noexcept
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	std::array<uint64_t, 4> m_state;
+};
+
+} // namespace Sampler
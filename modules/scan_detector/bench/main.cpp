@@ -0,0 +1,324 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Throughput and detection benchmark of the scan detector
+ *
+ * Generates a synthetic flow mix in process, feeds it straight into the detection core and
+ * reports the throughput, the peak memory, the detection latency and the precision and recall
+ * against the planted scanners.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "CircBuff.hpp"
+#include "logger/logger.hpp"
+#include "partitionedDetector.hpp"
+#include "scanDetector.hpp"
+#include "trafficGenerator.hpp"
+
+#include <algorithm>
+#include <argparse/argparse.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <sys/resource.h>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Detection reported by the detector.
+ */
+struct Detection {
+	ip_addr_t source;
+	uint8_t prefixLength;
+	uint64_t detectTime;
+};
+
+/**
+ * @brief Returns the peak resident set size of the process in kB.
+ */
+long peakRss()
+{
+	struct rusage usage {};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+/**
+ * @brief Feeds the records into the detector through a window of the given size.
+ *
+ * At the end, the time is advanced past the inactivity timeout, so every suspect is finalized.
+ */
+template <typename Detector>
+void feedRecords(
+	Detector& detector,
+	const std::vector<ScanBench::GeneratedRecord>& records,
+	int windowSize,
+	uint64_t inactiveTimeout)
+{
+	CircularBuffer window(windowSize);
+	uint64_t now = 0;
+	for (const auto& record : records) {
+		if (record.time != now) {
+			now = record.time;
+			detector.advanceTime(now);
+		}
+
+		detector.addRecord(record.flow);
+		const std::optional<ScanDetector::FlowRecord> evicted = window.buffInsert(record.flow);
+		if (evicted) {
+			detector.removeRecord(*evicted);
+		}
+	}
+
+	detector.advanceTime(now + 2 * inactiveTimeout + 1);
+}
+
+double percentile(std::vector<uint64_t> values, double ratio)
+{
+	if (values.empty()) {
+		return 0;
+	}
+	std::sort(values.begin(), values.end());
+	const auto index = static_cast<size_t>(ratio * static_cast<double>(values.size() - 1));
+	return static_cast<double>(values[index]);
+}
+
+const char* actorName(ScanBench::ActorType type)
+{
+	switch (type) {
+	case ScanBench::ActorType::Horizontal:
+		return "horizontal";
+	case ScanBench::ActorType::Vertical:
+		return "vertical";
+	default:
+		return "slow";
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	argparse::ArgumentParser program("Scan Detector benchmark");
+
+	Nm::loggerInit();
+
+	ScanBench::TrafficConfig traffic;
+	ScanDetector::ScanDetectorConfig config;
+	size_t workers = 0;
+	int windowSize = 1'000'000;
+
+	try {
+		program.add_argument("--records")
+			.help("number of generated records")
+			.default_value(uint64_t(2'000'000))
+			.scan<'u', uint64_t>();
+		program.add_argument("--duration")
+			.help("seconds of simulated time covered by the records")
+			.default_value(uint64_t(600))
+			.scan<'u', uint64_t>();
+		program.add_argument("--clients")
+			.help("number of benign clients")
+			.default_value(size_t(50'000))
+			.scan<'u', size_t>();
+		program.add_argument("--servers")
+			.help("number of servers contacted by the clients")
+			.default_value(size_t(2'000))
+			.scan<'u', size_t>();
+		program.add_argument("--horizontal")
+			.help("number of horizontal scanners")
+			.default_value(size_t(20))
+			.scan<'u', size_t>();
+		program.add_argument("--vertical")
+			.help("number of vertical scanners")
+			.default_value(size_t(5))
+			.scan<'u', size_t>();
+		program.add_argument("--slow")
+			.help("number of slow scanners")
+			.default_value(size_t(5))
+			.scan<'u', size_t>();
+		program.add_argument("--slow-interval")
+			.help("seconds between two probes of a slow scanner")
+			.default_value(uint64_t(30))
+			.scan<'u', uint64_t>();
+		program.add_argument("--scan-share")
+			.help("ratio of records sent by the fast scanners")
+			.default_value(0.01)
+			.scan<'g', double>();
+		program.add_argument("--flood-share")
+			.help("ratio of records of a flood with spoofed sources")
+			.default_value(0.05)
+			.scan<'g', double>();
+		program.add_argument("--seed")
+			.help("seed of the traffic generator")
+			.default_value(uint32_t(1))
+			.scan<'u', uint32_t>();
+		program.add_argument("--window")
+			.help("number of records in the window of the detector")
+			.default_value(1'000'000)
+			.scan<'i', int>();
+		program.add_argument("--workers")
+			.help("number of worker threads, records are processed by the main thread if 0")
+			.default_value(size_t(0))
+			.scan<'u', size_t>();
+		program.add_argument("--max-sources")
+			.help("maximal number of tracked IP addresses")
+			.default_value(config.maxSources)
+			.scan<'u', size_t>();
+		program.add_argument("--max-suspects")
+			.help("maximal number of tracked suspicious IP addresses")
+			.default_value(config.maxSuspects)
+			.scan<'u', size_t>();
+		program.add_argument("--max-subnets")
+			.help("maximal number of tracked subnets, subnet aggregation is disabled if 0")
+			.default_value(config.maxSubnets)
+			.scan<'u', size_t>();
+
+		program.parse_args(argc, argv);
+
+		traffic.records = program.get<uint64_t>("--records");
+		traffic.duration = std::max<uint64_t>(program.get<uint64_t>("--duration"), 1);
+		traffic.clients = std::max<size_t>(program.get<size_t>("--clients"), 1);
+		traffic.servers = std::max<size_t>(program.get<size_t>("--servers"), 2);
+		traffic.horizontalScanners = program.get<size_t>("--horizontal");
+		traffic.verticalScanners = program.get<size_t>("--vertical");
+		traffic.slowScanners = program.get<size_t>("--slow");
+		traffic.slowInterval = std::max<uint64_t>(program.get<uint64_t>("--slow-interval"), 1);
+		traffic.scanShare = program.get<double>("--scan-share");
+		traffic.floodShare = program.get<double>("--flood-share");
+		traffic.seed = program.get<uint32_t>("--seed");
+		windowSize = std::max(program.get<int>("--window"), 1);
+		workers = program.get<size_t>("--workers");
+		config.maxSources = program.get<size_t>("--max-sources");
+		config.maxSuspects = program.get<size_t>("--max-suspects");
+		config.maxSubnets = program.get<size_t>("--max-subnets");
+	} catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		std::cerr << program;
+		return EXIT_FAILURE;
+	}
+
+	ScanBench::TrafficGenerator generator(traffic);
+	const std::vector<ScanBench::GeneratedRecord> records = generator.generate();
+	if (records.empty()) {
+		std::cerr << "No records generated" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::mutex detectionsMutex;
+	std::vector<Detection> detections;
+	auto onReport = [&](const ScanDetector::ScannerReport& report) {
+		const std::lock_guard<std::mutex> lock(detectionsMutex);
+		detections.push_back({report.source, report.sourcePrefixLength, report.detectTime});
+	};
+
+	ScanDetector::PartitionStats partitionStats;
+	const long rssBefore = peakRss();
+	const auto start = std::chrono::steady_clock::now();
+	try {
+		const uint64_t startTime = records.front().time;
+		if (workers > 0) {
+			ScanDetector::PartitionedDetector detector(config, workers, startTime, onReport);
+			feedRecords(detector, records, windowSize, config.inactiveTimeout);
+			// the pause waits until the workers process all queued events
+			detector.pause();
+			partitionStats = detector.getPartitionStats();
+			detector.resume();
+		} else {
+			ScanDetector::ScanDetector detector(config, startTime);
+			detector.setReportCallback(onReport);
+			feedRecords(detector, records, windowSize, config.inactiveTimeout);
+		}
+	} catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	const long rssAfter = peakRss();
+
+	// a scanner counts as detected by its first host report
+	const auto& scanners = generator.scanners();
+	std::vector<uint64_t> detectedAt(scanners.size(), 0);
+	size_t hostReports = 0;
+	size_t truePositives = 0;
+	size_t subnetReports = 0;
+	for (const auto& detection : detections) {
+		const bool isHost = detection.prefixLength == 0 || detection.prefixLength == 32
+			|| detection.prefixLength == 128;
+		if (!isHost) {
+			subnetReports++;
+			continue;
+		}
+		hostReports++;
+		const int scanner = generator.findScanner(detection.source);
+		if (scanner < 0) {
+			continue;
+		}
+		truePositives++;
+		if (detectedAt[scanner] == 0 || detection.detectTime < detectedAt[scanner]) {
+			detectedAt[scanner] = detection.detectTime;
+		}
+	}
+
+	std::vector<uint64_t> latencies;
+	size_t activeScanners = 0;
+	std::cout << std::fixed << std::setprecision(3);
+	for (const auto type :
+		 {ScanBench::ActorType::Horizontal, ScanBench::ActorType::Vertical, ScanBench::ActorType::Slow}) {
+		size_t total = 0;
+		size_t detected = 0;
+		for (size_t i = 0; i < scanners.size(); i++) {
+			if (scanners[i].type != type || scanners[i].probes == 0) {
+				continue;
+			}
+			total++;
+			if (detectedAt[i] != 0) {
+				detected++;
+				latencies.push_back(detectedAt[i] - scanners[i].firstSeen);
+			}
+		}
+		activeScanners += total;
+		if (total > 0) {
+			std::cout << "recall " << actorName(type) << ": " << detected << "/" << total << "\n";
+		}
+	}
+
+	size_t detectedScanners = latencies.size();
+	const double recall = activeScanners > 0
+		? static_cast<double>(detectedScanners) / static_cast<double>(activeScanners)
+		: 0;
+	const double precision = hostReports > 0
+		? static_cast<double>(truePositives) / static_cast<double>(hostReports)
+		: 0;
+
+	std::cout << "records: " << records.size() << "\n";
+	std::cout << "elapsed: " << elapsed.count() << " s\n";
+	std::cout << "throughput: " << std::setprecision(0)
+			  << static_cast<double>(records.size()) / elapsed.count() << " records/s\n";
+	std::cout << "peak RSS: " << rssAfter << " kB (" << rssAfter - rssBefore
+			  << " kB above the generated traffic)\n";
+	std::cout << std::setprecision(3);
+	std::cout << "precision: " << precision << " (" << truePositives << "/" << hostReports
+			  << " host reports)\n";
+	std::cout << "recall: " << recall << " (" << detectedScanners << "/" << activeScanners
+			  << " scanners)\n";
+	std::cout << "subnet reports: " << subnetReports << "\n";
+	if (partitionStats.processedEvents > 0) {
+		// an even spread gives every worker 1/workers of the events
+		std::cout << "busiest worker: "
+				  << static_cast<double>(partitionStats.busiestWorkerEvents)
+				/ static_cast<double>(partitionStats.processedEvents)
+				  << " of " << partitionStats.processedEvents << " events (even spread "
+				  << 1.0 / static_cast<double>(workers) << ")\n";
+	}
+	std::cout << std::setprecision(0);
+	std::cout << "detection latency: p50 " << percentile(latencies, 0.5) << " s, p95 "
+			  << percentile(latencies, 0.95) << " s, max " << percentile(latencies, 1.0) << " s\n";
+
+	return EXIT_SUCCESS;
+}
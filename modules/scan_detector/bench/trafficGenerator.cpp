@@ -0,0 +1,189 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Implementation of the TrafficGenerator class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "trafficGenerator.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <utility>
+
+namespace {
+
+constexpr uint8_t TCP_SYN = 0x02;
+constexpr uint8_t TCP_SYN_RST = 0x06;
+constexpr uint8_t TCP_ESTABLISHED = 0x1b;
+
+constexpr uint32_t CLIENT_NETWORK = 0x0a000000; // 10.0.0.0/8
+constexpr uint32_t SERVER_NETWORK = 0xc0a80000; // 192.168.0.0/16
+constexpr uint32_t SCANNER_NETWORK = 0x64400000; // 100.64.0.0/10
+constexpr uint32_t TARGET_NETWORK = 0xac100000; // 172.16.0.0/12
+constexpr uint32_t TARGET_HOSTS = 1U << 20;
+
+constexpr uint16_t SERVICE_PORTS[] = {443, 80, 53, 22, 25, 993};
+constexpr uint16_t SCANNED_PORTS[] = {22, 23, 445, 3389, 8080, 5900};
+
+} // namespace
+
+namespace ScanBench {
+
+TrafficGenerator::TrafficGenerator(const TrafficConfig& config)
+	: m_config(config)
+	, m_random(config.seed)
+{
+	auto plant = [this](ActorType type) {
+		Scanner scanner;
+		// every scanner gets its own /24, so subnet aggregation does not merge them
+		scanner.address = ip_from_int(SCANNER_NETWORK + (uint32_t(m_scanners.size()) << 8) + 1);
+		scanner.type = type;
+		scanner.sweepBase = static_cast<uint32_t>(m_random() % TARGET_HOSTS);
+		scanner.port = SCANNED_PORTS[m_random() % std::size(SCANNED_PORTS)];
+		if (type == ActorType::Vertical) {
+			for (size_t i = 0; i < m_config.verticalTargets; i++) {
+				scanner.targets.push_back(
+					ip_from_int(TARGET_NETWORK + static_cast<uint32_t>(m_random() % TARGET_HOSTS)));
+			}
+			scanner.ports.resize(65535);
+			std::iota(scanner.ports.begin(), scanner.ports.end(), uint16_t(1));
+			std::shuffle(scanner.ports.begin(), scanner.ports.end(), m_random);
+		}
+		if (type == ActorType::Slow) {
+			scanner.nextProbe = m_config.startTime + m_random() % m_config.slowInterval;
+		} else {
+			m_fastScanners.push_back(m_scanners.size());
+		}
+		m_scannerIndex.emplace(scanner.address, static_cast<int>(m_scanners.size()));
+		m_scanners.push_back(std::move(scanner));
+	};
+
+	for (size_t i = 0; i < config.horizontalScanners; i++) {
+		plant(ActorType::Horizontal);
+	}
+	for (size_t i = 0; i < config.verticalScanners; i++) {
+		plant(ActorType::Vertical);
+	}
+	for (size_t i = 0; i < config.slowScanners; i++) {
+		plant(ActorType::Slow);
+	}
+}
+
+int TrafficGenerator::findScanner(const ip_addr_t& address) const
+{
+	const auto iter = m_scannerIndex.find(address);
+	return iter != m_scannerIndex.end() ? iter->second : -1;
+}
+
+std::vector<GeneratedRecord> TrafficGenerator::generate()
+{
+	std::vector<GeneratedRecord> records;
+	records.reserve(m_config.records + 1);
+
+	std::uniform_real_distribution<double> share(0, 1);
+	while (records.size() < m_config.records) {
+		const uint64_t time
+			= m_config.startTime + records.size() * m_config.duration / m_config.records;
+
+		bool emitted = false;
+		for (auto& scanner : m_scanners) {
+			if (scanner.type == ActorType::Slow && scanner.nextProbe <= time) {
+				emitProbe(records, scanner, time);
+				scanner.nextProbe += m_config.slowInterval;
+				emitted = true;
+			}
+		}
+		if (emitted) {
+			continue;
+		}
+
+		const double draw = share(m_random);
+		if (draw < m_config.scanShare && !m_fastScanners.empty()) {
+			emitProbe(records, m_scanners[m_fastScanners[m_random() % m_fastScanners.size()]], time);
+		} else if (draw < m_config.scanShare + m_config.floodShare) {
+			emitFlood(records, time);
+		} else {
+			emitBackground(records, time);
+		}
+	}
+
+	records.resize(m_config.records);
+	return records;
+}
+
+void TrafficGenerator::emitBackground(std::vector<GeneratedRecord>& records, uint64_t time)
+{
+	std::uniform_real_distribution<double> share(0, 1);
+
+	GeneratedRecord record {};
+	record.time = time;
+	record.flow.src = ip_from_int(CLIENT_NETWORK + static_cast<uint32_t>(m_random() % m_config.clients));
+	record.flow.dst = ip_from_int(SERVER_NETWORK + static_cast<uint32_t>(m_random() % m_config.servers));
+	record.flow.dstPort = SERVICE_PORTS[m_random() % std::size(SERVICE_PORTS)];
+
+	if (share(m_random) < m_config.failureRatio) {
+		record.flow.tcpFlags = TCP_SYN_RST;
+		records.push_back(record);
+		return;
+	}
+
+	record.flow.tcpFlags = TCP_ESTABLISHED;
+	records.push_back(record);
+
+	GeneratedRecord reply = record;
+	reply.flow.src = record.flow.dst;
+	reply.flow.dst = record.flow.src;
+	reply.flow.dstPort = static_cast<uint16_t>(32768 + m_random() % 28000);
+	records.push_back(reply);
+}
+
+void TrafficGenerator::emitProbe(std::vector<GeneratedRecord>& records, Scanner& scanner, uint64_t time)
+{
+	std::uniform_real_distribution<double> share(0, 1);
+
+	GeneratedRecord record {};
+	record.time = time;
+	record.flow.src = scanner.address;
+	if (scanner.type == ActorType::Vertical) {
+		record.flow.dst = scanner.targets[scanner.probes % scanner.targets.size()];
+		record.flow.dstPort
+			= scanner.ports[(scanner.probes / scanner.targets.size()) % scanner.ports.size()];
+	} else {
+		record.flow.dst = ip_from_int(
+			TARGET_NETWORK + static_cast<uint32_t>((scanner.sweepBase + scanner.probes) % TARGET_HOSTS));
+		record.flow.dstPort = scanner.port;
+	}
+
+	if (scanner.probes == 0) {
+		scanner.firstSeen = time;
+	}
+	scanner.probes++;
+
+	const bool answered = share(m_random) < m_config.scanSuccessRatio;
+	record.flow.tcpFlags = answered ? TCP_ESTABLISHED : TCP_SYN;
+	records.push_back(record);
+
+	if (answered) {
+		GeneratedRecord reply = record;
+		reply.flow.src = record.flow.dst;
+		reply.flow.dst = record.flow.src;
+		reply.flow.dstPort = static_cast<uint16_t>(32768 + m_random() % 28000);
+		records.push_back(reply);
+	}
+}
+
+void TrafficGenerator::emitFlood(std::vector<GeneratedRecord>& records, uint64_t time)
+{
+	GeneratedRecord record {};
+	record.time = time;
+	record.flow.src = ip_from_int(static_cast<uint32_t>(m_random()));
+	record.flow.dst = ip_from_int(SERVER_NETWORK + 1);
+	record.flow.dstPort = 80;
+	record.flow.tcpFlags = TCP_SYN;
+	records.push_back(record);
+}
+
+} // namespace ScanBench
@@ -0,0 +1,119 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Declaration of the TrafficGenerator class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "flowRecord.hpp"
+#include "ipAddressHash.hpp"
+
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace ScanBench {
+
+/**
+ * @brief Composition of the generated traffic.
+ */
+struct TrafficConfig {
+	uint64_t records = 2'000'000; ///< Number of generated records.
+	uint64_t duration = 600; ///< Seconds of simulated time covered by the records.
+	uint64_t startTime = 1'700'000'000; ///< Time of the first record (seconds since epoch).
+	size_t clients = 50'000; ///< Number of benign clients.
+	size_t servers = 2'000; ///< Number of servers contacted by the clients.
+	double failureRatio = 0.05; ///< Ratio of failed connections of benign clients.
+	size_t horizontalScanners = 20; ///< Number of scanners probing one port on many targets.
+	size_t verticalScanners = 5; ///< Number of scanners probing many ports on few targets.
+	size_t verticalTargets = 8; ///< Number of targets of every vertical scanner.
+	size_t slowScanners = 5; ///< Number of horizontal scanners with a low fixed rate.
+	uint64_t slowInterval = 30; ///< Seconds between two probes of a slow scanner.
+	double scanShare = 0.01; ///< Ratio of records sent by the fast scanners.
+	double floodShare = 0.05; ///< Ratio of records of a flood with spoofed sources.
+	double scanSuccessRatio = 0.03; ///< Ratio of probes answered by the target.
+	uint32_t seed = 1; ///< Seed of the random generator.
+};
+
+/**
+ * @brief Kind of a traffic source.
+ */
+enum class ActorType : uint8_t {
+	Horizontal,
+	Vertical,
+	Slow,
+};
+
+/**
+ * @brief Scanner planted into the traffic, the ground truth of the benchmark.
+ */
+struct Scanner {
+	ip_addr_t address; ///< Source address of the scanner.
+	ActorType type; ///< Kind of the scanner.
+	uint64_t firstSeen = 0; ///< Time of the first probe, 0 if the scanner sent nothing.
+	uint64_t probes = 0; ///< Number of generated probes.
+	uint64_t nextProbe = 0; ///< Time of the next probe of a slow scanner.
+	uint32_t sweepBase = 0; ///< First target of the sweep.
+	uint16_t port = 0; ///< Probed port of a horizontal scanner.
+	std::vector<ip_addr_t> targets; ///< Targets of a vertical scanner.
+	std::vector<uint16_t> ports; ///< Ports of a vertical scanner in the order of probing.
+};
+
+/**
+ * @brief Record with its simulated time of arrival.
+ */
+struct GeneratedRecord {
+	ScanDetector::FlowRecord flow;
+	uint64_t time;
+};
+
+/**
+ * @brief Generates a synthetic mix of benign and scanning flows.
+ *
+ * Benign clients connect to a pool of servers, mostly successfully, and every successful
+ * connection is followed by the reply flow. Fast scanners probe either one port on consecutive
+ * targets (horizontal) or all ports in random order on a few targets (vertical, the default
+ * order of nmap), slow scanners probe at a fixed low rate and a flood with random spoofed
+ * sources hits a single victim. The generated scanners are the ground truth against which the
+ * detections are compared.
+ */
+class TrafficGenerator {
+public:
+	/**
+	 * @brief Constructs the generator and plants the scanners.
+	 */
+	explicit TrafficGenerator(const TrafficConfig& config);
+
+	/**
+	 * @brief Generates all records in the order of their arrival.
+	 */
+	std::vector<GeneratedRecord> generate();
+
+	/**
+	 * @brief Returns the planted scanners.
+	 */
+	const std::vector<Scanner>& scanners() const noexcept { return m_scanners; }
+
+	/**
+	 * @brief Returns the index of the scanner with the given address, or -1.
+	 */
+	int findScanner(const ip_addr_t& address) const;
+
+private:
+	void emitBackground(std::vector<GeneratedRecord>& records, uint64_t time);
+	void emitProbe(std::vector<GeneratedRecord>& records, Scanner& scanner, uint64_t time);
+	void emitFlood(std::vector<GeneratedRecord>& records, uint64_t time);
+
+	TrafficConfig m_config;
+	std::mt19937_64 m_random;
+	std::vector<Scanner> m_scanners;
+	std::vector<size_t> m_fastScanners;
+	std::unordered_map<ip_addr_t, int, ScanDetector::IPAddressHash, ScanDetector::IPAddressEqual>
+		m_scannerIndex;
+};
+
+} // namespace ScanBench
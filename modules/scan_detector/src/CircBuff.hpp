@@ -8,6 +8,9 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#pragma once
+
+#include "flowRecord.hpp"
 
 #include <unirec++/unirec.hpp>
 #include <string>
@@ -15,32 +18,29 @@
 #include <optional>
 #include <iostream>
 
-using namespace Nemea;
-
 class CircularBuffer {
 public:
-    CircularBuffer(int n, ur_template_t* unirecTemplate, size_t maxVariableFieldsSize) 
+    explicit CircularBuffer(int n)
         : buffer(std::make_unique<Line[]>(n)), head(nullptr), tail(nullptr), count(0), maxlines(n) {
-        // Initialize circular references and UnirecRecords
+        // Initialize circular references, only the fields used by the detector are stored
         for (int i = 0; i < n; ++i) {
             buffer[i].next = &buffer[(i + 1) % n]; // Setup circular buffer behavior
-            buffer[i].unirecRecord = UnirecRecord(unirecTemplate, maxVariableFieldsSize); // Initialize each UnirecRecord
         }
         head = &buffer[0];
         tail = &buffer[0];
     }
 
-    std::optional<UnirecRecord> buffInsert(const UnirecRecord unirecRecord) {
+    std::optional<ScanDetector::FlowRecord> buffInsert(const ScanDetector::FlowRecord& flowRecord) {
         if (count == maxlines) {
             // Buffer is full, overwrite the oldest element
-            UnirecRecord tmp = head->unirecRecord;
-            head->unirecRecord = unirecRecord;
+            ScanDetector::FlowRecord tmp = head->flowRecord;
+            head->flowRecord = flowRecord;
             head = head->next;
             tail = tail->next;
             return tmp;
         } else {
             // Buffer is not full, add a new element
-            tail->unirecRecord = unirecRecord;
+            tail->flowRecord = flowRecord;
             tail = tail->next;
             ++count;
             return std::nullopt;
@@ -51,10 +51,20 @@ public:
         return count;
     }
 
+    // Calls function(flowRecord) for all records from the oldest to the newest
+    template <typename Function>
+    void forEach(Function&& function) const {
+        const Line* line = head;
+        for (int i = 0; i < count; ++i) {
+            function(static_cast<const ScanDetector::FlowRecord&>(line->flowRecord));
+            line = line->next;
+        }
+    }
+
 private:
     struct Line {
         Line* next;
-        UnirecRecord unirecRecord;
+        ScanDetector::FlowRecord flowRecord;
     };
 
     std::unique_ptr<Line[]> buffer; // Array of Line structures
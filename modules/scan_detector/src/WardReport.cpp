@@ -0,0 +1,171 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Serialization of detected scanners into IDEA messages
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "WardReport.hpp"
+
+#include <arpa/inet.h>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::string formatTime(uint64_t seconds)
+{
+	const auto time = static_cast<std::time_t>(seconds);
+	std::tm utc {};
+	gmtime_r(&time, &utc);
+
+	char buffer[32];
+	std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &utc);
+	return buffer;
+}
+
+std::string formatAddress(const ip_addr_t& address)
+{
+	char buffer[INET6_ADDRSTRLEN];
+	ip_to_str(&address, buffer);
+	return buffer;
+}
+
+std::string formatPortRanges(const std::vector<std::pair<uint16_t, uint16_t>>& ranges)
+{
+	std::string result;
+	for (const auto& [first, last] : ranges) {
+		if (!result.empty()) {
+			result += ',';
+		}
+		result += std::to_string(first);
+		if (last != first) {
+			result += '-' + std::to_string(last);
+		}
+	}
+	return result;
+}
+
+void writeString(std::ostringstream& out, const std::string& value)
+{
+	out << '"';
+	for (const char character : value) {
+		switch (character) {
+		case '"':
+			out << "\\\"";
+			break;
+		case '\\':
+			out << "\\\\";
+			break;
+		default:
+			if (static_cast<unsigned char>(character) >= 0x20) {
+				out << character;
+			}
+		}
+	}
+	out << '"';
+}
+
+template <typename Container, typename Writer>
+void writeArray(std::ostringstream& out, const Container& values, Writer&& writer)
+{
+	out << '[';
+	bool first = true;
+	for (const auto& value : values) {
+		if (!first) {
+			out << ',';
+		}
+		first = false;
+		writer(value);
+	}
+	out << ']';
+}
+
+void writeSource(std::ostringstream& out, const ScanDetector::ScannerReport& report)
+{
+	std::string source = formatAddress(report.source);
+	const bool isIp4 = ip_is4(&report.source);
+	if (report.sourcePrefixLength > 0 && report.sourcePrefixLength < (isIp4 ? 32 : 128)) {
+		source += "/" + std::to_string(report.sourcePrefixLength);
+	}
+
+	out << (isIp4 ? "\"IP4\":[" : "\"IP6\":[");
+	writeString(out, source);
+	out << "],";
+}
+
+void writeAddresses(std::ostringstream& out, const std::vector<ip_addr_t>& addresses)
+{
+	std::vector<std::string> ip4;
+	std::vector<std::string> ip6;
+	for (const auto& address : addresses) {
+		(ip_is4(&address) ? ip4 : ip6).push_back(formatAddress(address));
+	}
+
+	auto writeValue = [&out](const std::string& value) { writeString(out, value); };
+	if (!ip4.empty()) {
+		out << "\"IP4\":";
+		writeArray(out, ip4, writeValue);
+		out << ',';
+	}
+	if (!ip6.empty()) {
+		out << "\"IP6\":";
+		writeArray(out, ip6, writeValue);
+		out << ',';
+	}
+}
+
+} // namespace
+
+namespace ScanDetector {
+
+std::string
+createIdeaMessage(const ScannerReport& report, const std::string& nodeName, const std::string& messageId)
+{
+	std::ostringstream out;
+
+	out << "{\"Format\":\"IDEA0\",\"ID\":";
+	writeString(out, messageId);
+	out << ",\"CreateTime\":\"" << formatTime(report.detectTime) << '"';
+	out << ",\"DetectTime\":\"" << formatTime(report.detectTime) << '"';
+	out << ",\"EventTime\":\"" << formatTime(report.firstSeen) << '"';
+	out << ",\"CeaseTime\":\"" << formatTime(report.lastSeen) << '"';
+	out << ",\"Category\":[\"Recon.Scanning\"]";
+	out << ",\"Description\":\"" << (report.sourceCount > 1 ? "Distributed " : "")
+		<< scanTypeName(report.scanType) << " scan of " << report.targetCount << " targets";
+	if (report.sourceCount > 1) {
+		out << " from " << report.sourceCount << " sources";
+	}
+	out << '"';
+	out << ",\"Note\":\"" << report.flowCount << " flows, " << report.synCount << " SYN only";
+	if (!report.portRanges.empty()) {
+		out << ", " << report.portCount << " ports " << formatPortRanges(report.portRanges);
+	}
+	out << '"';
+	out << ",\"ConnCount\":" << report.flowCount;
+
+	out << ",\"Source\":[{";
+	writeSource(out, report);
+	out << "\"Proto\":[\"tcp\"]}]";
+
+	out << ",\"Target\":[{";
+	writeAddresses(out, report.targets);
+	if (!report.ports.empty()) {
+		out << "\"Port\":";
+		writeArray(out, report.ports, [&out](uint16_t port) { out << port; });
+		out << ',';
+	}
+	out << "\"Proto\":[\"tcp\"]}]";
+
+	out << ",\"Node\":[{\"Name\":";
+	writeString(out, nodeName);
+	out << ",\"Type\":[\"Flow\",\"Statistical\"],\"SW\":[\"Nemea\",\"scan_detector\"]}]}";
+
+	return out.str();
+}
+
+} // namespace ScanDetector
@@ -0,0 +1,30 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Serialization of detected scanners into IDEA messages
+ *
+ * IDEA (Intrusion Detection Extensible Alert) is the JSON format of events accepted by Warden.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "scannerReport.hpp"
+
+#include <string>
+
+namespace ScanDetector {
+
+/**
+ * @brief Serializes a detected scanner into an IDEA message.
+ *
+ * @param report Detected scanner.
+ * @param nodeName Name of the detector node reported in the `Node` section.
+ * @param messageId Unique identifier of the message.
+ * @return IDEA message as a JSON string.
+ */
+std::string
+createIdeaMessage(const ScannerReport& report, const std::string& nodeName, const std::string& messageId);
+
+} // namespace ScanDetector
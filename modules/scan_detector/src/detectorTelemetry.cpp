@@ -0,0 +1,157 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Implementation of the DetectorTelemetry class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "detectorTelemetry.hpp"
+
+namespace {
+
+double getPercentage(uint64_t part, uint64_t total)
+{
+	if (total == 0) {
+		return 0;
+	}
+
+	const int fractionToPercentage = 100;
+	return static_cast<double>(part) / static_cast<double>(total) * fractionToPercentage;
+}
+
+double toMicroseconds(uint64_t nanoseconds)
+{
+	const double nanosecondsPerMicrosecond = 1000;
+	return static_cast<double>(nanoseconds) / nanosecondsPerMicrosecond;
+}
+
+} // namespace
+
+namespace ScanDetector {
+
+DetectorTelemetry::DetectorTelemetry(const ScanDetectorConfig& config, uint64_t windowCapacity)
+	: m_config(config)
+	, m_windowCapacity(windowCapacity)
+{
+}
+
+void DetectorTelemetry::publish(uint64_t now, const ScanDetectorStats& stats, uint64_t windowRecords)
+{
+	std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		// a reader holds the copy, the next second will be published instead
+		return;
+	}
+
+	m_stats = stats;
+	m_windowRecords = windowRecords;
+	m_now = now;
+
+	HistoryEntry& entry = m_history[now % m_history.size()];
+	entry.time = now;
+	entry.detections = stats.detectedScanners + stats.detectedSubnets;
+}
+
+void DetectorTelemetry::setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory)
+{
+	m_holder.add(directory);
+
+	const telemetry::FileOps tablesOps = {[this]() { return getTablesTelemetry(); }, nullptr};
+	m_holder.add(directory->addFile("tables", tablesOps));
+
+	const telemetry::FileOps detectionsOps
+		= {[this]() { return getDetectionsTelemetry(); }, nullptr};
+	m_holder.add(directory->addFile("detections", detectionsOps));
+
+	const telemetry::FileOps evictionsOps = {[this]() { return getEvictionsTelemetry(); }, nullptr};
+	m_holder.add(directory->addFile("evictions", evictionsOps));
+
+	const telemetry::FileOps timersOps = {[this]() { return getTimersTelemetry(); }, nullptr};
+	m_holder.add(directory->addFile("timers", timersOps));
+}
+
+telemetry::Content DetectorTelemetry::getTablesTelemetry() const
+{
+	const std::lock_guard<std::mutex> lock(m_mutex);
+
+	telemetry::Dict dict;
+	dict["sources"] = m_stats.sources;
+	dict["sourcesCapacity"] = static_cast<uint64_t>(m_config.maxSources);
+	dict["sourcesFill"] = telemetry::ScalarWithUnit(
+		getPercentage(m_stats.sources, m_config.maxSources),
+		"%");
+	dict["suspects"] = m_stats.suspects;
+	dict["suspectsCapacity"] = static_cast<uint64_t>(m_config.maxSuspects);
+	dict["suspectsFill"] = telemetry::ScalarWithUnit(
+		getPercentage(m_stats.suspects, m_config.maxSuspects),
+		"%");
+	dict["subnets"] = m_stats.subnets;
+	dict["suspectSubnets"] = m_stats.suspectSubnets;
+	dict["evidenceRecords"] = m_stats.evidenceRecords;
+	dict["evidenceFill"] = telemetry::ScalarWithUnit(
+		getPercentage(m_stats.evidenceRecords, m_config.evidencePoolSize),
+		"%");
+	dict["windowRecords"] = m_windowRecords;
+	dict["windowFill"]
+		= telemetry::ScalarWithUnit(getPercentage(m_windowRecords, m_windowCapacity), "%");
+	return dict;
+}
+
+telemetry::Content DetectorTelemetry::getDetectionsTelemetry() const
+{
+	const std::lock_guard<std::mutex> lock(m_mutex);
+
+	// the oldest published second within the last minute
+	const uint64_t detections = m_stats.detectedScanners + m_stats.detectedSubnets;
+	uint64_t minuteAgo = detections;
+	uint64_t oldest = m_now;
+	for (const auto& entry : m_history) {
+		if (entry.time != 0 && entry.time + HISTORY_SECONDS >= m_now && entry.time < oldest) {
+			oldest = entry.time;
+			minuteAgo = entry.detections;
+		}
+	}
+
+	telemetry::Dict dict;
+	dict["detectedScanners"] = m_stats.detectedScanners;
+	dict["detectedSubnets"] = m_stats.detectedSubnets;
+	dict["detectionsPerMinute"] = detections - minuteAgo;
+	dict["evaluatedSuspects"] = m_stats.evaluatedSuspects;
+	return dict;
+}
+
+telemetry::Content DetectorTelemetry::getEvictionsTelemetry() const
+{
+	const std::lock_guard<std::mutex> lock(m_mutex);
+
+	telemetry::Dict dict;
+	dict["evictedSources"] = m_stats.evictedSources;
+	dict["evictedSourceRecords"] = m_stats.evictedSourceRecords;
+	dict["evictedSuspects"] = m_stats.evictedSuspects;
+	dict["evictedSubnets"] = m_stats.evictedSubnets;
+	dict["expiredSources"] = m_stats.expiredSources;
+	dict["expiredSuspects"] = m_stats.expiredSuspects;
+	dict["expiredSubnets"] = m_stats.expiredSubnets;
+	dict["droppedEvidence"] = m_stats.droppedEvidence;
+	return dict;
+}
+
+telemetry::Content DetectorTelemetry::getTimersTelemetry() const
+{
+	const std::lock_guard<std::mutex> lock(m_mutex);
+
+	const uint64_t average
+		= m_stats.timerSweeps > 0 ? m_stats.timerSweepNanoseconds / m_stats.timerSweeps : 0;
+
+	telemetry::Dict dict;
+	dict["sweeps"] = m_stats.timerSweeps;
+	dict["averageSweep"] = telemetry::ScalarWithUnit(toMicroseconds(average), "us");
+	dict["maxSweep"]
+		= telemetry::ScalarWithUnit(toMicroseconds(m_stats.maxTimerSweepNanoseconds), "us");
+	dict["totalSweep"]
+		= telemetry::ScalarWithUnit(toMicroseconds(m_stats.timerSweepNanoseconds), "us");
+	return dict;
+}
+
+} // namespace ScanDetector
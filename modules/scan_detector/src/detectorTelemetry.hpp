@@ -0,0 +1,81 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Declaration of the DetectorTelemetry class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "scanDetector.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <telemetry.hpp>
+
+namespace ScanDetector {
+
+/**
+ * @brief Exposes the internals of the detector in a telemetry directory.
+ *
+ * The receiving thread publishes the statistics of the detector once per second and telemetry
+ * readers only access the published copy, so reading a file never touches the tables. If a
+ * reader holds the copy at the moment, the publication is skipped instead of waiting for it.
+ *
+ * Files of the directory:
+ * - `tables`: sizes and capacities of the tables and the fill of the window,
+ * - `detections`: detected scanners and subnets, detections in the last minute,
+ * - `evictions`: entries evicted from full tables and expired for inactivity,
+ * - `timers`: number and durations of the timer sweeps.
+ */
+class DetectorTelemetry {
+public:
+	/**
+	 * @brief Constructs the telemetry.
+	 * @param config Configuration of the detector, used for the capacities.
+	 * @param windowCapacity Number of records in the window.
+	 */
+	DetectorTelemetry(const ScanDetectorConfig& config, uint64_t windowCapacity);
+
+	/**
+	 * @brief Publishes the statistics, called by the receiving thread.
+	 * @param now Current time in seconds.
+	 * @param stats Statistics of the detector.
+	 * @param windowRecords Number of records in the window.
+	 */
+	void publish(uint64_t now, const ScanDetectorStats& stats, uint64_t windowRecords);
+
+	/**
+	 * @brief Adds the telemetry files into the directory.
+	 */
+	void setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory);
+
+private:
+	telemetry::Content getTablesTelemetry() const;
+	telemetry::Content getDetectionsTelemetry() const;
+	telemetry::Content getEvictionsTelemetry() const;
+	telemetry::Content getTimersTelemetry() const;
+
+	static constexpr size_t HISTORY_SECONDS = 60;
+
+	struct HistoryEntry {
+		uint64_t time = 0;
+		uint64_t detections = 0;
+	};
+
+	const ScanDetectorConfig m_config;
+	const uint64_t m_windowCapacity;
+
+	mutable std::mutex m_mutex;
+	ScanDetectorStats m_stats;
+	uint64_t m_windowRecords = 0;
+	uint64_t m_now = 0;
+	std::array<HistoryEntry, HISTORY_SECONDS + 1> m_history {};
+
+	telemetry::Holder m_holder;
+};
+
+} // namespace ScanDetector
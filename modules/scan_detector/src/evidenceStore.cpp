@@ -0,0 +1,104 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Implementation of the EvidenceStore class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "evidenceStore.hpp"
+
+namespace ScanDetector {
+
+EvidenceStore::EvidenceStore(std::size_t poolSize, std::size_t headSize, std::size_t tailSize)
+	: m_pool(poolSize)
+	, m_headSize(headSize)
+	, m_tailSize(tailSize)
+{
+}
+
+void EvidenceStore::add(Evidence& evidence, const FlowRecord& flowRecord)
+{
+	evidence.total++;
+
+	if (evidence.headCount < m_headSize) {
+		addToHead(evidence, flowRecord);
+	} else {
+		addToTail(evidence, flowRecord);
+	}
+}
+
+void EvidenceStore::addToHead(Evidence& evidence, const FlowRecord& flowRecord)
+{
+	const uint32_t slot = m_pool.allocate();
+	if (slot == NONE) {
+		m_droppedRecords++;
+		return;
+	}
+
+	m_pool[slot] = {flowRecord, NONE};
+	if (evidence.headLast == NONE) {
+		evidence.headFirst = slot;
+	} else {
+		m_pool[evidence.headLast].next = slot;
+	}
+	evidence.headLast = slot;
+	evidence.headCount++;
+}
+
+void EvidenceStore::addToTail(Evidence& evidence, const FlowRecord& flowRecord)
+{
+	if (m_tailSize == 0) {
+		m_droppedRecords++;
+		return;
+	}
+
+	uint32_t slot = NONE;
+	if (evidence.tailCount < m_tailSize) {
+		slot = m_pool.allocate();
+	}
+
+	if (slot == NONE) {
+		if (evidence.tailNewest == NONE) {
+			m_droppedRecords++;
+			return;
+		}
+		// the ring is full or the pool is exhausted, overwrite the oldest record in place
+		evidence.tailNewest = m_pool[evidence.tailNewest].next;
+		m_pool[evidence.tailNewest].record = flowRecord;
+		return;
+	}
+
+	m_pool[slot].record = flowRecord;
+	if (evidence.tailNewest == NONE) {
+		m_pool[slot].next = slot;
+	} else {
+		m_pool[slot].next = m_pool[evidence.tailNewest].next;
+		m_pool[evidence.tailNewest].next = slot;
+	}
+	evidence.tailNewest = slot;
+	evidence.tailCount++;
+}
+
+void EvidenceStore::release(Evidence& evidence) noexcept
+{
+	for (uint32_t slot = evidence.headFirst; slot != NONE;) {
+		const uint32_t next = m_pool[slot].next;
+		m_pool.release(slot);
+		slot = next;
+	}
+
+	if (evidence.tailNewest != NONE) {
+		const uint32_t oldest = m_pool[evidence.tailNewest].next;
+		uint32_t slot = oldest;
+		do {
+			const uint32_t next = m_pool[slot].next;
+			m_pool.release(slot);
+			slot = next;
+		} while (slot != oldest);
+	}
+
+	evidence = Evidence();
+}
+
+} // namespace ScanDetector
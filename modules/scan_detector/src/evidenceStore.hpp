@@ -0,0 +1,118 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Declaration of the EvidenceStore class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "flowRecord.hpp"
+#include "slabPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ScanDetector {
+
+/**
+ * @brief Records retained for one suspect.
+ *
+ * The structure only holds indices into the pool of the EvidenceStore, its size does not
+ * depend on the number of retained records.
+ */
+struct Evidence {
+	uint32_t headFirst = SlabPool<int>::NONE; ///< Oldest of the first records.
+	uint32_t headLast = SlabPool<int>::NONE; ///< Newest of the first records.
+	uint32_t tailNewest = SlabPool<int>::NONE; ///< Newest of the last records.
+	uint32_t headCount = 0; ///< Number of retained first records.
+	uint32_t tailCount = 0; ///< Number of retained last records.
+	uint64_t total = 0; ///< Number of records seen, including the ones not retained.
+};
+
+/**
+ * @brief Bounded store of suspect evidence.
+ *
+ * For every suspect the store keeps the first N and the last M records. Records are stored in
+ * fixed-size slots of a pool shared by all suspects, the last M records form a circular list in
+ * which the oldest slot is overwritten in place. The memory used for evidence is thus limited by
+ * the size of the pool and retaining a record does not allocate once the pool is warm.
+ */
+class EvidenceStore {
+public:
+	/**
+	 * @brief Constructs the store.
+	 * @param poolSize Maximal number of records retained for all suspects.
+	 * @param headSize Number of first records retained per suspect.
+	 * @param tailSize Number of last records retained per suspect.
+	 */
+	EvidenceStore(std::size_t poolSize, std::size_t headSize, std::size_t tailSize);
+
+	/**
+	 * @brief Adds a record to the evidence of a suspect.
+	 *
+	 * If the pool is exhausted, the record replaces the oldest of the last records of the
+	 * suspect or it is dropped.
+	 *
+	 * @param evidence Evidence of the suspect.
+	 * @param flowRecord Record to retain.
+	 */
+	void add(Evidence& evidence, const FlowRecord& flowRecord);
+
+	/**
+	 * @brief Returns all slots of the evidence to the pool.
+	 * @param evidence Evidence of the suspect, reset to the empty state.
+	 */
+	void release(Evidence& evidence) noexcept;
+
+	/**
+	 * @brief Calls `function(flowRecord)` for retained records from the oldest to the newest.
+	 */
+	template <typename Function>
+	void forEach(const Evidence& evidence, Function&& function) const
+	{
+		for (uint32_t slot = evidence.headFirst; slot != NONE; slot = m_pool[slot].next) {
+			function(static_cast<const FlowRecord&>(m_pool[slot].record));
+		}
+
+		if (evidence.tailNewest == NONE) {
+			return;
+		}
+
+		const uint32_t oldest = m_pool[evidence.tailNewest].next;
+		uint32_t slot = oldest;
+		do {
+			function(static_cast<const FlowRecord&>(m_pool[slot].record));
+			slot = m_pool[slot].next;
+		} while (slot != oldest);
+	}
+
+	/**
+	 * @brief Returns the number of slots in use.
+	 */
+	std::size_t usedSlots() const noexcept { return m_pool.used(); }
+
+	/**
+	 * @brief Returns the number of records that could not be retained.
+	 */
+	uint64_t droppedRecords() const noexcept { return m_droppedRecords; }
+
+private:
+	static constexpr uint32_t NONE = SlabPool<int>::NONE;
+
+	struct Slot {
+		FlowRecord record;
+		uint32_t next;
+	};
+
+	void addToHead(Evidence& evidence, const FlowRecord& flowRecord);
+	void addToTail(Evidence& evidence, const FlowRecord& flowRecord);
+
+	SlabPool<Slot> m_pool;
+	std::size_t m_headSize;
+	std::size_t m_tailSize;
+	uint64_t m_droppedRecords = 0;
+};
+
+} // namespace ScanDetector
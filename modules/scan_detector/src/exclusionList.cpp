@@ -0,0 +1,112 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Implementation of the ExclusionList class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "exclusionList.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+struct Prefix {
+	ip_addr_t address;
+	uint8_t length;
+};
+
+Prefix parsePrefix(const std::string& text)
+{
+	const size_t slash = text.find('/');
+	const std::string address = text.substr(0, slash);
+
+	Prefix prefix {};
+	if (ip_from_str(address.c_str(), &prefix.address) != 1) {
+		throw std::invalid_argument("invalid IP address '" + address + "'");
+	}
+
+	const unsigned maxLength = ip_is4(&prefix.address) ? 32 : 128;
+	if (slash == std::string::npos) {
+		prefix.length = static_cast<uint8_t>(maxLength);
+		return prefix;
+	}
+
+	const std::string lengthText = text.substr(slash + 1);
+	size_t parsed = 0;
+	unsigned long length = 0;
+	try {
+		length = std::stoul(lengthText, &parsed);
+	} catch (const std::exception&) {
+		parsed = 0;
+	}
+	if (parsed == 0 || parsed != lengthText.size() || length > maxLength) {
+		throw std::invalid_argument("invalid prefix length '" + lengthText + "'");
+	}
+	prefix.length = static_cast<uint8_t>(length);
+	return prefix;
+}
+
+} // namespace
+
+namespace ScanDetector {
+
+ExclusionList ExclusionList::load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file) {
+		throw std::runtime_error("ExclusionList: cannot open '" + path + "'");
+	}
+
+	ExclusionList list;
+	std::string line;
+	size_t lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream fields(line);
+		std::string first;
+		std::string second;
+		std::string rest;
+		if (!(fields >> first)) {
+			continue;
+		}
+		fields >> second >> rest;
+
+		try {
+			if (first == "src" || first == "dst") {
+				if (second.empty() || !rest.empty()) {
+					throw std::invalid_argument("expected '" + first + " <prefix>'");
+				}
+				const Prefix prefix = parsePrefix(second);
+				PrefixSet& set = first == "src" ? list.m_sources : list.m_destinations;
+				set.insert(prefix.address, prefix.length);
+				continue;
+			}
+
+			if (!second.empty()) {
+				throw std::invalid_argument("unexpected '" + second + "'");
+			}
+			const Prefix prefix = parsePrefix(first);
+			list.m_sources.insert(prefix.address, prefix.length);
+			list.m_destinations.insert(prefix.address, prefix.length);
+		} catch (const std::invalid_argument& ex) {
+			throw std::runtime_error(
+				"ExclusionList: '" + path + "' line " + std::to_string(lineNumber) + ": " + ex.what());
+		}
+	}
+
+	if (file.bad()) {
+		throw std::runtime_error("ExclusionList: cannot read '" + path + "'");
+	}
+
+	list.m_sources.compact();
+	list.m_destinations.compact();
+	return list;
+}
+
+} // namespace ScanDetector
@@ -0,0 +1,63 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Declaration of the ExclusionList class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "flowRecord.hpp"
+#include "prefixSet.hpp"
+
+#include <string>
+
+namespace ScanDetector {
+
+/**
+ * @brief Prefixes of known benign sources and destinations excluded from the detection.
+ *
+ * The list is loaded from a text file with one prefix per line:
+ * @code
+ * # comment
+ * src 192.0.2.0/24       # excluded as a source, e.g. our vulnerability scanner
+ * dst 2001:db8::/32      # excluded as a destination, e.g. a CDN health-checked service
+ * 198.51.100.7           # excluded on both sides, a host prefix if the length is missing
+ * @endcode
+ */
+class ExclusionList {
+public:
+	/**
+	 * @brief Loads the list from a file.
+	 * @param path Path to the file.
+	 * @throw std::runtime_error If the file cannot be read or contains an invalid line.
+	 */
+	static ExclusionList load(const std::string& path);
+
+	/**
+	 * @brief Checks whether the record is excluded by its source or its destination.
+	 *
+	 * The source is checked first, so traffic of an excluded source costs a single lookup.
+	 */
+	bool excludes(const FlowRecord& flow) const noexcept
+	{
+		return m_sources.contains(flow.src) || m_destinations.contains(flow.dst);
+	}
+
+	/**
+	 * @brief Returns the number of disjoint address ranges of the list.
+	 */
+	size_t size() const noexcept { return m_sources.size() + m_destinations.size(); }
+
+	/**
+	 * @brief Checks whether the list is empty.
+	 */
+	bool empty() const noexcept { return m_sources.empty() && m_destinations.empty(); }
+
+private:
+	PrefixSet m_sources;
+	PrefixSet m_destinations;
+};
+
+} // namespace ScanDetector
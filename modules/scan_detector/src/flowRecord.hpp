@@ -0,0 +1,56 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Compact representation of a flow record
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unirec++/unirec.hpp>
+
+namespace ScanDetector {
+
+/**
+ * @brief Fields of a flow record used by the scan detector.
+ */
+struct FlowRecord {
+	ip_addr_t src; ///< Source IP address.
+	ip_addr_t dst; ///< Destination IP address.
+	uint16_t dstPort; ///< Destination port.
+	uint8_t tcpFlags; ///< Cumulative TCP flags.
+};
+
+/**
+ * @brief Sides of a flow record accounted by a detector.
+ *
+ * Statistics of the source, of the destination and of their aggregated subnets are independent,
+ * so the parts of a record can be accounted by different detectors.
+ */
+enum class FlowSide : uint8_t {
+	Source = 1, ///< Statistics of the source IP address.
+	Destination = 2, ///< Statistics of the destination IP address.
+	SourceSubnet = 4, ///< Statistics of the subnet of the source IP address.
+	DestinationSubnet = 8, ///< Statistics of the subnet of the destination IP address.
+	Both = 15, ///< Statistics of both IP addresses and of their subnets.
+};
+
+/**
+ * @brief Returns the union of two sets of sides.
+ */
+constexpr FlowSide operator|(FlowSide lhs, FlowSide rhs) noexcept
+{
+	return static_cast<FlowSide>(static_cast<uint8_t>(lhs) | static_cast<uint8_t>(rhs));
+}
+
+/**
+ * @brief Checks whether the side is included in the set of sides.
+ */
+constexpr bool hasSide(FlowSide sides, FlowSide side) noexcept
+{
+	return (static_cast<uint8_t>(sides) & static_cast<uint8_t>(side)) != 0;
+}
+
+} // namespace ScanDetector
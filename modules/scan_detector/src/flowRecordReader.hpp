@@ -0,0 +1,62 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Extraction of flow records from received Unirec records
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "flowRecord.hpp"
+
+#include <unirec++/unirec.hpp>
+
+namespace ScanDetector {
+
+/**
+ * @brief Reads the fields used by the detector straight from a received record.
+ *
+ * The record is read through its view into the receive buffer, so nothing is copied or
+ * allocated. Field ids are resolved on construction and after every template change.
+ */
+class FlowRecordReader {
+public:
+	/**
+	 * @brief Constructs the reader and resolves the field ids.
+	 */
+	FlowRecordReader() { changeTemplate(); }
+
+	/**
+	 * @brief Resolves the field ids, called after the input template changed.
+	 */
+	void changeTemplate()
+	{
+		m_srcIp = ur_get_id_by_name("SRC_IP");
+		m_dstIp = ur_get_id_by_name("DST_IP");
+		m_tcpFlags = ur_get_id_by_name("TCP_FLAGS");
+		m_dstPort = ur_get_id_by_name("DST_PORT");
+	}
+
+	/**
+	 * @brief Extracts the fields used by the detector.
+	 * @param unirecRecordView View of the received record.
+	 */
+	FlowRecord read(const Nemea::UnirecRecordView& unirecRecordView) const
+	{
+		FlowRecord flow;
+		flow.src = unirecRecordView.getFieldAsType<Nemea::IpAddress>(m_srcIp).ip;
+		flow.dst = unirecRecordView.getFieldAsType<Nemea::IpAddress>(m_dstIp).ip;
+		flow.tcpFlags = unirecRecordView.getFieldAsType<uint8_t>(m_tcpFlags);
+		flow.dstPort = unirecRecordView.getFieldAsType<uint16_t>(m_dstPort);
+		return flow;
+	}
+
+private:
+	ur_field_id_t m_srcIp;
+	ur_field_id_t m_dstIp;
+	ur_field_id_t m_tcpFlags;
+	ur_field_id_t m_dstPort;
+};
+
+} // namespace ScanDetector
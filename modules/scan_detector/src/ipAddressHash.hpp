@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Hash and equality functors for ip_addr_t
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unirec++/unirec.hpp>
+
+namespace ScanDetector {
+
+/**
+ * @brief Hash function for ip_addr_t
+ *
+ * Custom hash function for use in unordered_map
+ *
+ * @param ip_addr_t IP address to be hashed by
+ */
+struct IPAddressHash {
+	std::size_t operator()(const ip_addr_t& ip) const
+	{
+		// Combine the two 64-bit parts to produce a single hash value
+		const uint64_t* ptr = ip.ui64;
+		std::size_t h1 = std::hash<uint64_t> {}(ptr[0]);
+		std::size_t h2 = std::hash<uint64_t> {}(ptr[1]);
+		return h1 ^ (h2 << 1); // Combine the two hash values
+	}
+};
+
+/**
+ * @brief Mixes all bits of the IP address into a well distributed 64-bit hash.
+ *
+ * Unlike IPAddressHash, which keeps low bits of addresses nearly intact, every bit of the result
+ * depends on every bit of the address (finalizer of MurmurHash3). Suitable for partitioning and
+ * for indexing bitmaps.
+ */
+inline uint64_t mixAddress(const ip_addr_t& ip) noexcept
+{
+	uint64_t hash = ip.ui64[0] ^ (ip.ui64[1] * 0x9e3779b97f4a7c15ULL);
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+/**
+ * @brief Equality operator for ip_addr_t
+ *
+ * Custom equality operator for use in unordered_map
+ *
+ * @param ip_addr_t First IP address to be compared
+ * @param ip_addr_t Second IP address to be compared
+ */
+struct IPAddressEqual {
+	bool operator()(const ip_addr_t& lhs, const ip_addr_t& rhs) const
+	{
+		return lhs.ui64[0] == rhs.ui64[0] && lhs.ui64[1] == rhs.ui64[1];
+	}
+};
+
+} // namespace ScanDetector
@@ -0,0 +1,53 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Helpers for IP address prefixes
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unirec++/unirec.hpp>
+
+namespace ScanDetector {
+
+/**
+ * @brief Returns the length of the address in bits, 32 for IPv4 and 128 for IPv6.
+ */
+inline uint8_t addressLength(const ip_addr_t& address) noexcept
+{
+	return ip_is4(&address) ? 32 : 128;
+}
+
+/**
+ * @brief Clears the host bits of the address.
+ *
+ * @param address IP address.
+ * @param prefix4 Prefix length applied to IPv4 addresses.
+ * @param prefix6 Prefix length applied to IPv6 addresses.
+ * @return Network address of the prefix.
+ */
+inline ip_addr_t applyPrefix(const ip_addr_t& address, uint8_t prefix4, uint8_t prefix6) noexcept
+{
+	ip_addr_t network = address;
+	const bool isIpv4 = ip_is4(&address) != 0;
+
+	// IPv4 addresses are stored in bytes 8 to 11 of the IPv6-sized structure
+	uint8_t* bytes = isIpv4 ? network.ui8 + 8 : network.ui8;
+	const unsigned length = isIpv4 ? 4 : 16;
+	unsigned prefix = isIpv4 ? prefix4 : prefix6;
+
+	for (unsigned i = 0; i < length; i++) {
+		if (prefix >= 8) {
+			prefix -= 8;
+			continue;
+		}
+		bytes[i] &= static_cast<uint8_t>(0xFF00U >> prefix);
+		prefix = 0;
+	}
+	return network;
+}
+
+} // namespace ScanDetector
@@ -0,0 +1,74 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Fixed-size distinct counter
+ *
+ * Implementation of linear counting from Whang et al., "A Linear-Time Probabilistic Counting
+ * Algorithm for Database Applications". Every element sets one bit selected by its hash and the
+ * number of distinct elements is estimated from the fraction of bits that remain zero. The
+ * estimate is accurate up to a few times the number of bits.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace ScanDetector {
+
+/**
+ * @brief Distinct counter with a fixed size.
+ * @tparam Bits Number of bits, a power of two and a multiple of 64.
+ */
+template <std::size_t Bits>
+class LinearCounter {
+	static_assert(Bits >= 64 && (Bits & (Bits - 1)) == 0, "Bits must be a power of two >= 64");
+
+public:
+	/**
+	 * @brief Accounts an element.
+	 * @param hash Well distributed hash of the element.
+	 * @return True if the element set a new bit, i.e. it was certainly not seen before.
+	 */
+	bool add(uint64_t hash) noexcept
+	{
+		const std::size_t bit = hash & (Bits - 1);
+		const uint64_t mask = uint64_t(1) << (bit % 64);
+		uint64_t& word = m_words[bit / 64];
+		if ((word & mask) != 0) {
+			return false;
+		}
+		word |= mask;
+		m_setBits++;
+		return true;
+	}
+
+	/**
+	 * @brief Returns the number of set bits, a lower bound of the number of distinct elements.
+	 */
+	uint32_t setBits() const noexcept { return m_setBits; }
+
+	/**
+	 * @brief Returns the estimated number of distinct elements.
+	 */
+	double estimate() const noexcept
+	{
+		const double bits = Bits;
+		const double zeros = Bits - m_setBits;
+		if (zeros == 0) {
+			// saturated, the largest estimate the counter can give
+			return bits * std::log(bits);
+		}
+		return -bits * std::log(zeros / bits);
+	}
+
+private:
+	std::array<uint64_t, Bits / 64> m_words {};
+	uint32_t m_setBits = 0;
+};
+
+} // namespace ScanDetector
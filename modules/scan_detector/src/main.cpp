@@ -8,113 +8,182 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
-//#include "logger.hpp"
-
+#include "detectorTelemetry.hpp"
+#include "exclusionList.hpp"
+#include "flowRecordReader.hpp"
+#include "instrumentation/instrumentation.hpp"
+#include "logger/logger.hpp"
+#include "partitionedDetector.hpp"
+#include "reportWriter.hpp"
+#include "unirec/unirec-telemetry.hpp"
+
+#include <appFs.hpp>
 #include <iostream>
 #include <stdexcept>
 #include <argparse/argparse.hpp>
 #include <unirec++/unirec.hpp>
-#include <unordered_map>
-#include <map>
+#include <atomic>
 #include <chrono>
-#include <mutex>
-#include <vector>
+#include <csignal>
 #include <cstdint>
-#include <functional>
-#include <thread>
-#include "CircBuff.cpp"	
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <telemetry.hpp>
+#include <type_traits>
+#include "CircBuff.hpp"
+#include "scanDetector.hpp"
 
 using namespace Nemea;
 
-
-/**
- * @brief Hash function for ip_addr_t
- *
- * Custom hash function for use in unordered_map
- *
- * @param ip_addr_t IP address to be hashed by
- */
-struct IPAddressHash {
-    std::size_t operator()(const ip_addr_t& ip) const {
-        // Combine the two 64-bit parts to produce a single hash value
-        const uint64_t* ptr = ip.ui64;
-        std::size_t h1 = std::hash<uint64_t>{}(ptr[0]);
-        std::size_t h2 = std::hash<uint64_t>{}(ptr[1]);
-        return h1 ^ (h2 << 1); // Combine the two hash values
-    }
-};
-
-/**
- * @brief Equality operator for ip_addr_t
- *
- * Custom equality operator for use in unordered_map
- *
- * @param ip_addr_t First IP address to be compared
- * @param ip_addr_t Second IP address to be compared
- */
-struct IPAddressEqual {
-    bool operator()(const ip_addr_t& lhs, const ip_addr_t& rhs) const {
-        return lhs.ui64[0] == rhs.ui64[0] && lhs.ui64[1] == rhs.ui64[1];
-    }
-};
-
-struct TrafficData 
-{
-    uint64_t src;
-    uint64_t dst;
-    uint64_t syn;
-	bool deathFlag;
-
-    TrafficData() : src(0), dst(0), syn(0), deathFlag(false) {}
-};
-
-struct IpData 
-{
-	std::map<int, int> portMap;
-	uint64_t count;
-
-	IpData() : count(0) {}
-};
-
-struct SusIpData
-{
-	std::vector<UnirecRecord> inRecords;
-	std::vector<UnirecRecord> outRecords;
-	std::unordered_map<ip_addr_t, IpData, IPAddressHash, IPAddressEqual> dstIpMap;
-	uint64_t syn;
-
-	SusIpData() : syn(0) {}
-};
-
 //function declarations, definitions are after main
-void handleFormatChange(UnirecInputInterface& iInterface);
-void processNextRecord(UnirecInputInterface& iInterface, CircularBuffer& circBuff);
-void processUnirecRecords(UnirecInputInterface& iInterface, CircularBuffer& circBuff);
-void categorizeUnirecRecord(UnirecRecord unirecRecord);
-void monitorOfIpMap();
-void monitorOfSusIpMap();
+void handleFormatChange(UnirecInputInterface& iInterface, ScanDetector::FlowRecordReader& recordReader);
+template <typename Detector>
+void processNextRecord(UnirecInputInterface& iInterface, const ScanDetector::FlowRecordReader& recordReader, CircularBuffer& circBuff, Detector& detector, const ScanDetector::ExclusionList& exclusions, uint64_t now);
+template <typename Detector>
+void processUnirecRecords(UnirecInputInterface& iInterface, CircularBuffer& circBuff, Detector& detector, ScanDetector::SnapshotFile* snapshotFile, uint64_t snapshotInterval, ScanDetector::DetectorTelemetry& detectorTelemetry, ScanDetector::ExclusionList& exclusions, const std::string& exclusionPath);
+template <typename Detector>
+void runDetector(UnirecInputInterface& iInterface, CircularBuffer& circBuff, Detector& detector, ScanDetector::SnapshotFile* snapshotFile, uint64_t snapshotInterval, ScanDetector::DetectorTelemetry& detectorTelemetry, ScanDetector::ExclusionList& exclusions, const std::string& exclusionPath);
+template <typename Detector>
+void saveSnapshot(ScanDetector::SnapshotFile& snapshotFile, const CircularBuffer& circBuff, Detector& detector, bool background);
+template <typename Detector>
+void restoreSnapshot(const ScanDetector::SnapshotFile& snapshotFile, CircularBuffer& circBuff, Detector& detector);
+void reloadExclusions(ScanDetector::ExclusionList& exclusions, const std::string& exclusionPath);
+telemetry::Content getReportWriterTelemetry(const ScanDetector::ReportWriter& reportWriter);
+telemetry::Content getPartitionTelemetry(const ScanDetector::PartitionedDetector& detector);
+uint64_t getCurrentTime();
+bool hasArgument(int argc, char** argv, const char* name);
 
 //definition of global variables
 int bufferSize = 1'000'000;
-size_t minSize = 30;
-double susNorRatio = 0.9;
-double srcDstRatio = 0.5;
-double synSrcRatio = 0.5;
-std::mutex writeAccess;
-//Hash map for storing statistics about each ip adresses
-std::unordered_map<ip_addr_t, TrafficData, IPAddressHash, IPAddressEqual> ipMap;
-std::unordered_map<ip_addr_t, SusIpData, IPAddressHash, IPAddressEqual> susIpMap;
+//receive timeout in microseconds, the detector advances its timers even without traffic
+const int receiveTimeout = 1'000'000;
+std::atomic<bool> g_stopFlag(false);
+std::atomic<bool> g_reloadFlag(false);
 
+void signalHandler(int signum)
+{
+	(void) signum;
+	g_stopFlag.store(true);
+}
 
+void reloadSignalHandler(int signum)
+{
+	(void) signum;
+	g_reloadFlag.store(true);
+}
 
 int main(int argc, char** argv)
 {
 	argparse::ArgumentParser program("Scan Detector");
 
-	Unirec unirec({1, 0, "scan_detector", "Scan Detector module"});
+	//the output interface is optional, so it has to be known before libtrap is initialized
+	const bool unirecOutput = hasArgument(argc, argv, "--unirec-output");
+	Unirec unirec({1, unirecOutput ? 1 : 0, "scan_detector", "Scan Detector module"});
+
+	Nm::loggerInit();
+	auto logger = Nm::loggerGet("main");
 
-	//nemea::loggerInit();
-	//auto logger = nemea::loggerGet("main");
+	signal(SIGINT, signalHandler);
+	signal(SIGTERM, signalHandler);
+	signal(SIGHUP, reloadSignalHandler);
+
+	try {
+		program.add_argument("--trw-pd")
+			.help("desired detection probability of the threshold random walk")
+			.default_value(0.99)
+			.scan<'g', double>();
+		program.add_argument("--trw-pf")
+			.help("maximal false positive probability of the threshold random walk")
+			.default_value(0.01)
+			.scan<'g', double>();
+		program.add_argument("--trw-theta0")
+			.help("probability that a connection of a benign source succeeds")
+			.default_value(0.8)
+			.scan<'g', double>();
+		program.add_argument("--trw-theta1")
+			.help("probability that a connection of a scanner succeeds")
+			.default_value(0.2)
+			.scan<'g', double>();
+		program.add_argument("--inactive-timeout")
+			.help("seconds of inactivity after which an IP address is forgotten")
+			.default_value(uint64_t(60))
+			.scan<'u', uint64_t>();
+		program.add_argument("--max-sources")
+			.help("maximal number of tracked IP addresses, the least active ones are evicted")
+			.default_value(size_t(1'000'000))
+			.scan<'u', size_t>();
+		program.add_argument("--max-suspects")
+			.help("maximal number of tracked suspicious IP addresses")
+			.default_value(size_t(10'000))
+			.scan<'u', size_t>();
+		program.add_argument("--max-suspect-targets")
+			.help("maximal number of targets tracked per suspect, further ones are only counted")
+			.default_value(size_t(65'536))
+			.scan<'u', size_t>();
+		program.add_argument("--evidence-pool-size")
+			.help("maximal number of records retained as evidence for all suspects")
+			.default_value(size_t(1'000'000))
+			.scan<'u', size_t>();
+		program.add_argument("--evidence-head")
+			.help("number of first records retained per suspect")
+			.default_value(size_t(16))
+			.scan<'u', size_t>();
+		program.add_argument("--evidence-tail")
+			.help("number of last records retained per suspect")
+			.default_value(size_t(64))
+			.scan<'u', size_t>();
+		program.add_argument("--subnet-prefix4")
+			.help("prefix length of subnets aggregating IPv4 sources")
+			.default_value(unsigned(24))
+			.scan<'u', unsigned>();
+		program.add_argument("--subnet-prefix6")
+			.help("prefix length of subnets aggregating IPv6 sources")
+			.default_value(unsigned(64))
+			.scan<'u', unsigned>();
+		program.add_argument("--max-subnets")
+			.help("maximal number of tracked subnets, distributed scans are not detected if 0")
+			.default_value(size_t(100'000))
+			.scan<'u', size_t>();
+		program.add_argument("--max-suspect-subnets")
+			.help("maximal number of tracked suspicious subnets")
+			.default_value(size_t(1'000))
+			.scan<'u', size_t>();
+		program.add_argument("--subnet-min-sources")
+			.help("minimal number of sources of a distributed scan")
+			.default_value(size_t(3))
+			.scan<'u', size_t>();
+		program.add_argument("--workers")
+			.help("number of worker threads, records are processed by the receiving thread if 0")
+			.default_value(size_t(0))
+			.scan<'u', size_t>();
+		program.add_argument("--snapshot-file")
+			.help("file with the snapshot of the detector state, snapshots are disabled if empty")
+			.default_value(std::string(""));
+		program.add_argument("--snapshot-interval")
+			.help("seconds between snapshots of the detector state")
+			.default_value(uint64_t(300))
+			.scan<'u', uint64_t>();
+		program.add_argument("--exclude-file")
+			.help("file with prefixes of benign sources and destinations excluded from the detection, reloaded on SIGHUP")
+			.default_value(std::string(""));
+		program.add_argument("--spool-dir")
+			.help("spool directory of the Warden filer, IDEA messages are not written if empty")
+			.default_value(std::string(""));
+		program.add_argument("--warden-node")
+			.help("node name reported in IDEA messages")
+			.default_value(std::string("nemea.scan_detector"));
+		program.add_argument("--unirec-output")
+			.help("send an aggregated UniRec record for every detected scanner to the output interface")
+			.default_value(false)
+			.implicit_value(true);
+		program.add_argument("-m", "--appfs-mountpoint")
+			.help("path where the appFs directory will be mounted")
+			.default_value(std::string(""));
+	} catch (const std::exception& ex) {
+		logger->error(ex.what());
+		return EXIT_FAILURE;
+	}
 
 	try {
 		unirec.init(argc, argv);
@@ -122,245 +191,466 @@ int main(int argc, char** argv)
 		std::cerr << program;
 		return EXIT_SUCCESS;
 	} catch (std::exception& ex) {
-		//logger->error(ex.what());
+		logger->error(ex.what());
 		return EXIT_FAILURE;
 	}
 
-	try {//TODO: change this
+	try {
 		program.parse_args(argc, argv);
 	} catch (const std::exception& ex) {
-		//logger->error(ex.what());
+		logger->error(ex.what());
 		std::cerr << program;
 
 		return EXIT_FAILURE;
 	}
 
+	ScanDetector::ScanDetectorConfig config;
+	ScanDetector::ReportWriterConfig reportConfig;
+	size_t workers = 0;
+	std::string snapshotPath;
+	uint64_t snapshotInterval = 0;
+	std::string exclusionPath;
+	try {
+		config.trw.detectionProbability = program.get<double>("--trw-pd");
+		config.trw.falsePositiveProbability = program.get<double>("--trw-pf");
+		config.trw.benignSuccessProbability = program.get<double>("--trw-theta0");
+		config.trw.scannerSuccessProbability = program.get<double>("--trw-theta1");
+		config.inactiveTimeout = program.get<uint64_t>("--inactive-timeout");
+		config.maxSources = program.get<size_t>("--max-sources");
+		config.maxSuspects = program.get<size_t>("--max-suspects");
+		config.maxSuspectTargets = program.get<size_t>("--max-suspect-targets");
+		if (config.maxSuspectTargets == 0) {
+			throw std::invalid_argument("Maximal number of targets per suspect must be positive");
+		}
+		config.evidencePoolSize = program.get<size_t>("--evidence-pool-size");
+		config.evidenceHead = program.get<size_t>("--evidence-head");
+		config.evidenceTail = program.get<size_t>("--evidence-tail");
+		const auto subnetPrefix4 = program.get<unsigned>("--subnet-prefix4");
+		const auto subnetPrefix6 = program.get<unsigned>("--subnet-prefix6");
+		if (subnetPrefix4 < 1 || subnetPrefix4 > 32 || subnetPrefix6 < 1 || subnetPrefix6 > 128) {
+			throw std::invalid_argument("Subnet prefix lengths must be in range 1-32 and 1-128");
+		}
+		config.subnetPrefix4 = static_cast<uint8_t>(subnetPrefix4);
+		config.subnetPrefix6 = static_cast<uint8_t>(subnetPrefix6);
+		config.maxSubnets = program.get<size_t>("--max-subnets");
+		config.maxSuspectSubnets = program.get<size_t>("--max-suspect-subnets");
+		config.subnetMinSources = program.get<size_t>("--subnet-min-sources");
+		workers = program.get<size_t>("--workers");
+		snapshotPath = program.get<std::string>("--snapshot-file");
+		snapshotInterval = program.get<uint64_t>("--snapshot-interval");
+		exclusionPath = program.get<std::string>("--exclude-file");
+		reportConfig.spoolDirectory = program.get<std::string>("--spool-dir");
+		reportConfig.nodeName = program.get<std::string>("--warden-node");
+	} catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::shared_ptr<telemetry::Directory> telemetryRootDirectory;
+	telemetryRootDirectory = telemetry::Directory::create();
+
+	std::unique_ptr<telemetry::appFs::AppFsFuse> appFs;
+
+	try {
+		auto mountPoint = program.get<std::string>("--appfs-mountpoint");
+		if (!mountPoint.empty()) {
+			const bool tryToUnmountOnStart = true;
+			const bool createMountPoint = true;
+			appFs = std::make_unique<telemetry::appFs::AppFsFuse>(
+				telemetryRootDirectory,
+				mountPoint,
+				tryToUnmountOnStart,
+				createMountPoint);
+			appFs->start();
+		}
+	} catch (std::exception& ex) {
+		logger->error(ex.what());
+		return EXIT_FAILURE;
+	}
+
 	try {
+		std::optional<UnirecOutputInterface> oInterface;
+		if (unirecOutput) {
+			oInterface.emplace(unirec.buildOutputInterface());
+		}
+
+		//reports are formatted and written on a background thread
+		ScanDetector::ReportWriter reportWriter(reportConfig, oInterface ? &*oInterface : nullptr);
+
+		auto reportCallback = [&reportWriter](const ScanDetector::ScannerReport& report) {
+			reportWriter.submit(report);
+		};
+
 		UnirecInputInterface iInterface = unirec.buildInputInterface();
 		iInterface.setRequieredFormat("ipaddr SRC_IP, ipaddr DST_IP, uint8 TCP_FLAGS, uint16 DST_PORT");
+		iInterface.setTimeout(receiveTimeout);
 
-		CircularBuffer circBuff(bufferSize, iInterface.getTemplate(), 0);
+		CircularBuffer circBuff(bufferSize);
 
-		//initiate the threads
-		std::thread t1(monitorOfIpMap);
-		std::thread t2(monitorOfSusIpMap);
+		ScanDetector::ExclusionList exclusions;
+		if (!exclusionPath.empty()) {
+			exclusions = ScanDetector::ExclusionList::load(exclusionPath);
+			logger->info("Loaded {} excluded address ranges", exclusions.size());
+		}
+
+		auto telemetryInputDirectory = telemetryRootDirectory->addDir("input");
+		const telemetry::FileOps inputFileOps
+			= {[&iInterface]() { return Nm::getInterfaceTelemetry(iInterface); }, nullptr};
+		const auto inputFile = telemetryInputDirectory->addFile("stats", inputFileOps);
+		Nm::Instrumentation::setTelemetryDirectory(telemetryRootDirectory);
+
+		auto telemetryReportsDirectory = telemetryRootDirectory->addDir("reports");
+		const telemetry::FileOps reportsFileOps
+			= {[&reportWriter]() { return getReportWriterTelemetry(reportWriter); }, nullptr};
+		const auto reportsFile = telemetryReportsDirectory->addFile("stats", reportsFileOps);
+
+		ScanDetector::DetectorTelemetry detectorTelemetry(config, bufferSize);
+		detectorTelemetry.setTelemetryDirectory(telemetryRootDirectory->addDir("scan_detector"));
+
+		std::unique_ptr<ScanDetector::SnapshotFile> snapshotFile;
+		if (!snapshotPath.empty()) {
+			snapshotFile = std::make_unique<ScanDetector::SnapshotFile>(snapshotPath);
+		}
 
-		processUnirecRecords(iInterface, circBuff);
+		if (workers > 0) {
+			ScanDetector::PartitionedDetector detector(config, workers, getCurrentTime(), reportCallback);
 
-		t1.join();
-		t2.join();
+			auto telemetryWorkersDirectory = telemetryRootDirectory->addDir("workers");
+			const telemetry::FileOps workersFileOps
+				= {[&detector]() { return getPartitionTelemetry(detector); }, nullptr};
+			const auto workersFile = telemetryWorkersDirectory->addFile("stats", workersFileOps);
+
+			runDetector(iInterface, circBuff, detector, snapshotFile.get(), snapshotInterval, detectorTelemetry, exclusions, exclusionPath);
+		} else {
+			ScanDetector::ScanDetector detector(config, getCurrentTime());
+			detector.setReportCallback(reportCallback);
+			runDetector(iInterface, circBuff, detector, snapshotFile.get(), snapshotInterval, detectorTelemetry, exclusions, exclusionPath);
+		}
 
 	} catch (std::exception& ex) {
-		//logger->error(ex.what());
+		std::cerr << ex.what() << std::endl;
 		return EXIT_FAILURE;
 	}
 
 	return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Returns the statistics of the report writer as telemetry content.
+ */
+telemetry::Content getReportWriterTelemetry(const ScanDetector::ReportWriter& reportWriter)
+{
+	const auto stats = reportWriter.getStats();
+
+	telemetry::Dict dict;
+	dict["writtenReports"] = stats.writtenReports;
+	dict["sentReports"] = stats.sentReports;
+	dict["droppedReports"] = stats.droppedReports;
+	dict["failedWrites"] = stats.failedWrites;
+	dict["batches"] = stats.batches;
+	dict["queuedReports"] = stats.queuedReports;
+	dict["lockWait"] = telemetry::ScalarWithUnit {stats.lockWaitNanoseconds / 1000.0, "us"};
+	return dict;
+}
+
+/**
+ * @brief Returns the statistics of the worker threads as telemetry content.
+ *
+ * The counters are kept per thread and only summed here, when the file is read.
+ */
+telemetry::Content getPartitionTelemetry(const ScanDetector::PartitionedDetector& detector)
+{
+	const auto stats = detector.getPartitionStats();
+
+	telemetry::Dict dict;
+	dict["workers"] = static_cast<uint64_t>(detector.partitions());
+	dict["queuedEvents"] = stats.queuedEvents;
+	dict["queueWait"] = telemetry::ScalarWithUnit {stats.queueWaitNanoseconds / 1000.0, "us"};
+	dict["statsLockWait"] = telemetry::ScalarWithUnit {stats.lockWaitNanoseconds / 1000.0, "us"};
+	dict["processedEvents"] = stats.processedEvents;
+	dict["busiestWorkerEvents"] = stats.busiestWorkerEvents;
+	return dict;
+}
+
+/**
+ * @brief Returns the current wall-clock time in seconds since the epoch.
+ *
+ * Reports carry this time, if the clock steps back the detector waits until it catches up.
+ */
+uint64_t getCurrentTime()
+{
+	const auto now = std::chrono::system_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::seconds>(now).count();
+}
+
+/**
+ * @brief Checks whether the argument was given on the command line.
+ */
+bool hasArgument(int argc, char** argv, const char* name)
+{
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 /**
  * @brief Handle a format change exception by adjusting the template.
  *
  * This function is called when a `FormatChangeException` is caught in the main loop.
- * It adjusts the template in the bidirectional interface to handle the format change.
+ * It adjusts the template in the bidirectional interface to handle the format change and
+ * resolves the ids of the fields read by the detector.
  *
  * @param iInterface Bidirectional interface for Unirec communication.
+ * @param recordReader Reader of the fields used by the detector
  */
-void handleFormatChange(UnirecInputInterface& iInterface)
+void handleFormatChange(UnirecInputInterface& iInterface, ScanDetector::FlowRecordReader& recordReader)
 {
 	iInterface.changeTemplate();
+	recordReader.changeTemplate();
 }
 
 /**
- * @brief Process the next Unirec record and categorize them.
+ * @brief Writes the detector state and the window into the snapshot file.
  *
- * This function receives the UnirecRecord and puts it into the Buffer. Then makes statistics about 
- * both the DST_IP and SRC_IP. If the SRC_IP is already in suspicious category, then it makes more detailed statistics.
+ * Worker threads of a PartitionedDetector are paused while the state is captured. In the
+ * background mode the state is captured by `fork` and written by the child process, so the
+ * detection is paused only for the duration of the `fork` call.
  *
- * @param iInterface Bidirectional interface for Unirec communication
+ * @param snapshotFile Snapshot file
+ * @param circBuff Window of the most recent records
+ * @param detector Scan detector
+ * @param background Whether to write the snapshot from a child process
  */
-void processNextRecord(UnirecInputInterface& iInterface, CircularBuffer& circBuff)
+template <typename Detector>
+void saveSnapshot(ScanDetector::SnapshotFile& snapshotFile, const CircularBuffer& circBuff, Detector& detector, bool background)
 {
-
-	writeAccess.lock();
-	std::optional<UnirecRecordView> uniRecord = iInterface.receive();
-	if (!uniRecord) {
-		return;
+	constexpr bool partitioned = std::is_same_v<Detector, ScanDetector::PartitionedDetector>;
+	uint32_t partitions = 1;
+
+	auto serialize = [&circBuff, &detector](ScanDetector::SnapshotWriter& writer) {
+		detector.serialize(writer);
+		writer.put<uint64_t>(circBuff.size());
+		circBuff.forEach([&writer](const ScanDetector::FlowRecord& flowRecord) {
+			ScanDetector::writeFlowRecord(writer, flowRecord);
+		});
+	};
+
+	if constexpr (partitioned) {
+		partitions = static_cast<uint32_t>(detector.partitions());
+		detector.pause();
 	}
-	
-	UnirecRecord unirecRecord(iInterface.getTemplate(), 0);
-    unirecRecord.copyFieldsFrom(*uniRecord);
-	//update statistics for incoming record
-	categorizeUnirecRecord(unirecRecord);
 
-	std::optional<UnirecRecord> tmpRecord = circBuff.buffInsert(unirecRecord);
-	if(!tmpRecord){//if the buffer is still not full
-		return;
+	if (background) {
+		snapshotFile.saveInBackground(partitions, serialize);
+	} else if (!snapshotFile.save(partitions, serialize)) {
+		Nm::loggerGet("main")->error("Failed to write snapshot '{}'", snapshotFile.path());
 	}
-	//convert std::opitonal to UnirecRecord
-	unirecRecord = tmpRecord.value();
 
-	categorizeUnirecRecord(unirecRecord);
-	writeAccess.unlock();
-	return;
+	if constexpr (partitioned) {
+		detector.resume();
+	}
 }
 
 /**
- * @brief Process Unirec records.
+ * @brief Restores the detector state and the window from the snapshot file.
  *
- * The `processUnirecRecords` function continuously receives Unirec records through the provided
- * bidirectional interface (`iInterface`) and does categorization. The loop runs indefinitely until
- * an end-of-file condition is encountered.
+ * An invalid or incompatible snapshot is reported and the detector starts empty.
  *
- * @param iInterface Bidirectional interface for Unirec communication.
+ * @param snapshotFile Snapshot file
+ * @param circBuff Window of the most recent records
+ * @param detector Scan detector
  */
-void processUnirecRecords(UnirecInputInterface& iInterface, CircularBuffer& circBuff)
+template <typename Detector>
+void restoreSnapshot(const ScanDetector::SnapshotFile& snapshotFile, CircularBuffer& circBuff, Detector& detector)
 {
-	while (true) {
-		try {
-			//printf("%d\n", circBuff.size());
-			processNextRecord(iInterface, circBuff);
-		} catch (FormatChangeException& ex) {
-			printf("format change\n");
-			handleFormatChange(iInterface);
-			writeAccess.unlock();
-		} catch (EoFException& ex) {
-			break;
-		} catch (std::exception& ex) {
-			std::cerr << "Exception caught: " << ex.what() << std::endl;
-			throw;
+	auto logger = Nm::loggerGet("main");
+	uint32_t partitions = 1;
+	if constexpr (std::is_same_v<Detector, ScanDetector::PartitionedDetector>) {
+		partitions = static_cast<uint32_t>(detector.partitions());
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	try {
+		const bool restored = snapshotFile.load(partitions, [&](ScanDetector::SnapshotReader& reader) {
+			detector.deserialize(reader);
+
+			const auto records = reader.get<uint64_t>();
+			for (uint64_t i = 0; i < records; i++) {
+				std::optional<ScanDetector::FlowRecord> tmpRecord
+					= circBuff.buffInsert(ScanDetector::readFlowRecord(reader));
+				if (tmpRecord) {//the window is smaller than in the snapshot
+					detector.removeRecord(*tmpRecord);
+				}
+			}
+		});
+		if (!restored) {
+			return;
 		}
+	} catch (const std::exception& ex) {
+		logger->warn("Snapshot not restored: {}", ex.what());
+		return;
 	}
+
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	logger->info(
+		"Snapshot '{}' restored in {} ms",
+		snapshotFile.path(),
+		std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
 }
 
 /**
- * @brief Monitoring of IP addresses in IpMap
- * 
- * This function is used by a thread. The thread after activation will periodically go through
- * the IpMap and tries to find suspicious IP's. The IP's are then added into a separate map.
- * Second function is erasing members that do not have records associated with them in the buffer.
- * The thread will give them one cycle to change their status, then the redundant entry will be erased.
+ * @brief Reloads the exclusion list from its file.
+ *
+ * If the file cannot be loaded, the error is reported and the current list is kept.
+ *
+ * @param exclusions Exclusion list
+ * @param exclusionPath Path to the file with the exclusion list
  */
-void monitorOfIpMap(){
-	while (true) {
-		for (auto it = ipMap.begin(); it != ipMap.end(); ) {
-			auto& [key, entry] = *it;
-			//if ip wasnt used for a extended period, the node will be erased
-			if(entry.dst == 0 && entry.src == 0 && entry.syn == 0){
-				if (entry.deathFlag == false){
-					entry.deathFlag = true;
-				}
-				else {
-					writeAccess.lock();
-					it = ipMap.erase(it);
-					writeAccess.unlock();
-				}
-				continue;
-			}
-			entry.deathFlag = false;
-			if (((double)entry.dst/entry.src) < srcDstRatio){
-				if (((double)entry.syn/ entry.src) > synSrcRatio){
-					//ip is sus
-					writeAccess.lock();
-					susIpMap[key];
-					it = ipMap.erase(it);
-					writeAccess.unlock();
-				}
-				else{
-					++it;
-				}
-			}
-			else{
-				++it;
-			}
-		}
-		std::this_thread::sleep_for(std::chrono::seconds(1));
+void reloadExclusions(ScanDetector::ExclusionList& exclusions, const std::string& exclusionPath)
+{
+	auto logger = Nm::loggerGet("main");
+	try {
+		exclusions = ScanDetector::ExclusionList::load(exclusionPath);
+		logger->info("Reloaded {} excluded address ranges", exclusions.size());
+	} catch (const std::exception& ex) {
+		logger->error("Exclusion list not reloaded: {}", ex.what());
 	}
 }
 
 /**
- * @brief Monitoring of Suspicious IP addresses in susIpMap
- * 
- * This function is used by a thread. The thread after activation will periodically go through 
- * the entries in susIpMap and tries to find scanning IP addresses among them. 
- * Based on different criteria the IP is either classified as a scanner and a report with the unirec
- * records is sent or classified as a normal address and erased from the susIpMap. 
+ * @brief Restores the state, processes records and writes the final snapshot.
+ *
+ * The final snapshot is written when the module is stopped by a signal.
+ *
+ * @param iInterface Bidirectional interface for Unirec communication
+ * @param circBuff Window of the most recent records
+ * @param detector Scan detector
+ * @param snapshotFile Snapshot file or nullptr if snapshots are disabled
+ * @param snapshotInterval Seconds between periodic snapshots
+ * @param detectorTelemetry Telemetry the statistics of the detector are published to
+ * @param exclusions Prefixes excluded from the detection
+ * @param exclusionPath Path to the file with the exclusion list, empty if there is none
  */
-void monitorOfSusIpMap(){
-	while(true) {
-		std::this_thread::sleep_for(std::chrono::seconds(5));
-		for (auto it = susIpMap.begin(); it != susIpMap.end(); ){
-			const auto& [key, entry] = *it;
-
-			//if the ratio of outgoing and incoming classifies it as a no scanner
-			if((double)entry.outRecords.size()/entry.inRecords.size() < srcDstRatio){
-				continue;
-			}
-			//if the ratio between outgoing and number of syn flags do not exceed treshold
-			if((double)entry.outRecords.size()/entry.syn < synSrcRatio){
-				continue;
-			}
+template <typename Detector>
+void runDetector(UnirecInputInterface& iInterface, CircularBuffer& circBuff, Detector& detector, ScanDetector::SnapshotFile* snapshotFile, uint64_t snapshotInterval, ScanDetector::DetectorTelemetry& detectorTelemetry, ScanDetector::ExclusionList& exclusions, const std::string& exclusionPath)
+{
+	if (snapshotFile != nullptr) {
+		restoreSnapshot(*snapshotFile, circBuff, detector);
+	}
 
-			if (entry.dstIpMap.size() < minSize){
-				continue;
-			}
-			int cnt = 0;
-			for (auto it2 = entry.dstIpMap.begin(); it2 != entry.dstIpMap.end(); ){
-				const auto& [key1, entry1] = *it2;
-				if (entry1.count == entry1.portMap.size()){
-					++cnt;
-				}
-			}
+	processUnirecRecords(iInterface, circBuff, detector, snapshotFile, snapshotInterval, detectorTelemetry, exclusions, exclusionPath);
 
-			if ((double)cnt/entry.dstIpMap.size() > susNorRatio){
-				//report to Warden ?
-			}
-			else {
-				//erase it from susIpMap ?
-			}
-		}
+	if (snapshotFile != nullptr && g_stopFlag.load()) {
+		snapshotFile->waitForSave();
+		saveSnapshot(*snapshotFile, circBuff, detector, false);
 	}
 }
 
 /**
- * @brief Categorizes based on IPs
- * 
- * This function takes a Unirec Record and updates statistics held in tables based on the SRC_IP and DST_IP.
- * 
- * @param unirecRecord received Unirec Record 
+ * @brief Process the next Unirec record and categorize them.
+ *
+ * This function receives the UnirecRecord, reads the fields used by the detector straight from
+ * the receive buffer and puts them into the Buffer. Then the detector updates
+ * statistics about both the DST_IP and SRC_IP. The record that fell out of the buffer is removed
+ * from the statistics. Suspicious sources are evaluated by the detector as soon as their
+ * statistics change, inactive entries are expired when the time advances.
+ *
+ * The detector is either a ScanDetector or a PartitionedDetector that hands the record over to
+ * its worker threads.
+ *
+ * Records of excluded sources and destinations are dropped before they touch any table and
+ * they do not enter the window either, so a reload of the exclusion list never removes a record
+ * that was not added.
+ *
+ * @param iInterface Bidirectional interface for Unirec communication
+ * @param recordReader Reader of the fields used by the detector
+ * @param circBuff Window of the most recent records
+ * @param detector Scan detector
+ * @param exclusions Prefixes excluded from the detection
+ * @param now Current time in seconds
  */
-void categorizeUnirecRecord(UnirecRecord unirecRecord){
-	static const ur_field_id_t SRC_IP = ur_get_id_by_name("SRC_IP");	
-	static const ur_field_id_t DST_IP = ur_get_id_by_name("DST_IP");
-	static const ur_field_id_t TCP_FLAGS = ur_get_id_by_name("TCP_FLAGS");
-	static const ur_field_id_t DST_PORT = ur_get_id_by_name("DST_PORT");
-
-	IpAddress srcStruct = unirecRecord.getFieldAsType<IpAddress>(SRC_IP);
-	ip_addr_t src = srcStruct.ip;
-	IpAddress dstStruct = unirecRecord.getFieldAsType<IpAddress>(DST_IP);
-	ip_addr_t dst = dstStruct.ip;
-	uint8_t tcp = unirecRecord.getFieldAsType<uint8_t>(TCP_FLAGS);
-	if(susIpMap.find(src) != susIpMap.end()){
-		if(tcp == 2){
-			susIpMap[src].syn++;
-		}
-		//associative array of ips and number of times they were mentioned
-		susIpMap[src].dstIpMap[dst].count++;
-		//array of ports and number of times they were used
-		uint16_t port = unirecRecord.getFieldAsType<uint16_t>(DST_PORT);
-		susIpMap[src].dstIpMap[dst].portMap[port]++;
-		//insert unirecRecord from suspicious ip
-		susIpMap[src].outRecords.push_back(unirecRecord);
+template <typename Detector>
+void processNextRecord(UnirecInputInterface& iInterface, const ScanDetector::FlowRecordReader& recordReader, CircularBuffer& circBuff, Detector& detector, const ScanDetector::ExclusionList& exclusions, uint64_t now)
+{
+	detector.advanceTime(now);
+
+	Nm::ScopedTimer receiveTimer(Nm::g_receiveProbe);
+	std::optional<UnirecRecordView> uniRecord = iInterface.receive();
+	if (!uniRecord) {
+		receiveTimer.cancel();
+		return;
 	}
-	else if (susIpMap.find(dst) != susIpMap.end()){
-		susIpMap[dst].inRecords.push_back(unirecRecord);
+	receiveTimer.stop();
+
+	const Nm::ScopedTimer processTimer(Nm::g_processProbe);
+	const ScanDetector::FlowRecord flowRecord = recordReader.read(*uniRecord);
+	if (exclusions.excludes(flowRecord)) {
+		return;
 	}
-	else {
-		ipMap[src].src++;
-		ipMap[dst].dst++;
-		if(tcp == 2){
-			ipMap[src].syn++;
-		}
+
+	//update statistics for incoming record
+	detector.addRecord(flowRecord);
+
+	std::optional<ScanDetector::FlowRecord> tmpRecord = circBuff.buffInsert(flowRecord);
+	if(!tmpRecord){//if the buffer is still not full
+		return;
 	}
+
+	//the oldest record left the window
+	detector.removeRecord(*tmpRecord);
 }
 
+/**
+ * @brief Process Unirec records.
+ *
+ * The `processUnirecRecords` function continuously receives Unirec records through the provided
+ * bidirectional interface (`iInterface`) and does categorization. The loop runs until
+ * an end-of-file condition is encountered or the module is interrupted. Snapshots of the state
+ * are written periodically in the background and the statistics of the detector are published
+ * to the telemetry once per second. The exclusion list is reloaded after SIGHUP.
+ *
+ * @param iInterface Bidirectional interface for Unirec communication.
+ * @param circBuff Window of the most recent records
+ * @param detector Scan detector
+ * @param snapshotFile Snapshot file or nullptr if snapshots are disabled
+ * @param snapshotInterval Seconds between snapshots
+ * @param detectorTelemetry Telemetry the statistics of the detector are published to
+ * @param exclusions Prefixes excluded from the detection
+ * @param exclusionPath Path to the file with the exclusion list, empty if there is none
+ */
+template <typename Detector>
+void processUnirecRecords(UnirecInputInterface& iInterface, CircularBuffer& circBuff, Detector& detector, ScanDetector::SnapshotFile* snapshotFile, uint64_t snapshotInterval, ScanDetector::DetectorTelemetry& detectorTelemetry, ScanDetector::ExclusionList& exclusions, const std::string& exclusionPath)
+{
+	uint64_t nextSnapshot = getCurrentTime() + snapshotInterval;
+	uint64_t lastPublish = 0;
+	ScanDetector::FlowRecordReader recordReader;
+
+	while (!g_stopFlag.load()) {
+		const uint64_t now = getCurrentTime();
+		if (snapshotFile != nullptr && now >= nextSnapshot) {
+			saveSnapshot(*snapshotFile, circBuff, detector, true);
+			nextSnapshot = now + snapshotInterval;
+		}
+		if (now != lastPublish) {
+			detectorTelemetry.publish(now, detector.getStats(), circBuff.size());
+			lastPublish = now;
+		}
+		if (g_reloadFlag.exchange(false) && !exclusionPath.empty()) {
+			reloadExclusions(exclusions, exclusionPath);
+		}
+
+		try {
+			processNextRecord(iInterface, recordReader, circBuff, detector, exclusions, now);
+		} catch (FormatChangeException& ex) {
+			handleFormatChange(iInterface, recordReader);
+		} catch (EoFException& ex) {
+			break;
+		} catch (std::exception& ex) {
+			std::cerr << "Exception caught: " << ex.what() << std::endl;
+			throw;
+		}
+	}
+}
@@ -0,0 +1,318 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Implementation of the PartitionedDetector class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "partitionedDetector.hpp"
+#include "ipAddressHash.hpp"
+#include "ipPrefix.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr size_t QUEUE_CAPACITY = 65536;
+constexpr unsigned SPIN_ITERATIONS = 64;
+constexpr unsigned YIELD_ITERATIONS = 256;
+constexpr std::chrono::microseconds IDLE_SLEEP {50};
+
+size_t divideCapacity(size_t capacity, size_t workers)
+{
+	const size_t part = (capacity + workers - 1) / workers;
+	return part > 0 ? part : 1;
+}
+
+} // namespace
+
+namespace ScanDetector {
+
+PartitionedDetector::Worker::Worker(const ScanDetectorConfig& config, uint64_t now)
+	: detector(config, now)
+	, queue(QUEUE_CAPACITY)
+{
+}
+
+PartitionedDetector::PartitionedDetector(
+	const ScanDetectorConfig& config,
+	size_t workers,
+	uint64_t now,
+	const ScanDetector::ReportCallback& reportCallback)
+	: m_now(now)
+	, m_aggregateSubnets(config.maxSubnets > 0)
+	, m_subnetPrefix4(config.subnetPrefix4)
+	, m_subnetPrefix6(config.subnetPrefix6)
+{
+	if (workers == 0) {
+		throw std::invalid_argument("PartitionedDetector: number of workers must be positive");
+	}
+
+	ScanDetectorConfig workerConfig = config;
+	workerConfig.maxSources = divideCapacity(config.maxSources, workers);
+	workerConfig.maxSuspects = divideCapacity(config.maxSuspects, workers);
+	workerConfig.evidencePoolSize = divideCapacity(config.evidencePoolSize, workers);
+	if (config.maxSubnets > 0) {
+		workerConfig.maxSubnets = divideCapacity(config.maxSubnets, workers);
+		workerConfig.maxSuspectSubnets = divideCapacity(config.maxSuspectSubnets, workers);
+	}
+
+	for (size_t i = 0; i < workers; i++) {
+		m_workers.push_back(std::make_unique<Worker>(workerConfig, now));
+		m_workers.back()->detector.setReportCallback(reportCallback);
+	}
+
+	for (auto& worker : m_workers) {
+		worker->thread = std::thread(&PartitionedDetector::runWorker, this, std::ref(*worker));
+	}
+}
+
+PartitionedDetector::~PartitionedDetector()
+{
+	Event stop;
+	stop.type = Event::Type::Stop;
+	for (auto& worker : m_workers) {
+		push(*worker, stop);
+	}
+	for (auto& worker : m_workers) {
+		if (worker->thread.joinable()) {
+			worker->thread.join();
+		}
+	}
+}
+
+void PartitionedDetector::addRecord(const FlowRecord& flow)
+{
+	dispatch(Event::Type::Add, flow);
+}
+
+void PartitionedDetector::removeRecord(const FlowRecord& flow)
+{
+	dispatch(Event::Type::Remove, flow);
+}
+
+void PartitionedDetector::advanceTime(uint64_t now)
+{
+	if (now <= m_now) {
+		return;
+	}
+	m_now = now;
+
+	Event tick;
+	tick.type = Event::Type::Tick;
+	tick.time = now;
+	for (auto& worker : m_workers) {
+		push(*worker, tick);
+	}
+}
+
+ScanDetectorStats PartitionedDetector::getStats() const
+{
+	ScanDetectorStats total;
+	for (const auto& worker : m_workers) {
+		const std::lock_guard<std::mutex> lock(worker->statsMutex);
+		const ScanDetectorStats& stats = worker->stats;
+		total.sources += stats.sources;
+		total.suspects += stats.suspects;
+		total.detectedScanners += stats.detectedScanners;
+		total.expiredSources += stats.expiredSources;
+		total.expiredSuspects += stats.expiredSuspects;
+		total.evaluatedSuspects += stats.evaluatedSuspects;
+		total.evictedSources += stats.evictedSources;
+		total.evictedSourceRecords += stats.evictedSourceRecords;
+		total.evictedSuspects += stats.evictedSuspects;
+		total.evidenceRecords += stats.evidenceRecords;
+		total.droppedEvidence += stats.droppedEvidence;
+		total.subnets += stats.subnets;
+		total.suspectSubnets += stats.suspectSubnets;
+		total.detectedSubnets += stats.detectedSubnets;
+		total.expiredSubnets += stats.expiredSubnets;
+		total.evictedSubnets += stats.evictedSubnets;
+		total.timerSweeps += stats.timerSweeps;
+		total.timerSweepNanoseconds += stats.timerSweepNanoseconds;
+		total.maxTimerSweepNanoseconds
+			= std::max(total.maxTimerSweepNanoseconds, stats.maxTimerSweepNanoseconds);
+	}
+	return total;
+}
+
+PartitionStats PartitionedDetector::getPartitionStats() const noexcept
+{
+	PartitionStats total;
+	total.queueWaitNanoseconds = m_queueWaitNanoseconds.load();
+	for (const auto& worker : m_workers) {
+		total.queuedEvents += worker->queue.sizeApprox();
+		total.lockWaitNanoseconds += worker->lockWaitNanoseconds.load();
+		const uint64_t processedEvents = worker->processedEvents.load();
+		total.processedEvents += processedEvents;
+		total.busiestWorkerEvents = std::max(total.busiestWorkerEvents, processedEvents);
+	}
+	return total;
+}
+
+void PartitionedDetector::pause()
+{
+	m_pauseGeneration++;
+	m_pausedWorkers.store(0);
+
+	Event pause;
+	pause.type = Event::Type::Pause;
+	pause.time = m_pauseGeneration;
+	for (auto& worker : m_workers) {
+		push(*worker, pause);
+	}
+
+	while (m_pausedWorkers.load(std::memory_order_acquire) < m_workers.size()) {
+		std::this_thread::yield();
+	}
+}
+
+void PartitionedDetector::resume()
+{
+	m_resumedGeneration.store(m_pauseGeneration, std::memory_order_release);
+}
+
+void PartitionedDetector::serialize(SnapshotWriter& writer) const noexcept
+{
+	for (const auto& worker : m_workers) {
+		worker->detector.serialize(writer);
+	}
+}
+
+void PartitionedDetector::deserialize(SnapshotReader& reader)
+{
+	pause();
+	try {
+		for (auto& worker : m_workers) {
+			worker->detector.deserialize(reader);
+			publishStats(*worker);
+		}
+	} catch (...) {
+		resume();
+		throw;
+	}
+	resume();
+}
+
+size_t PartitionedDetector::partitionOf(const ip_addr_t& address) const noexcept
+{
+	return static_cast<size_t>(mixAddress(address) % m_workers.size());
+}
+
+size_t PartitionedDetector::subnetPartitionOf(const ip_addr_t& address) const noexcept
+{
+	// all addresses of an aggregated subnet have to be accounted by the same worker
+	const ip_addr_t subnet = applyPrefix(address, m_subnetPrefix4, m_subnetPrefix6);
+	return static_cast<size_t>(mixAddress(subnet) % m_workers.size());
+}
+
+void PartitionedDetector::dispatch(Event::Type type, const FlowRecord& flow)
+{
+	// the parts of the record owned by the same worker are merged into a single event
+	std::pair<size_t, FlowSide> parts[4];
+	size_t partCount = 0;
+	auto addPart = [&parts, &partCount](size_t worker, FlowSide side) {
+		for (size_t i = 0; i < partCount; i++) {
+			if (parts[i].first == worker) {
+				parts[i].second = parts[i].second | side;
+				return;
+			}
+		}
+		parts[partCount++] = {worker, side};
+	};
+
+	addPart(partitionOf(flow.src), FlowSide::Source);
+	addPart(partitionOf(flow.dst), FlowSide::Destination);
+	// removed records do not change the subnets
+	if (m_aggregateSubnets && type == Event::Type::Add) {
+		addPart(subnetPartitionOf(flow.src), FlowSide::SourceSubnet);
+		addPart(subnetPartitionOf(flow.dst), FlowSide::DestinationSubnet);
+	}
+
+	Event event;
+	event.type = type;
+	event.flow = flow;
+	for (size_t i = 0; i < partCount; i++) {
+		event.sides = parts[i].second;
+		push(*m_workers[parts[i].first], event);
+	}
+}
+
+void PartitionedDetector::push(Worker& worker, const Event& event)
+{
+	if (worker.queue.tryPush(event)) {
+		return;
+	}
+
+	// a full queue slows the receiver down instead of dropping records
+	const auto start = std::chrono::steady_clock::now();
+	while (!worker.queue.tryPush(event)) {
+		std::this_thread::yield();
+	}
+	m_queueWaitNanoseconds.add(nanosecondsSince(start));
+}
+
+void PartitionedDetector::waitForResume(uint64_t generation)
+{
+	m_pausedWorkers.fetch_add(1, std::memory_order_acq_rel);
+	while (m_resumedGeneration.load(std::memory_order_acquire) < generation) {
+		std::this_thread::sleep_for(IDLE_SLEEP);
+	}
+}
+
+void PartitionedDetector::runWorker(Worker& worker)
+{
+	Event event;
+	unsigned idle = 0;
+
+	while (true) {
+		if (!worker.queue.tryPop(event)) {
+			if (++idle > SPIN_ITERATIONS + YIELD_ITERATIONS) {
+				std::this_thread::sleep_for(IDLE_SLEEP);
+			} else if (idle > SPIN_ITERATIONS) {
+				std::this_thread::yield();
+			}
+			continue;
+		}
+		idle = 0;
+
+		switch (event.type) {
+		case Event::Type::Add:
+			worker.detector.addRecord(event.flow, event.sides);
+			worker.processedEvents.add();
+			break;
+		case Event::Type::Remove:
+			worker.detector.removeRecord(event.flow, event.sides);
+			worker.processedEvents.add();
+			break;
+		case Event::Type::Tick:
+			worker.detector.advanceTime(event.time);
+			publishStats(worker);
+			break;
+		case Event::Type::Pause:
+			waitForResume(event.time);
+			break;
+		case Event::Type::Stop:
+			publishStats(worker);
+			return;
+		}
+	}
+}
+
+void PartitionedDetector::publishStats(Worker& worker)
+{
+	const ScanDetectorStats stats = worker.detector.getStats();
+	std::unique_lock<std::mutex> lock(worker.statsMutex, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		const auto start = std::chrono::steady_clock::now();
+		lock.lock();
+		worker.lockWaitNanoseconds.add(nanosecondsSince(start));
+	}
+	worker.stats = stats;
+}
+
+} // namespace ScanDetector
@@ -0,0 +1,188 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Declaration of the PartitionedDetector class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "flowRecord.hpp"
+#include "ring/spscRing.hpp"
+#include "scanDetector.hpp"
+#include "threadCounter.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ScanDetector {
+
+/**
+ * @brief Statistics of the distribution of work between the workers.
+ */
+struct PartitionStats {
+	uint64_t queuedEvents = 0; ///< Number of events waiting in the queues.
+	uint64_t queueWaitNanoseconds = 0; ///< Time the receiving thread waited for full queues.
+	uint64_t lockWaitNanoseconds = 0; ///< Time the workers waited to publish statistics.
+	uint64_t processedEvents = 0; ///< Number of record events processed by all workers.
+	uint64_t busiestWorkerEvents = 0; ///< Number of record events processed by the busiest worker.
+};
+
+/**
+ * @brief Scan detector that spreads the work over worker threads.
+ *
+ * IP addresses are hash-partitioned between the workers by the whole address and every worker
+ * owns a ScanDetector with its own tables, so no locks are needed. Aggregated subnets are
+ * partitioned separately by the subnet, so the addresses of one subnet, e.g. the targets of a
+ * horizontal scan, are spread over all workers and only the lighter subnet statistics stay on
+ * one worker. The receiving thread splits every record into events for the owners of the
+ * source, of the destination and of their subnets (parts owned by the same worker share one
+ * event) and passes them over per-worker SPSC queues. All statistics of an IP address or of a
+ * subnet are therefore updated by one thread only. Capacities of the tables and of the evidence
+ * pool are divided between the workers.
+ *
+ * Methods are called only from the receiving thread, except getStats() and getPartitionStats(),
+ * which can be called from any thread.
+ */
+class PartitionedDetector {
+public:
+	/**
+	 * @brief Starts the worker threads.
+	 *
+	 * @param config Configuration of the whole detector.
+	 * @param workers Number of worker threads.
+	 * @param now Current time in seconds.
+	 * @param reportCallback Callback invoked for detected scanners, called from worker threads.
+	 * @throw std::invalid_argument If the number of workers is zero.
+	 */
+	PartitionedDetector(
+		const ScanDetectorConfig& config,
+		size_t workers,
+		uint64_t now = 0,
+		const ScanDetector::ReportCallback& reportCallback = nullptr);
+
+	/**
+	 * @brief Processes the queued events and stops the worker threads.
+	 */
+	~PartitionedDetector();
+
+	PartitionedDetector(const PartitionedDetector&) = delete;
+	PartitionedDetector& operator=(const PartitionedDetector&) = delete;
+
+	/**
+	 * @brief Dispatches a record that entered the window.
+	 */
+	void addRecord(const FlowRecord& flow);
+
+	/**
+	 * @brief Dispatches a record that left the window.
+	 */
+	void removeRecord(const FlowRecord& flow);
+
+	/**
+	 * @brief Advances time of all workers.
+	 * @param now Current time in seconds.
+	 */
+	void advanceTime(uint64_t now);
+
+	/**
+	 * @brief Returns the sum of statistics of all workers.
+	 *
+	 * Workers publish their statistics whenever the time advances.
+	 */
+	ScanDetectorStats getStats() const;
+
+	/**
+	 * @brief Returns statistics of the queues and of the waiting of the threads.
+	 *
+	 * The counters are owned by the individual threads and summed up only here.
+	 */
+	PartitionStats getPartitionStats() const noexcept;
+
+	/**
+	 * @brief Returns the number of partitions.
+	 */
+	size_t partitions() const noexcept { return m_workers.size(); }
+
+	/**
+	 * @brief Stops all workers after they process the queued events.
+	 *
+	 * The state of the workers does not change until resume() is called.
+	 */
+	void pause();
+
+	/**
+	 * @brief Resumes workers stopped by pause().
+	 */
+	void resume();
+
+	/**
+	 * @brief Writes the state of all partitions into a snapshot.
+	 *
+	 * The workers have to be paused. The method does not allocate, so it can be called in a
+	 * forked child.
+	 */
+	void serialize(SnapshotWriter& writer) const noexcept;
+
+	/**
+	 * @brief Restores the state of all partitions from a snapshot.
+	 * @throw std::runtime_error If the snapshot is malformed.
+	 */
+	void deserialize(SnapshotReader& reader);
+
+private:
+	struct Event {
+		enum class Type : uint8_t {
+			Add,
+			Remove,
+			Tick,
+			Pause,
+			Stop,
+		};
+
+		Type type = Type::Tick;
+		FlowSide sides = FlowSide::Both;
+		uint64_t time = 0;
+		FlowRecord flow {};
+	};
+
+	struct Worker {
+		Worker(const ScanDetectorConfig& config, uint64_t now);
+
+		ScanDetector detector;
+		Nm::SpscRing<Event> queue;
+		std::thread thread;
+
+		mutable std::mutex statsMutex;
+		ScanDetectorStats stats;
+		ThreadCounter lockWaitNanoseconds;
+		ThreadCounter processedEvents;
+	};
+
+	void runWorker(Worker& worker);
+	void waitForResume(uint64_t generation);
+	static void publishStats(Worker& worker);
+
+	size_t partitionOf(const ip_addr_t& address) const noexcept;
+	size_t subnetPartitionOf(const ip_addr_t& address) const noexcept;
+	void dispatch(Event::Type type, const FlowRecord& flow);
+	void push(Worker& worker, const Event& event);
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	uint64_t m_now;
+	bool m_aggregateSubnets;
+	uint8_t m_subnetPrefix4;
+	uint8_t m_subnetPrefix6;
+	ThreadCounter m_queueWaitNanoseconds;
+
+	uint64_t m_pauseGeneration = 0;
+	std::atomic<size_t> m_pausedWorkers {0};
+	std::atomic<uint64_t> m_resumedGeneration {0};
+};
+
+} // namespace ScanDetector
@@ -0,0 +1,135 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Implementation of the PrefixSet class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "prefixSet.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+uint64_t readBigEndian(const uint8_t* bytes, unsigned length) noexcept
+{
+	uint64_t value = 0;
+	for (unsigned i = 0; i < length; i++) {
+		value = (value << 8) | bytes[i];
+	}
+	return value;
+}
+
+// IPv4 addresses are stored in bytes 8 to 11 of the IPv6-sized structure
+uint32_t keyOf4(const ip_addr_t& address) noexcept
+{
+	return static_cast<uint32_t>(readBigEndian(address.ui8 + 8, 4));
+}
+
+std::pair<uint64_t, uint64_t> keyOf6(const ip_addr_t& address) noexcept
+{
+	return {readBigEndian(address.ui8, 8), readBigEndian(address.ui8 + 8, 8)};
+}
+
+uint64_t hostMask(unsigned hostBits) noexcept
+{
+	return hostBits >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t {1} << hostBits) - 1;
+}
+
+bool follows(uint32_t last, uint32_t first) noexcept
+{
+	return last != std::numeric_limits<uint32_t>::max() && last + 1 == first;
+}
+
+bool follows(const std::pair<uint64_t, uint64_t>& last, const std::pair<uint64_t, uint64_t>& first) noexcept
+{
+	constexpr uint64_t MAX = std::numeric_limits<uint64_t>::max();
+	if (last.second != MAX) {
+		return first.first == last.first && first.second == last.second + 1;
+	}
+	return last.first != MAX && first.first == last.first + 1 && first.second == 0;
+}
+
+template <typename Range>
+void compactRanges(std::vector<Range>& ranges)
+{
+	std::sort(ranges.begin(), ranges.end(), [](const Range& lhs, const Range& rhs) {
+		return lhs.first < rhs.first;
+	});
+
+	size_t merged = 0;
+	for (size_t i = 0; i < ranges.size(); i++) {
+		if (merged > 0) {
+			Range& previous = ranges[merged - 1];
+			if (!(previous.last < ranges[i].first) || follows(previous.last, ranges[i].first)) {
+				previous.last = std::max(previous.last, ranges[i].last);
+				continue;
+			}
+		}
+		ranges[merged++] = ranges[i];
+	}
+	ranges.resize(merged);
+	ranges.shrink_to_fit();
+}
+
+template <typename Range, typename Key>
+bool containsKey(const std::vector<Range>& ranges, const Key& key) noexcept
+{
+	auto it = std::upper_bound(ranges.begin(), ranges.end(), key, [](const Key& value, const Range& range) {
+		return value < range.first;
+	});
+	if (it == ranges.begin()) {
+		return false;
+	}
+	--it;
+	return !(it->last < key);
+}
+
+} // namespace
+
+namespace ScanDetector {
+
+void PrefixSet::insert(const ip_addr_t& address, uint8_t prefixLength)
+{
+	if (ip_is4(&address)) {
+		if (prefixLength > 32) {
+			throw std::invalid_argument(
+				"PrefixSet: IPv4 prefix length " + std::to_string(prefixLength) + " is out of range");
+		}
+		const auto mask = static_cast<uint32_t>(hostMask(32U - prefixLength));
+		const uint32_t key = keyOf4(address);
+		m_ranges4.push_back({key & ~mask, key | mask});
+		return;
+	}
+
+	if (prefixLength > 128) {
+		throw std::invalid_argument(
+			"PrefixSet: IPv6 prefix length " + std::to_string(prefixLength) + " is out of range");
+	}
+	const unsigned hostBits = 128U - prefixLength;
+	const uint64_t highMask = hostBits > 64 ? hostMask(hostBits - 64) : 0;
+	const uint64_t lowMask = hostMask(std::min(hostBits, 64U));
+	const Key6 key = keyOf6(address);
+	m_ranges6.push_back(
+		{{key.first & ~highMask, key.second & ~lowMask}, {key.first | highMask, key.second | lowMask}});
+}
+
+void PrefixSet::compact()
+{
+	compactRanges(m_ranges4);
+	compactRanges(m_ranges6);
+}
+
+bool PrefixSet::contains(const ip_addr_t& address) const noexcept
+{
+	if (ip_is4(&address)) {
+		return !m_ranges4.empty() && containsKey(m_ranges4, keyOf4(address));
+	}
+	return !m_ranges6.empty() && containsKey(m_ranges6, keyOf6(address));
+}
+
+} // namespace ScanDetector
@@ -0,0 +1,72 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Declaration of the PrefixSet class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unirec++/unirec.hpp>
+#include <utility>
+#include <vector>
+
+namespace ScanDetector {
+
+/**
+ * @brief Set of IPv4 and IPv6 prefixes answering whether an address is covered by any of them.
+ *
+ * Only membership is needed, so the longest-prefix match collapses into a lookup in a sorted
+ * array of disjoint address ranges. Nested and adjacent prefixes are merged by compact(), so the
+ * set takes 8 bytes per IPv4 and 32 bytes per IPv6 range and a lookup is a binary search
+ * without any pointer chasing.
+ */
+class PrefixSet {
+public:
+	/**
+	 * @brief Inserts a prefix.
+	 *
+	 * The prefix is not visible to contains() until compact() is called.
+	 *
+	 * @param address Address of the prefix, host bits are ignored.
+	 * @param prefixLength Prefix length, 0-32 for IPv4 and 0-128 for IPv6.
+	 * @throw std::invalid_argument If the prefix length is out of range.
+	 */
+	void insert(const ip_addr_t& address, uint8_t prefixLength);
+
+	/**
+	 * @brief Sorts the inserted prefixes and merges overlapping and adjacent ranges.
+	 */
+	void compact();
+
+	/**
+	 * @brief Checks whether the address is covered by any prefix of the set.
+	 */
+	bool contains(const ip_addr_t& address) const noexcept;
+
+	/**
+	 * @brief Returns the number of disjoint address ranges of the set.
+	 */
+	size_t size() const noexcept { return m_ranges4.size() + m_ranges6.size(); }
+
+	/**
+	 * @brief Checks whether the set is empty.
+	 */
+	bool empty() const noexcept { return m_ranges4.empty() && m_ranges6.empty(); }
+
+private:
+	using Key6 = std::pair<uint64_t, uint64_t>;
+
+	template <typename Key>
+	struct Range {
+		Key first;
+		Key last;
+	};
+
+	std::vector<Range<uint32_t>> m_ranges4;
+	std::vector<Range<Key6>> m_ranges6;
+};
+
+} // namespace ScanDetector
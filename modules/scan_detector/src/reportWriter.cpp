@@ -0,0 +1,238 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Implementation of the ReportWriter class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "reportWriter.hpp"
+#include "WardReport.hpp"
+#include "threadCounter.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+namespace ScanDetector {
+
+namespace fs = std::filesystem;
+
+ReportWriter::ReportWriter(
+	const ReportWriterConfig& config,
+	Nemea::UnirecOutputInterface* outputInterface)
+	: m_config(config)
+	, m_outputInterface(outputInterface)
+	, m_random(std::random_device()())
+{
+	if (!m_config.spoolDirectory.empty()) {
+		fs::create_directories(fs::path(m_config.spoolDirectory) / "tmp");
+		fs::create_directories(fs::path(m_config.spoolDirectory) / "incoming");
+	}
+
+	if (m_outputInterface != nullptr) {
+		m_outputInterface->changeTemplate(UNIREC_TEMPLATE);
+		m_unirecRecord = m_outputInterface->createUnirecRecord();
+	}
+
+	m_queue.reserve(m_config.batchSize);
+	m_thread = std::thread(&ReportWriter::loopThread, this);
+}
+
+ReportWriter::~ReportWriter()
+{
+	{
+		const std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopFlag = true;
+	}
+	m_condition.notify_all();
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+void ReportWriter::submit(const ScannerReport& report)
+{
+	bool notify = false;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+		if (!lock.owns_lock()) {
+			// only contended locking is timed, so the common path stays cheap
+			const auto start = std::chrono::steady_clock::now();
+			lock.lock();
+			m_lockWaitNanoseconds.fetch_add(nanosecondsSince(start), std::memory_order_relaxed);
+		}
+
+		if (m_queue.size() >= m_config.maxQueuedReports) {
+			m_droppedReports++;
+			return;
+		}
+		m_queue.push_back(report);
+		m_queuedReports.store(m_queue.size(), std::memory_order_relaxed);
+		notify = m_queue.size() == m_config.batchSize;
+	}
+
+	if (notify) {
+		m_condition.notify_one();
+	}
+}
+
+ReportWriterStats ReportWriter::getStats() const noexcept
+{
+	ReportWriterStats stats;
+	stats.writtenReports = m_writtenReports.load();
+	stats.sentReports = m_sentReports.load();
+	stats.droppedReports = m_droppedReports.load();
+	stats.failedWrites = m_failedWrites.load();
+	stats.batches = m_batches.load();
+	stats.queuedReports = m_queuedReports.load();
+	stats.lockWaitNanoseconds = m_lockWaitNanoseconds.load();
+	return stats;
+}
+
+void ReportWriter::loopThread()
+{
+	std::vector<ScannerReport> batch;
+	batch.reserve(m_config.batchSize);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_condition.wait_for(lock, m_config.flushInterval, [this] {
+			return m_stopFlag || m_queue.size() >= m_config.batchSize;
+		});
+
+		const bool stop = m_stopFlag;
+		batch.swap(m_queue);
+		m_queuedReports.store(0, std::memory_order_relaxed);
+
+		// formatting and I/O is done without the lock, so detection is never blocked
+		lock.unlock();
+		if (!batch.empty()) {
+			writeBatch(batch);
+			batch.clear();
+		}
+		lock.lock();
+
+		if (stop && m_queue.empty()) {
+			break;
+		}
+	}
+}
+
+void ReportWriter::writeBatch(const std::vector<ScannerReport>& batch)
+{
+	for (const auto& report : batch) {
+		if (!m_config.spoolDirectory.empty()) {
+			writeIdeaMessage(report);
+		}
+		if (m_outputInterface != nullptr) {
+			sendUnirecRecord(report);
+		}
+	}
+
+	if (m_outputInterface != nullptr) {
+		m_outputInterface->sendFlush();
+	}
+	m_batches++;
+}
+
+void ReportWriter::writeIdeaMessage(const ScannerReport& report)
+{
+	const std::string messageId = createMessageId();
+	const std::string fileName = std::to_string(report.detectTime) + "." + std::to_string(getpid())
+		+ "." + std::to_string(m_fileSequence++) + ".idea";
+	const fs::path tmpPath = fs::path(m_config.spoolDirectory) / "tmp" / fileName;
+	const fs::path incomingPath = fs::path(m_config.spoolDirectory) / "incoming" / fileName;
+
+	{
+		std::ofstream file(tmpPath, std::ios::out | std::ios::trunc);
+		file << createIdeaMessage(report, m_config.nodeName, messageId) << '\n';
+		file.close();
+		if (!file) {
+			m_logger->error("Failed to write IDEA message '{}'", tmpPath.string());
+			m_failedWrites++;
+			return;
+		}
+	}
+
+	std::error_code error;
+	fs::rename(tmpPath, incomingPath, error);
+	if (error) {
+		m_logger->error("Failed to move IDEA message '{}': {}", tmpPath.string(), error.message());
+		fs::remove(tmpPath, error);
+		m_failedWrites++;
+		return;
+	}
+
+	m_writtenReports++;
+}
+
+void ReportWriter::sendUnirecRecord(const ScannerReport& report)
+{
+	static const ur_field_id_t SRC_IP = ur_get_id_by_name("SRC_IP");
+	static const ur_field_id_t TIME_FIRST = ur_get_id_by_name("TIME_FIRST");
+	static const ur_field_id_t TIME_LAST = ur_get_id_by_name("TIME_LAST");
+	static const ur_field_id_t DETECTION_TIME = ur_get_id_by_name("DETECTION_TIME");
+	static const ur_field_id_t DST_IP_COUNT = ur_get_id_by_name("DST_IP_COUNT");
+	static const ur_field_id_t DST_PORT_COUNT = ur_get_id_by_name("DST_PORT_COUNT");
+	static const ur_field_id_t FLOW_COUNT = ur_get_id_by_name("FLOW_COUNT");
+	static const ur_field_id_t SYN_COUNT = ur_get_id_by_name("SYN_COUNT");
+	static const ur_field_id_t SRC_PREFIX_LENGTH = ur_get_id_by_name("SRC_PREFIX_LENGTH");
+	static const ur_field_id_t SRC_IP_COUNT = ur_get_id_by_name("SRC_IP_COUNT");
+	static const ur_field_id_t SCAN_TYPE = ur_get_id_by_name("SCAN_TYPE");
+	static const ur_field_id_t DST_PORT_RANGE_FIRST = ur_get_id_by_name("DST_PORT_RANGE_FIRST");
+	static const ur_field_id_t DST_PORT_RANGE_LAST = ur_get_id_by_name("DST_PORT_RANGE_LAST");
+
+	m_unirecRecord.setFieldFromType(Nemea::IpAddress(report.source), SRC_IP);
+	m_unirecRecord.setFieldFromType(
+		Nemea::UrTime(ur_time_from_sec_msec(report.firstSeen, 0)),
+		TIME_FIRST);
+	m_unirecRecord.setFieldFromType(
+		Nemea::UrTime(ur_time_from_sec_msec(report.lastSeen, 0)),
+		TIME_LAST);
+	m_unirecRecord.setFieldFromType(
+		Nemea::UrTime(ur_time_from_sec_msec(report.detectTime, 0)),
+		DETECTION_TIME);
+	m_unirecRecord.setFieldFromType(static_cast<uint32_t>(report.targetCount), DST_IP_COUNT);
+	m_unirecRecord.setFieldFromType(static_cast<uint32_t>(report.portCount), DST_PORT_COUNT);
+	m_unirecRecord.setFieldFromType(report.flowCount, FLOW_COUNT);
+	m_unirecRecord.setFieldFromType(report.synCount, SYN_COUNT);
+	m_unirecRecord.setFieldFromType(report.sourcePrefixLength, SRC_PREFIX_LENGTH);
+	m_unirecRecord.setFieldFromType(static_cast<uint32_t>(report.sourceCount), SRC_IP_COUNT);
+	m_unirecRecord.setFieldFromType(static_cast<uint8_t>(report.scanType), SCAN_TYPE);
+
+	m_rangeFirsts.clear();
+	m_rangeLasts.clear();
+	for (const auto& [first, last] : report.portRanges) {
+		m_rangeFirsts.push_back(first);
+		m_rangeLasts.push_back(last);
+	}
+	m_unirecRecord.setFieldFromVector(m_rangeFirsts, DST_PORT_RANGE_FIRST);
+	m_unirecRecord.setFieldFromVector(m_rangeLasts, DST_PORT_RANGE_LAST);
+
+	m_outputInterface->send(m_unirecRecord);
+	m_sentReports++;
+}
+
+std::string ReportWriter::createMessageId()
+{
+	// random UUID version 4
+	const uint64_t high = (m_random() & 0xffffffffffff0fffULL) | 0x0000000000004000ULL;
+	const uint64_t low = (m_random() & 0x3fffffffffffffffULL) | 0x8000000000000000ULL;
+
+	char buffer[37];
+	std::snprintf(
+		buffer,
+		sizeof(buffer),
+		"%08x-%04x-%04x-%04x-%012llx",
+		static_cast<unsigned>(high >> 32),
+		static_cast<unsigned>((high >> 16) & 0xffff),
+		static_cast<unsigned>(high & 0xffff),
+		static_cast<unsigned>(low >> 48),
+		static_cast<unsigned long long>(low & 0xffffffffffffULL));
+	return buffer;
+}
+
+} // namespace ScanDetector
@@ -0,0 +1,136 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Declaration of the ReportWriter class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "logger/logger.hpp"
+#include "scannerReport.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unirec++/unirec.hpp>
+#include <vector>
+
+namespace ScanDetector {
+
+/**
+ * @brief Configuration of the report writer.
+ */
+struct ReportWriterConfig {
+	std::string spoolDirectory; ///< Spool directory of the Warden filer, disabled if empty.
+	std::string nodeName = "nemea.scan_detector"; ///< Node name reported in IDEA messages.
+	std::chrono::milliseconds flushInterval {1000}; ///< Maximal delay of a queued report.
+	size_t batchSize = 128; ///< Number of queued reports that wakes the writer early.
+	size_t maxQueuedReports = 10'000; ///< Reports above this limit are dropped.
+};
+
+/**
+ * @brief Statistics of the report writer.
+ */
+struct ReportWriterStats {
+	uint64_t writtenReports = 0; ///< Number of IDEA messages moved to the spool directory.
+	uint64_t sentReports = 0; ///< Number of UniRec records sent to the output interface.
+	uint64_t droppedReports = 0; ///< Number of reports dropped for a full queue.
+	uint64_t failedWrites = 0; ///< Number of IDEA messages that could not be written.
+	uint64_t batches = 0; ///< Number of processed batches.
+	uint64_t queuedReports = 0; ///< Number of reports waiting to be written.
+	uint64_t lockWaitNanoseconds = 0; ///< Time the detection waited for the queue lock.
+};
+
+/**
+ * @brief Writes reports of detected scanners on a background thread.
+ *
+ * Detection only appends the report to a queue. The writer thread wakes up when a batch is
+ * full or the flush interval elapses, serializes the queued reports into IDEA messages and
+ * writes each of them into the spool directory of the Warden filer. A message is written into
+ * `<spool>/tmp` first and renamed into `<spool>/incoming` when complete, so the filer never
+ * picks up a partial file. Optionally, an aggregated UniRec record is sent for every report
+ * and the output interface is flushed once per batch.
+ */
+class ReportWriter {
+public:
+	/**
+	 * @brief UniRec template of the aggregated records.
+	 */
+	static constexpr const char* UNIREC_TEMPLATE
+		= "ipaddr SRC_IP,time TIME_FIRST,time TIME_LAST,time DETECTION_TIME,uint32 DST_IP_COUNT,"
+		  "uint32 DST_PORT_COUNT,uint64 FLOW_COUNT,uint64 SYN_COUNT,uint8 SRC_PREFIX_LENGTH,"
+		  "uint32 SRC_IP_COUNT,uint8 SCAN_TYPE,uint16* DST_PORT_RANGE_FIRST,uint16* DST_PORT_RANGE_LAST";
+
+	/**
+	 * @brief Creates the spool directories and starts the writer thread.
+	 *
+	 * @param config Configuration of the writer.
+	 * @param outputInterface Interface for the aggregated UniRec records or nullptr. It has to
+	 * outlive the writer and must not be used by other threads.
+	 * @throw std::filesystem::filesystem_error If the spool directories can not be created.
+	 */
+	explicit ReportWriter(
+		const ReportWriterConfig& config,
+		Nemea::UnirecOutputInterface* outputInterface = nullptr);
+
+	/**
+	 * @brief Writes the remaining reports and stops the writer thread.
+	 */
+	~ReportWriter();
+
+	ReportWriter(const ReportWriter&) = delete;
+	ReportWriter& operator=(const ReportWriter&) = delete;
+
+	/**
+	 * @brief Queues the report for writing, never blocks on I/O.
+	 * @param report Detected scanner.
+	 */
+	void submit(const ScannerReport& report);
+
+	/**
+	 * @brief Returns the current statistics.
+	 */
+	ReportWriterStats getStats() const noexcept;
+
+private:
+	void loopThread();
+	void writeBatch(const std::vector<ScannerReport>& batch);
+	void writeIdeaMessage(const ScannerReport& report);
+	void sendUnirecRecord(const ScannerReport& report);
+	std::string createMessageId();
+
+	ReportWriterConfig m_config;
+	Nemea::UnirecOutputInterface* m_outputInterface;
+	Nemea::UnirecRecord m_unirecRecord;
+	std::vector<uint16_t> m_rangeFirsts;
+	std::vector<uint16_t> m_rangeLasts;
+
+	std::mt19937_64 m_random;
+	uint64_t m_fileSequence = 0;
+
+	std::vector<ScannerReport> m_queue;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopFlag = false;
+	std::thread m_thread;
+
+	std::atomic<uint64_t> m_writtenReports {0};
+	std::atomic<uint64_t> m_sentReports {0};
+	std::atomic<uint64_t> m_droppedReports {0};
+	std::atomic<uint64_t> m_failedWrites {0};
+	std::atomic<uint64_t> m_batches {0};
+	std::atomic<uint64_t> m_queuedReports {0};
+	std::atomic<uint64_t> m_lockWaitNanoseconds {0};
+
+	std::shared_ptr<spdlog::logger> m_logger = Nm::loggerGet("ReportWriter");
+};
+
+} // namespace ScanDetector
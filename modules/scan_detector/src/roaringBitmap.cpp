@@ -0,0 +1,179 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Implementation of the RoaringBitmap class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "roaringBitmap.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace ScanDetector {
+
+bool RoaringBitmap::add(uint64_t value)
+{
+	const uint64_t key = value >> 16;
+	const auto low = static_cast<uint16_t>(value);
+
+	Container* container = findContainer(key);
+	if (container == nullptr) {
+		auto position = std::lower_bound(
+			m_containers.begin(),
+			m_containers.end(),
+			key,
+			[](const Container& container, uint64_t key) { return container.key < key; });
+		position = m_containers.insert(position, Container());
+		position->key = key;
+		m_lastContainer = static_cast<size_t>(position - m_containers.begin());
+		container = &*position;
+	}
+
+	if (!addToContainer(*container, low)) {
+		return false;
+	}
+	m_cardinality++;
+	return true;
+}
+
+bool RoaringBitmap::contains(uint64_t value) const noexcept
+{
+	const Container* container = findContainer(value >> 16);
+	if (container == nullptr) {
+		return false;
+	}
+
+	const auto low = static_cast<uint16_t>(value);
+	if (!container->words.empty()) {
+		return ((container->words[low / 64] >> (low % 64)) & 1) != 0;
+	}
+	return std::binary_search(container->array.begin(), container->array.end(), low);
+}
+
+RoaringBitmap::Container* RoaringBitmap::findContainer(uint64_t key) noexcept
+{
+	const auto* container = static_cast<const RoaringBitmap*>(this)->findContainer(key);
+	if (container != nullptr) {
+		m_lastContainer = static_cast<size_t>(container - m_containers.data());
+	}
+	return const_cast<Container*>(container);
+}
+
+const RoaringBitmap::Container* RoaringBitmap::findContainer(uint64_t key) const noexcept
+{
+	// scans usually stay within one chunk for many values
+	if (m_lastContainer < m_containers.size() && m_containers[m_lastContainer].key == key) {
+		return &m_containers[m_lastContainer];
+	}
+
+	const auto position = std::lower_bound(
+		m_containers.begin(),
+		m_containers.end(),
+		key,
+		[](const Container& container, uint64_t key) { return container.key < key; });
+	if (position == m_containers.end() || position->key != key) {
+		return nullptr;
+	}
+	return &*position;
+}
+
+bool RoaringBitmap::addToContainer(Container& container, uint16_t low)
+{
+	if (!container.words.empty()) {
+		uint64_t& word = container.words[low / 64];
+		const uint64_t mask = uint64_t(1) << (low % 64);
+		if ((word & mask) != 0) {
+			return false;
+		}
+		word |= mask;
+		container.cardinality++;
+		return true;
+	}
+
+	auto& array = container.array;
+	// sequential values are appended without a search
+	if (array.empty() || array.back() < low) {
+		array.push_back(low);
+	} else {
+		const auto position = std::lower_bound(array.begin(), array.end(), low);
+		if (*position == low) {
+			return false;
+		}
+		array.insert(position, low);
+	}
+	container.cardinality++;
+
+	if (container.cardinality > MAX_ARRAY_SIZE) {
+		convertToBitmap(container);
+	}
+	return true;
+}
+
+void RoaringBitmap::convertToBitmap(Container& container)
+{
+	container.words.assign(BITMAP_WORDS, 0);
+	for (const uint16_t low : container.array) {
+		container.words[low / 64] |= uint64_t(1) << (low % 64);
+	}
+	std::vector<uint16_t>().swap(container.array);
+}
+
+void RoaringBitmap::serialize(SnapshotWriter& writer) const noexcept
+{
+	writer.put<uint64_t>(m_containers.size());
+	for (const auto& container : m_containers) {
+		writer.put(container.key);
+		writer.put(container.cardinality);
+		writer.put<uint8_t>(container.words.empty() ? 0 : 1);
+		if (container.words.empty()) {
+			for (const uint16_t low : container.array) {
+				writer.put(low);
+			}
+		} else {
+			for (const uint64_t word : container.words) {
+				writer.put(word);
+			}
+		}
+	}
+}
+
+void RoaringBitmap::deserialize(SnapshotReader& reader)
+{
+	m_containers.clear();
+	m_cardinality = 0;
+	m_lastContainer = 0;
+
+	const auto containers = reader.get<uint64_t>();
+	for (uint64_t i = 0; i < containers; i++) {
+		Container container;
+		container.key = reader.get<uint64_t>();
+		container.cardinality = reader.get<uint32_t>();
+		const bool isBitmap = reader.get<uint8_t>() != 0;
+
+		if ((!m_containers.empty() && m_containers.back().key >= container.key)
+			|| container.cardinality == 0 || container.cardinality > 65536
+			|| isBitmap != (container.cardinality > MAX_ARRAY_SIZE)) {
+			throw std::runtime_error("RoaringBitmap: malformed container in snapshot");
+		}
+
+		if (isBitmap) {
+			container.words.resize(BITMAP_WORDS);
+			for (auto& word : container.words) {
+				word = reader.get<uint64_t>();
+			}
+		} else {
+			container.array.resize(container.cardinality);
+			for (auto& low : container.array) {
+				low = reader.get<uint16_t>();
+			}
+		}
+
+		m_cardinality += container.cardinality;
+		m_containers.push_back(std::move(container));
+	}
+}
+
+} // namespace ScanDetector
@@ -0,0 +1,135 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Declaration of the RoaringBitmap class
+ *
+ * Compressed bitmap in the style of Chambi et al., "Better bitmap performance with Roaring
+ * bitmaps". Values are split by their high bits into chunks of 65536 values. A sparse chunk is
+ * stored as a sorted array of the low 16 bits, a dense one (more than 4096 values) as a plain
+ * bitmap, so a chunk never takes more than 8 kB and small sets take two bytes per value.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "snapshot.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ScanDetector {
+
+/**
+ * @brief Compressed set of 64-bit values.
+ *
+ * The cardinality is maintained on every insertion, so it is available in constant time.
+ * Consecutive insertions into the same chunk, as produced by sequential scans, do not search
+ * the list of chunks.
+ */
+class RoaringBitmap {
+public:
+	/**
+	 * @brief Inserts a value.
+	 * @return True if the value was not present before.
+	 */
+	bool add(uint64_t value);
+
+	/**
+	 * @brief Checks whether the value is present.
+	 */
+	bool contains(uint64_t value) const noexcept;
+
+	/**
+	 * @brief Returns the number of values in the set.
+	 */
+	uint64_t cardinality() const noexcept { return m_cardinality; }
+
+	/**
+	 * @brief Returns true if the set is empty.
+	 */
+	bool empty() const noexcept { return m_cardinality == 0; }
+
+	/**
+	 * @brief Calls `function(first, last)` for maximal runs of consecutive values in ascending
+	 * order until it returns false.
+	 */
+	template <typename Function>
+	void forEachRange(Function&& function) const
+	{
+		bool open = false;
+		uint64_t first = 0;
+		uint64_t last = 0;
+		auto accumulate = [&](uint64_t value) {
+			if (open && value == last + 1) {
+				last = value;
+				return true;
+			}
+			if (open && !function(first, last)) {
+				return false;
+			}
+			open = true;
+			first = value;
+			last = value;
+			return true;
+		};
+
+		for (const auto& container : m_containers) {
+			const uint64_t base = container.key << 16;
+			if (container.words.empty()) {
+				for (const uint16_t low : container.array) {
+					if (!accumulate(base | low)) {
+						return;
+					}
+				}
+				continue;
+			}
+			for (size_t word = 0; word < container.words.size(); word++) {
+				for (uint64_t bits = container.words[word]; bits != 0; bits &= bits - 1) {
+					const auto low = static_cast<uint64_t>(word * 64 + __builtin_ctzll(bits));
+					if (!accumulate(base | low)) {
+						return;
+					}
+				}
+			}
+		}
+
+		if (open) {
+			function(first, last);
+		}
+	}
+
+	/**
+	 * @brief Writes the set into a snapshot, does not allocate.
+	 */
+	void serialize(SnapshotWriter& writer) const noexcept;
+
+	/**
+	 * @brief Replaces the set with one read from a snapshot.
+	 * @throw std::runtime_error If the snapshot is malformed.
+	 */
+	void deserialize(SnapshotReader& reader);
+
+private:
+	static constexpr uint32_t MAX_ARRAY_SIZE = 4096;
+	static constexpr size_t BITMAP_WORDS = 65536 / 64;
+
+	struct Container {
+		uint64_t key = 0;
+		uint32_t cardinality = 0;
+		std::vector<uint16_t> array; ///< Sorted low bits of a sparse chunk.
+		std::vector<uint64_t> words; ///< Bitmap of a dense chunk, empty for a sparse one.
+	};
+
+	Container* findContainer(uint64_t key) noexcept;
+	const Container* findContainer(uint64_t key) const noexcept;
+	static bool addToContainer(Container& container, uint16_t low);
+	static void convertToBitmap(Container& container);
+
+	std::vector<Container> m_containers; ///< Chunks in ascending order of keys.
+	uint64_t m_cardinality = 0;
+	size_t m_lastContainer = 0;
+};
+
+} // namespace ScanDetector
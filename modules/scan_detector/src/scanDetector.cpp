@@ -0,0 +1,556 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Implementation of the ScanDetector class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "scanDetector.hpp"
+#include "ipPrefix.hpp"
+#include "threadCounter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace {
+
+constexpr uint8_t TCP_FLAGS_SYN_ONLY = 0x02;
+constexpr size_t MAX_REPORTED_TARGETS = 256;
+constexpr size_t MAX_REPORTED_PORTS = 256;
+constexpr size_t MAX_REPORTED_PORT_RANGES = 64;
+
+} // namespace
+
+namespace ScanDetector {
+
+ScanDetector::ScanDetector(const ScanDetectorConfig& config, uint64_t now)
+	: m_config(config)
+	, m_trw(config.trw)
+	, m_now(now)
+	, m_ipMap(config.maxSources)
+	, m_susIpMap(config.maxSuspects)
+	, m_evidence(config.evidencePoolSize, config.evidenceHead, config.evidenceTail)
+	, m_subnets(config, m_trw, now)
+	, m_sourceTimers(now)
+	, m_suspectTimers(now)
+{
+}
+
+void ScanDetector::addRecord(const FlowRecord& flow, FlowSide sides)
+{
+	if (hasSide(sides, FlowSide::Destination)) {
+		addDestinationSide(flow);
+	}
+	if (hasSide(sides, FlowSide::DestinationSubnet)) {
+		m_subnets.addDestination(flow);
+	}
+	if (hasSide(sides, FlowSide::SourceSubnet)) {
+		m_subnets.addSource(flow);
+	}
+	if (hasSide(sides, FlowSide::Source)) {
+		addSourceSide(flow);
+	}
+
+	processDirtyQueue();
+}
+
+void ScanDetector::addSourceSide(const FlowRecord& flow)
+{
+	SusIpData* suspect = m_susIpMap.incrementExisting(flow.src);
+	if (suspect != nullptr) {
+		suspect->lastSeen = m_now;
+		if (flow.tcpFlags == TCP_FLAGS_SYN_ONLY) {
+			suspect->syn++;
+		}
+		suspect->ports.add(flow.dstPort);
+		accountTarget(*suspect, flow);
+		//retain the record from suspicious ip
+		m_evidence.add(suspect->outRecords, flow);
+
+		if (spreadOf(*suspect) >= suspect->nextEvaluation) {
+			markDirty(flow.src, *suspect);
+		}
+		return;
+	}
+
+	TrafficData& source = touchSource(flow.src);
+	source.src++;
+	if (flow.tcpFlags == TCP_FLAGS_SYN_ONLY) {
+		source.syn++;
+	}
+
+	//sequential test on every first-contact connection, the source is moved
+	//to suspicious category as soon as the walk crosses the upper bound
+	if (m_trw.update(source.trw, flow.dst, flow.tcpFlags) == TrwDecision::Scanner) {
+		promoteToSuspect(flow.src);
+	}
+}
+
+void ScanDetector::addDestinationSide(const FlowRecord& flow)
+{
+	SusIpData* suspect = m_susIpMap.incrementExisting(flow.dst);
+	if (suspect != nullptr) {
+		suspect->lastSeen = m_now;
+		m_evidence.add(suspect->inRecords, flow);
+		return;
+	}
+
+	touchSource(flow.dst).dst++;
+}
+
+void ScanDetector::removeRecord(const FlowRecord& flow, FlowSide sides)
+{
+	if (hasSide(sides, FlowSide::Source)) {
+		TrafficData* source = m_ipMap.find(flow.src);
+		if (source != nullptr) {
+			if (source->src > 0) {
+				source->src--;
+			}
+			if (flow.tcpFlags == TCP_FLAGS_SYN_ONLY && source->syn > 0) {
+				source->syn--;
+			}
+		}
+	}
+
+	if (hasSide(sides, FlowSide::Destination)) {
+		TrafficData* destination = m_ipMap.find(flow.dst);
+		if (destination != nullptr && destination->dst > 0) {
+			destination->dst--;
+		}
+	}
+}
+
+void ScanDetector::advanceTime(uint64_t now)
+{
+	if (now <= m_now) {
+		return;
+	}
+	m_now = now;
+
+	const auto start = std::chrono::steady_clock::now();
+	m_sourceTimers.advance(m_now, [this](const ip_addr_t& address, uint64_t timer) {
+		expireSource(address, timer);
+	});
+	m_suspectTimers.advance(m_now, [this](const ip_addr_t& address, uint64_t timer) {
+		expireSuspect(address, timer);
+	});
+	m_subnets.advanceTime(m_now);
+
+	const uint64_t duration = nanosecondsSince(start);
+	m_stats.timerSweeps++;
+	m_stats.timerSweepNanoseconds += duration;
+	m_stats.maxTimerSweepNanoseconds = std::max(m_stats.maxTimerSweepNanoseconds, duration);
+}
+
+void ScanDetector::setReportCallback(ReportCallback callback)
+{
+	m_subnets.setReportCallback(callback);
+	m_reportCallback = std::move(callback);
+}
+
+ScanDetectorStats ScanDetector::getStats() const noexcept
+{
+	ScanDetectorStats stats = m_stats;
+	stats.sources = m_ipMap.size();
+	stats.suspects = m_susIpMap.size();
+	stats.evictedSources = m_ipMap.evictions();
+	stats.evictedSourceRecords = m_ipMap.evictedCount();
+	stats.evictedSuspects = m_susIpMap.evictions();
+	stats.evidenceRecords = m_evidence.usedSlots();
+	stats.droppedEvidence = m_evidence.droppedRecords();
+	m_subnets.fillStats(stats);
+	return stats;
+}
+
+void ScanDetector::serialize(SnapshotWriter& writer) const noexcept
+{
+	writer.put(m_stats);
+
+	writer.put<uint64_t>(m_ipMap.size());
+	m_ipMap.forEach([&](const ip_addr_t& address,
+						const TrafficData& source,
+						uint64_t count,
+						uint64_t error) {
+		writer.put(address);
+		writer.put(count);
+		writer.put(error);
+		writer.put(source.src);
+		writer.put(source.dst);
+		writer.put(source.syn);
+		writer.put(source.lastSeen);
+		writer.put(source.expiresAt);
+		writer.put(source.trw.contactedTargets);
+		writer.put(source.trw.logLikelihoodRatio);
+		writer.put(source.trw.observations);
+	});
+
+	writer.put<uint64_t>(m_susIpMap.size());
+	m_susIpMap.forEach([&](const ip_addr_t& address,
+						   const SusIpData& suspect,
+						   uint64_t count,
+						   uint64_t error) {
+		writer.put(address);
+		writer.put(count);
+		writer.put(error);
+		writer.put(suspect.syn);
+		writer.put(suspect.firstSeen);
+		writer.put(suspect.lastSeen);
+		writer.put(suspect.expiresAt);
+		writer.put<uint64_t>(suspect.nextEvaluation);
+		writer.put<uint8_t>(suspect.reported ? 1 : 0);
+		serializeEvidence(writer, suspect.inRecords);
+		serializeEvidence(writer, suspect.outRecords);
+
+		writer.put<uint64_t>(suspect.dstIpMap.size());
+		for (const auto& [target, offset] : suspect.dstIpMap) {
+			writer.put(target);
+			writer.put(offset);
+		}
+		suspect.ports.serialize(writer);
+		suspect.targetPorts.serialize(writer);
+		suspect.repeatedTargets.serialize(writer);
+		writer.put(suspect.untrackedTargets);
+		writer.put(suspect.untrackedPairs);
+	});
+
+	m_subnets.serialize(writer);
+}
+
+void ScanDetector::serializeEvidence(SnapshotWriter& writer, const Evidence& evidence) const noexcept
+{
+	writer.put(evidence.total);
+	writer.put<uint32_t>(evidence.headCount + evidence.tailCount);
+	m_evidence.forEach(evidence, [&writer](const FlowRecord& flowRecord) {
+		writeFlowRecord(writer, flowRecord);
+	});
+}
+
+void ScanDetector::deserialize(SnapshotReader& reader)
+{
+	m_stats = reader.get<ScanDetectorStats>();
+
+	// entries come in ascending order of counts, the lightest ones are skipped if the table
+	// is smaller than the snapshot
+	const auto sources = reader.get<uint64_t>();
+	const uint64_t skippedSources = sources > m_ipMap.capacity() ? sources - m_ipMap.capacity() : 0;
+	for (uint64_t i = 0; i < sources; i++) {
+		const auto address = reader.get<ip_addr_t>();
+		const auto count = reader.get<uint64_t>();
+		const auto error = reader.get<uint64_t>();
+
+		TrafficData source;
+		source.src = reader.get<uint64_t>();
+		source.dst = reader.get<uint64_t>();
+		source.syn = reader.get<uint64_t>();
+		source.lastSeen = reader.get<uint64_t>();
+		source.expiresAt = std::max(reader.get<uint64_t>(), m_now + 1);
+		source.trw.contactedTargets = reader.get<decltype(source.trw.contactedTargets)>();
+		source.trw.logLikelihoodRatio = reader.get<decltype(source.trw.logLikelihoodRatio)>();
+		source.trw.observations = reader.get<decltype(source.trw.observations)>();
+
+		if (i < skippedSources) {
+			continue;
+		}
+		TrafficData& appended = m_ipMap.append(address, count, error);
+		appended = source;
+		scheduleSource(address, appended);
+	}
+
+	const auto suspects = reader.get<uint64_t>();
+	const uint64_t skippedSuspects
+		= suspects > m_susIpMap.capacity() ? suspects - m_susIpMap.capacity() : 0;
+	for (uint64_t i = 0; i < suspects; i++) {
+		const auto address = reader.get<ip_addr_t>();
+		const auto count = reader.get<uint64_t>();
+		const auto error = reader.get<uint64_t>();
+
+		SusIpData skipped;
+		SusIpData& suspect = i < skippedSuspects ? skipped : m_susIpMap.append(address, count, error);
+		suspect.syn = reader.get<uint64_t>();
+		suspect.firstSeen = reader.get<uint64_t>();
+		suspect.lastSeen = reader.get<uint64_t>();
+		suspect.expiresAt = std::max(reader.get<uint64_t>(), m_now + 1);
+		suspect.nextEvaluation = reader.get<uint64_t>();
+		suspect.reported = reader.get<uint8_t>() != 0;
+		deserializeEvidence(reader, suspect.inRecords);
+		deserializeEvidence(reader, suspect.outRecords);
+
+		const auto targets = reader.get<uint64_t>();
+		suspect.dstIpMap.reserve(targets);
+		for (uint64_t target = 0; target < targets; target++) {
+			const auto targetAddress = reader.get<ip_addr_t>();
+			suspect.dstIpMap[targetAddress] = reader.get<uint32_t>();
+		}
+		suspect.ports.deserialize(reader);
+		suspect.targetPorts.deserialize(reader);
+		suspect.repeatedTargets.deserialize(reader);
+		suspect.untrackedTargets = reader.get<uint64_t>();
+		suspect.untrackedPairs = reader.get<uint64_t>();
+
+		if (i < skippedSuspects) {
+			m_evidence.release(skipped.inRecords);
+			m_evidence.release(skipped.outRecords);
+			continue;
+		}
+		scheduleSuspect(address, suspect);
+	}
+
+	m_subnets.deserialize(reader);
+}
+
+void ScanDetector::deserializeEvidence(SnapshotReader& reader, Evidence& evidence)
+{
+	const auto total = reader.get<uint64_t>();
+	const auto retained = reader.get<uint32_t>();
+	for (uint32_t i = 0; i < retained; i++) {
+		m_evidence.add(evidence, readFlowRecord(reader));
+	}
+	evidence.total = total;
+}
+
+ScanDetector::TrafficData& ScanDetector::touchSource(const ip_addr_t& address)
+{
+	auto [entry, inserted] = m_ipMap.increment(address);
+	TrafficData& source = *entry;
+	source.lastSeen = m_now;
+	if (inserted) {
+		source.expiresAt = m_now + m_config.inactiveTimeout;
+		scheduleSource(address, source);
+	}
+	return source;
+}
+
+void ScanDetector::promoteToSuspect(const ip_addr_t& address)
+{
+	m_ipMap.erase(address);
+
+	auto onEvict = [this](const ip_addr_t& evicted, SusIpData& suspect, uint64_t, uint64_t) {
+		finalizeSuspect(evicted, suspect);
+		m_evidence.release(suspect.inRecords);
+		m_evidence.release(suspect.outRecords);
+	};
+
+	SusIpData& suspect = *m_susIpMap.increment(address, onEvict).first;
+	suspect.firstSeen = m_now;
+	suspect.lastSeen = m_now;
+	suspect.expiresAt = m_now + m_config.inactiveTimeout;
+	suspect.nextEvaluation = m_config.minSize;
+	scheduleSuspect(address, suspect);
+}
+
+void ScanDetector::accountTarget(SusIpData& suspect, const FlowRecord& flow)
+{
+	const size_t limit = m_config.maxSuspectTargets;
+
+	//targets get dense offsets, so the pairs of ports and targets form compact bitmaps
+	auto target = suspect.dstIpMap.find(flow.dst);
+	if (target == suspect.dstIpMap.end()) {
+		if (suspect.dstIpMap.size() >= limit) {
+			suspect.untrackedTargets++;
+			suspect.untrackedPairs++;
+			return;
+		}
+		const auto offset = static_cast<uint32_t>(suspect.dstIpMap.size());
+		target = suspect.dstIpMap.emplace(flow.dst, offset).first;
+	}
+
+	const uint64_t targetOffset = target->second;
+	//ports of a target share a chunk, so a vertical scan in random port order fills one chunk
+	//and a horizontal scan appends chunks in the order of the offsets
+	const uint64_t pair = (targetOffset << 16) | flow.dstPort;
+	if (suspect.targetPorts.cardinality() >= limit && !suspect.targetPorts.contains(pair)) {
+		suspect.untrackedPairs++;
+		return;
+	}
+	if (!suspect.targetPorts.add(pair)) {
+		suspect.repeatedTargets.add(targetOffset);
+	}
+}
+
+void ScanDetector::markDirty(const ip_addr_t& address, SusIpData& suspect)
+{
+	if (suspect.queued) {
+		return;
+	}
+	suspect.queued = true;
+	m_dirtyQueue.push_back(address);
+}
+
+void ScanDetector::processDirtyQueue()
+{
+	for (const auto& address : m_dirtyQueue) {
+		SusIpData* entry = m_susIpMap.find(address);
+		if (entry == nullptr) {
+			continue;
+		}
+
+		SusIpData& suspect = *entry;
+		suspect.queued = false;
+		m_stats.evaluatedSuspects++;
+
+		switch (evaluateSuspect(suspect)) {
+		case Verdict::Scanner:
+			if (!suspect.reported) {
+				reportScanner(address, suspect);
+			}
+			// re-evaluate once the number of targets or ports doubles
+			suspect.nextEvaluation = 2 * spreadOf(suspect);
+			break;
+		case Verdict::Benign:
+			eraseSuspect(address, suspect);
+			break;
+		case Verdict::Undecided:
+			break;
+		}
+	}
+
+	m_dirtyQueue.clear();
+}
+
+uint64_t ScanDetector::targetsOf(const SusIpData& suspect) noexcept
+{
+	return suspect.dstIpMap.size() + suspect.untrackedTargets;
+}
+
+size_t ScanDetector::spreadOf(const SusIpData& suspect) const noexcept
+{
+	// vertical scans spread over ports instead of targets
+	return std::max<size_t>(targetsOf(suspect), suspect.ports.cardinality());
+}
+
+ScanDetector::Verdict ScanDetector::evaluateSuspect(const SusIpData& suspect) const
+{
+	if (spreadOf(suspect) < m_config.minSize) {
+		return Verdict::Undecided;
+	}
+
+	const auto outRecords = static_cast<double>(suspect.outRecords.total);
+	const auto inRecords = static_cast<double>(suspect.inRecords.total);
+
+	//if the ratio of outgoing and incoming classifies it as a no scanner
+	if (inRecords > 0 && outRecords / inRecords < m_config.srcDstRatio) {
+		return Verdict::Benign;
+	}
+
+	//if the ratio between outgoing and number of syn flags do not exceed treshold
+	if (suspect.syn > 0 && outRecords / static_cast<double>(suspect.syn) < m_config.synSrcRatio) {
+		return Verdict::Benign;
+	}
+
+	//targets never probed twice on the same port, out of the tracked ones
+	const auto targets = static_cast<double>(suspect.dstIpMap.size());
+	const double singlePortRatio
+		= (targets - static_cast<double>(suspect.repeatedTargets.cardinality())) / targets;
+	return singlePortRatio > m_config.susNorRatio ? Verdict::Scanner : Verdict::Benign;
+}
+
+void ScanDetector::reportScanner(const ip_addr_t& address, SusIpData& suspect)
+{
+	suspect.reported = true;
+	m_stats.detectedScanners++;
+
+	if (!m_reportCallback) {
+		return;
+	}
+
+	ScannerReport report;
+	report.source = address;
+	report.sourcePrefixLength = addressLength(address);
+	report.firstSeen = suspect.firstSeen;
+	report.lastSeen = suspect.lastSeen;
+	report.detectTime = m_now;
+	report.targetCount = targetsOf(suspect);
+	report.flowCount = suspect.outRecords.total;
+	report.synCount = suspect.syn;
+
+	report.portCount = suspect.ports.cardinality();
+	report.scanType = classifyScan(
+		static_cast<double>(report.targetCount),
+		static_cast<double>(report.portCount),
+		static_cast<double>(suspect.targetPorts.cardinality() + suspect.untrackedPairs));
+
+	for (const auto& [target, offset] : suspect.dstIpMap) {
+		if (report.targets.size() >= MAX_REPORTED_TARGETS) {
+			break;
+		}
+		report.targets.push_back(target);
+	}
+
+	suspect.ports.forEachRange([&report](uint64_t first, uint64_t last) {
+		for (uint64_t port = first; port <= last && report.ports.size() < MAX_REPORTED_PORTS; port++) {
+			report.ports.push_back(static_cast<uint16_t>(port));
+		}
+		report.portRanges.emplace_back(first, last);
+		return report.portRanges.size() < MAX_REPORTED_PORT_RANGES;
+	});
+
+	m_reportCallback(report);
+}
+
+void ScanDetector::scheduleSource(const ip_addr_t& address, TrafficData& source)
+{
+	// timers of evicted entries are removed once they outnumber the table
+	source.timer = scheduleEntryTimer(m_sourceTimers, m_ipMap, address, source.expiresAt);
+}
+
+void ScanDetector::scheduleSuspect(const ip_addr_t& address, SusIpData& suspect)
+{
+	suspect.timer = scheduleEntryTimer(m_suspectTimers, m_susIpMap, address, suspect.expiresAt);
+}
+
+void ScanDetector::expireSource(const ip_addr_t& address, uint64_t timer)
+{
+	TrafficData* entry = m_ipMap.find(address);
+	if (entry == nullptr || entry->timer != timer) {
+		// entry was removed or re-created since the timer was scheduled
+		return;
+	}
+
+	TrafficData& source = *entry;
+	if (source.lastSeen + m_config.inactiveTimeout > m_now) {
+		source.expiresAt = source.lastSeen + m_config.inactiveTimeout;
+		scheduleSource(address, source);
+		return;
+	}
+
+	m_ipMap.erase(address);
+	m_stats.expiredSources++;
+}
+
+void ScanDetector::expireSuspect(const ip_addr_t& address, uint64_t timer)
+{
+	SusIpData* entry = m_susIpMap.find(address);
+	if (entry == nullptr || entry->timer != timer) {
+		return;
+	}
+
+	SusIpData& suspect = *entry;
+	if (suspect.lastSeen + m_config.inactiveTimeout > m_now) {
+		suspect.expiresAt = suspect.lastSeen + m_config.inactiveTimeout;
+		scheduleSuspect(address, suspect);
+		return;
+	}
+
+	finalizeSuspect(address, suspect);
+	eraseSuspect(address, suspect);
+	m_stats.expiredSuspects++;
+}
+
+void ScanDetector::eraseSuspect(const ip_addr_t& address, SusIpData& suspect)
+{
+	m_evidence.release(suspect.inRecords);
+	m_evidence.release(suspect.outRecords);
+	m_susIpMap.erase(address);
+}
+
+void ScanDetector::finalizeSuspect(const ip_addr_t& address, SusIpData& suspect)
+{
+	// final evaluation of a suspect that did not reach the next evaluation point
+	if (!suspect.reported && evaluateSuspect(suspect) == Verdict::Scanner) {
+		reportScanner(address, suspect);
+	}
+}
+
+} // namespace ScanDetector
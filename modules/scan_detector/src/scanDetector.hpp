@@ -0,0 +1,244 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Declaration of the ScanDetector class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "evidenceStore.hpp"
+#include "flowRecord.hpp"
+#include "ipAddressHash.hpp"
+#include "roaringBitmap.hpp"
+#include "scannerReport.hpp"
+#include "snapshot.hpp"
+#include "streamSummary.hpp"
+#include "subnetAggregator.hpp"
+#include "thresholdRandomWalk.hpp"
+#include "timerWheel.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <unirec++/unirec.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace ScanDetector {
+
+/**
+ * @brief Configuration of the scan detector.
+ */
+struct ScanDetectorConfig {
+	size_t minSize = 30; ///< Minimal number of targets before a suspect is evaluated.
+	double susNorRatio = 0.9; ///< Ratio of single-port targets needed to confirm a scanner.
+	double srcDstRatio = 0.5; ///< Minimal ratio of outgoing and incoming records of a scanner.
+	double synSrcRatio = 0.5; ///< Minimal ratio of outgoing records and SYN flows of a scanner.
+	uint64_t inactiveTimeout = 60; ///< Seconds of inactivity after which an entry expires.
+	size_t maxSources = 1'000'000; ///< Maximal number of tracked IP addresses.
+	size_t maxSuspects = 10'000; ///< Maximal number of tracked suspects.
+	size_t maxSuspectTargets = 65'536; ///< Maximal number of targets and pairs kept per suspect.
+	size_t evidencePoolSize = 1'000'000; ///< Maximal number of records retained as evidence.
+	size_t evidenceHead = 16; ///< Number of first records retained per suspect.
+	size_t evidenceTail = 64; ///< Number of last records retained per suspect.
+	uint8_t subnetPrefix4 = 24; ///< Prefix length of aggregated IPv4 sources.
+	uint8_t subnetPrefix6 = 64; ///< Prefix length of aggregated IPv6 sources.
+	size_t maxSubnets = 100'000; ///< Maximal number of tracked subnets, 0 disables aggregation.
+	size_t maxSuspectSubnets = 1'000; ///< Maximal number of tracked suspicious subnets.
+	size_t subnetMinSources = 3; ///< Minimal number of sources of a distributed scan.
+	TrwConfig trw; ///< Parameters of the threshold random walk.
+};
+
+/**
+ * @brief Statistics of the scan detector.
+ */
+struct ScanDetectorStats {
+	uint64_t sources = 0; ///< Number of tracked IP addresses.
+	uint64_t suspects = 0; ///< Number of tracked suspicious IP addresses.
+	uint64_t detectedScanners = 0; ///< Number of confirmed scanners.
+	uint64_t expiredSources = 0; ///< Number of IP addresses expired for inactivity.
+	uint64_t expiredSuspects = 0; ///< Number of suspects expired for inactivity.
+	uint64_t evaluatedSuspects = 0; ///< Number of suspect evaluations.
+	uint64_t evictedSources = 0; ///< Number of IP addresses evicted from the full table.
+	uint64_t evictedSourceRecords = 0; ///< Number of records accounted to evicted IP addresses.
+	uint64_t evictedSuspects = 0; ///< Number of suspects evicted from the full table.
+	uint64_t evidenceRecords = 0; ///< Number of records retained as evidence.
+	uint64_t droppedEvidence = 0; ///< Number of records not retained for an exhausted pool.
+	uint64_t subnets = 0; ///< Number of tracked subnets.
+	uint64_t suspectSubnets = 0; ///< Number of tracked suspicious subnets.
+	uint64_t detectedSubnets = 0; ///< Number of confirmed distributed scans.
+	uint64_t expiredSubnets = 0; ///< Number of subnets expired for inactivity.
+	uint64_t evictedSubnets = 0; ///< Number of subnets evicted from the full table.
+	uint64_t timerSweeps = 0; ///< Number of advances of time, each expiring due entries.
+	uint64_t timerSweepNanoseconds = 0; ///< Total duration of the advances of time.
+	uint64_t maxTimerSweepNanoseconds = 0; ///< Longest advance of time.
+};
+
+/**
+ * @brief Detects scanning IP addresses from flow records.
+ *
+ * Every record updates statistics of its source and destination. The two sides are accounted
+ * independently, so a record can be split between detectors that own disjoint sets of IP
+ * addresses (see PartitionedDetector). Sources are promoted to
+ * suspects by the threshold random walk. Suspects whose number of targets crossed the next
+ * evaluation point are put into a dirty queue and evaluated right after the record that caused
+ * it, so the cost of the evaluation scales with activity instead of table size. Inactive
+ * entries are expired by a hierarchical timer wheel.
+ *
+ * Both tables have a fixed capacity. When a table is full, the entry with the fewest records is
+ * evicted (Space-Saving), so heavy sources stay tracked exactly even during spoofed floods.
+ * Records of suspects are retained in a bounded evidence store. A suspect keeps at most
+ * maxSuspectTargets targets and as many pairs of a target and a port, further ones are only
+ * counted, so a single sweep of a large network does not grow one suspect without limit.
+ *
+ * Sources are additionally aggregated by subnet (see SubnetAggregator), so scans distributed
+ * over many addresses of one network are detected as well.
+ *
+ * The class is not thread-safe.
+ */
+class ScanDetector {
+public:
+	/**
+	 * @brief Callback invoked for every detected scanner.
+	 */
+	using ReportCallback = ::ScanDetector::ReportCallback;
+
+	/**
+	 * @brief Constructs the detector.
+	 * @param config Configuration of the detector.
+	 * @param now Current time in seconds.
+	 */
+	explicit ScanDetector(const ScanDetectorConfig& config, uint64_t now = 0);
+
+	/**
+	 * @brief Updates statistics of the given sides with a record that entered the window.
+	 * @param flow Fields of the received record.
+	 * @param sides Sides of the record accounted by this detector.
+	 */
+	void addRecord(const FlowRecord& flow, FlowSide sides = FlowSide::Both);
+
+	/**
+	 * @brief Updates statistics of the given sides with a record that left the window.
+	 * @param flow Fields of the evicted record.
+	 * @param sides Sides of the record accounted by this detector.
+	 */
+	void removeRecord(const FlowRecord& flow, FlowSide sides = FlowSide::Both);
+
+	/**
+	 * @brief Advances time and expires inactive entries.
+	 * @param now Current time in seconds.
+	 */
+	void advanceTime(uint64_t now);
+
+	/**
+	 * @brief Sets the callback invoked for every detected scanner.
+	 *
+	 * The callback is called synchronously from the detection, so it should only hand the
+	 * report over, e.g. to a ReportWriter.
+	 */
+	void setReportCallback(ReportCallback callback);
+
+	/**
+	 * @brief Returns the current statistics.
+	 */
+	ScanDetectorStats getStats() const noexcept;
+
+	/**
+	 * @brief Writes the tables and statistics into a snapshot.
+	 *
+	 * The method does not allocate, so it can be called in a forked child.
+	 */
+	void serialize(SnapshotWriter& writer) const noexcept;
+
+	/**
+	 * @brief Restores the tables and statistics from a snapshot.
+	 *
+	 * Must be called on a detector without any records. If the tables are smaller than in the
+	 * snapshot, the entries with the fewest records are skipped. Timers are rescheduled
+	 * relative to the current time of the detector.
+	 *
+	 * @throw std::runtime_error If the snapshot is malformed.
+	 */
+	void deserialize(SnapshotReader& reader);
+
+private:
+	struct TrafficData {
+		uint64_t src = 0;
+		uint64_t dst = 0;
+		uint64_t syn = 0;
+		uint64_t lastSeen = 0;
+		uint64_t expiresAt = 0;
+		uint64_t timer = 0; ///< Id of the current expiration timer.
+		TrwState trw;
+	};
+
+	struct SusIpData {
+		Evidence inRecords;
+		Evidence outRecords;
+		/// Targets with their offsets in the order of the first contact.
+		std::unordered_map<ip_addr_t, uint32_t, IPAddressHash, IPAddressEqual> dstIpMap;
+		RoaringBitmap ports; ///< Distinct destination ports.
+		RoaringBitmap targetPorts; ///< Distinct pairs of a target offset and a port.
+		RoaringBitmap repeatedTargets; ///< Offsets of targets probed twice on the same port.
+		/// Flows to targets beyond the limit, each counted as a new target.
+		uint64_t untrackedTargets = 0;
+		/// Flows to pairs beyond the limit, each counted as a new pair.
+		uint64_t untrackedPairs = 0;
+		uint64_t syn = 0;
+		uint64_t firstSeen = 0;
+		uint64_t lastSeen = 0;
+		uint64_t expiresAt = 0;
+		uint64_t timer = 0; ///< Id of the current expiration timer.
+		size_t nextEvaluation = 0;
+		bool queued = false;
+		bool reported = false;
+	};
+
+	enum class Verdict {
+		Undecided,
+		Scanner,
+		Benign,
+	};
+
+	void addSourceSide(const FlowRecord& flow);
+	void addDestinationSide(const FlowRecord& flow);
+
+	TrafficData& touchSource(const ip_addr_t& address);
+	void promoteToSuspect(const ip_addr_t& address);
+	void accountTarget(SusIpData& suspect, const FlowRecord& flow);
+	void markDirty(const ip_addr_t& address, SusIpData& suspect);
+	void processDirtyQueue();
+	static uint64_t targetsOf(const SusIpData& suspect) noexcept;
+	size_t spreadOf(const SusIpData& suspect) const noexcept;
+	Verdict evaluateSuspect(const SusIpData& suspect) const;
+	void reportScanner(const ip_addr_t& address, SusIpData& suspect);
+	void finalizeSuspect(const ip_addr_t& address, SusIpData& suspect);
+	void eraseSuspect(const ip_addr_t& address, SusIpData& suspect);
+
+	void scheduleSource(const ip_addr_t& address, TrafficData& source);
+	void scheduleSuspect(const ip_addr_t& address, SusIpData& suspect);
+	void expireSource(const ip_addr_t& address, uint64_t timer);
+	void expireSuspect(const ip_addr_t& address, uint64_t timer);
+
+	void serializeEvidence(SnapshotWriter& writer, const Evidence& evidence) const noexcept;
+	void deserializeEvidence(SnapshotReader& reader, Evidence& evidence);
+
+	ScanDetectorConfig m_config;
+	ThresholdRandomWalk m_trw;
+	uint64_t m_now;
+
+	StreamSummary<ip_addr_t, TrafficData, IPAddressHash, IPAddressEqual> m_ipMap;
+	StreamSummary<ip_addr_t, SusIpData, IPAddressHash, IPAddressEqual> m_susIpMap;
+	EvidenceStore m_evidence;
+	SubnetAggregator m_subnets;
+
+	std::vector<ip_addr_t> m_dirtyQueue;
+	TimerWheel<ip_addr_t> m_sourceTimers;
+	TimerWheel<ip_addr_t> m_suspectTimers;
+
+	ReportCallback m_reportCallback;
+	ScanDetectorStats m_stats;
+};
+
+} // namespace ScanDetector
@@ -0,0 +1,101 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Description of a detected scanner
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unirec++/unirec.hpp>
+#include <utility>
+#include <vector>
+
+namespace ScanDetector {
+
+/**
+ * @brief Shape of a scan in the space of targets and ports.
+ */
+enum class ScanType : uint8_t {
+	Unknown = 0,
+	Horizontal = 1, ///< Few ports on many targets.
+	Vertical = 2, ///< Many ports on few targets.
+	Block = 3, ///< Many ports on many targets.
+};
+
+/**
+ * @brief Classifies a scan by its fan-out.
+ *
+ * The fan-out of a target is the number of distinct ports probed on it and the fan-out of a port
+ * is the number of distinct targets it was probed on. A scan whose average fan-out is small in
+ * both dimensions is classified by the larger one.
+ *
+ * @param targets Number of distinct targets.
+ * @param ports Number of distinct ports.
+ * @param pairs Number of distinct target and port pairs.
+ */
+inline ScanType classifyScan(double targets, double ports, double pairs) noexcept
+{
+	constexpr double MIN_BLOCK_FANOUT = 4;
+
+	if (targets <= 0 || ports <= 0) {
+		return ScanType::Unknown;
+	}
+
+	const bool wideTargets = pairs / ports >= MIN_BLOCK_FANOUT;
+	const bool widePorts = pairs / targets >= MIN_BLOCK_FANOUT;
+	if (wideTargets && widePorts) {
+		return ScanType::Block;
+	}
+	if (wideTargets != widePorts) {
+		return wideTargets ? ScanType::Horizontal : ScanType::Vertical;
+	}
+	return targets >= ports ? ScanType::Horizontal : ScanType::Vertical;
+}
+
+/**
+ * @brief Returns the name of the scan type.
+ */
+inline const char* scanTypeName(ScanType type) noexcept
+{
+	switch (type) {
+	case ScanType::Horizontal:
+		return "horizontal";
+	case ScanType::Vertical:
+		return "vertical";
+	case ScanType::Block:
+		return "block";
+	default:
+		return "unknown";
+	}
+}
+
+/**
+ * @brief Detected scanner passed from the detector to the report writer.
+ */
+struct ScannerReport {
+	ip_addr_t source; ///< Scanning IP address or network address of the scanning subnet.
+	uint8_t sourcePrefixLength = 0; ///< Prefix length of the source, 32 or 128 for a single address.
+	uint64_t sourceCount = 1; ///< Number of distinct scanning IP addresses.
+	uint64_t firstSeen = 0; ///< Time of the first record of the suspect (seconds since epoch).
+	uint64_t lastSeen = 0; ///< Time of the last record of the suspect (seconds since epoch).
+	uint64_t detectTime = 0; ///< Time of the detection (seconds since epoch).
+	uint64_t targetCount = 0; ///< Number of distinct scanned targets.
+	uint64_t portCount = 0; ///< Number of distinct scanned ports.
+	uint64_t flowCount = 0; ///< Number of flows from the scanner.
+	uint64_t synCount = 0; ///< Number of SYN-only flows from the scanner.
+	std::vector<ip_addr_t> targets; ///< Sample of scanned targets.
+	std::vector<uint16_t> ports; ///< Sample of scanned ports in ascending order.
+	std::vector<std::pair<uint16_t, uint16_t>> portRanges; ///< Covered port ranges, inclusive.
+	ScanType scanType = ScanType::Unknown; ///< Shape of the scan.
+};
+
+/**
+ * @brief Callback invoked for every detected scanner.
+ */
+using ReportCallback = std::function<void(const ScannerReport&)>;
+
+} // namespace ScanDetector
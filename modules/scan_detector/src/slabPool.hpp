@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Pool of fixed-size slots allocated in slabs
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace ScanDetector {
+
+/**
+ * @brief Pool of at most `capacity` slots of type T addressed by 32-bit indices.
+ *
+ * Slots are allocated from slabs of 4096 slots. Slabs are allocated on demand and are never
+ * released, so once the pool is warm the allocation and release of a slot do not touch the heap.
+ *
+ * @tparam T Type of the slot, must be default constructible.
+ */
+template <typename T>
+class SlabPool {
+public:
+	/**
+	 * @brief Index returned when the pool is exhausted.
+	 */
+	static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+	/**
+	 * @brief Constructs an empty pool.
+	 * @param capacity Maximal number of slots.
+	 */
+	explicit SlabPool(std::size_t capacity)
+		: m_capacity(capacity)
+	{
+		if (capacity >= NONE) {
+			throw std::invalid_argument("SlabPool: invalid capacity");
+		}
+		m_freeSlots.reserve(capacity);
+	}
+
+	/**
+	 * @brief Allocates a slot.
+	 * @return Index of the slot or NONE if the pool is exhausted.
+	 */
+	uint32_t allocate()
+	{
+		if (!m_freeSlots.empty()) {
+			const uint32_t slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+			return slot;
+		}
+
+		if (m_allocatedSlots == m_capacity) {
+			return NONE;
+		}
+
+		if ((m_allocatedSlots >> SLAB_BITS) == m_slabs.size()) {
+			m_slabs.emplace_back(std::make_unique<T[]>(SLAB_SIZE));
+		}
+		return static_cast<uint32_t>(m_allocatedSlots++);
+	}
+
+	/**
+	 * @brief Returns the slot to the pool.
+	 * @param slot Index of the slot.
+	 */
+	void release(uint32_t slot) noexcept { m_freeSlots.push_back(slot); }
+
+	/**
+	 * @brief Accesses the slot.
+	 */
+	T& operator[](uint32_t slot) noexcept { return m_slabs[slot >> SLAB_BITS][slot & SLAB_MASK]; }
+
+	/**
+	 * @brief Accesses the slot.
+	 */
+	const T& operator[](uint32_t slot) const noexcept
+	{
+		return m_slabs[slot >> SLAB_BITS][slot & SLAB_MASK];
+	}
+
+	/**
+	 * @brief Returns the maximal number of slots.
+	 */
+	std::size_t capacity() const noexcept { return m_capacity; }
+
+	/**
+	 * @brief Returns the number of slots in use.
+	 */
+	std::size_t used() const noexcept { return m_allocatedSlots - m_freeSlots.size(); }
+
+private:
+	static constexpr unsigned SLAB_BITS = 12;
+	static constexpr std::size_t SLAB_SIZE = std::size_t(1) << SLAB_BITS;
+	static constexpr std::size_t SLAB_MASK = SLAB_SIZE - 1;
+
+	std::size_t m_capacity;
+	std::size_t m_allocatedSlots = 0;
+	std::vector<std::unique_ptr<T[]>> m_slabs;
+	std::vector<uint32_t> m_freeSlots;
+};
+
+} // namespace ScanDetector
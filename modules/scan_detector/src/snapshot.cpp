@@ -0,0 +1,297 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Binary snapshots of the scan detector state
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'S', 'C', 'A', 'N', 'S', 'N', 'A', 'P'};
+
+struct SnapshotHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t partitions;
+	uint64_t payloadSize;
+	uint32_t payloadChecksum;
+	uint32_t headerChecksum;
+};
+
+uint32_t headerChecksum(const SnapshotHeader& header) noexcept
+{
+	SnapshotHeader copy = header;
+	copy.headerChecksum = 0;
+	return ScanDetector::crc32(0, &copy, sizeof(copy));
+}
+
+constexpr std::array<uint32_t, 256> createCrcTable() noexcept
+{
+	std::array<uint32_t, 256> table {};
+	for (uint32_t i = 0; i < table.size(); i++) {
+		uint32_t crc = i;
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 1) != 0 ? (crc >> 1) ^ 0xEDB88320U : crc >> 1;
+		}
+		table[i] = crc;
+	}
+	return table;
+}
+
+constexpr std::array<uint32_t, 256> CRC_TABLE = createCrcTable();
+
+bool writeAll(int fd, const char* data, size_t size) noexcept
+{
+	while (size > 0) {
+		const ssize_t written = ::write(fd, data, size);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		data += written;
+		size -= static_cast<size_t>(written);
+	}
+	return true;
+}
+
+} // namespace
+
+namespace ScanDetector {
+
+uint32_t crc32(uint32_t crc, const void* data, size_t size) noexcept
+{
+	const auto* bytes = static_cast<const uint8_t*>(data);
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++) {
+		crc = CRC_TABLE[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+SnapshotWriter::SnapshotWriter(int fd) noexcept
+	: m_fd(fd)
+{
+}
+
+void SnapshotWriter::write(const void* data, size_t size) noexcept
+{
+	m_checksum = crc32(m_checksum, data, size);
+	m_size += size;
+
+	const auto* bytes = static_cast<const char*>(data);
+	while (size > 0) {
+		if (m_used == BUFFER_SIZE) {
+			flush();
+		}
+		const size_t chunk = std::min(size, BUFFER_SIZE - m_used);
+		std::memcpy(m_buffer + m_used, bytes, chunk);
+		m_used += chunk;
+		bytes += chunk;
+		size -= chunk;
+	}
+}
+
+bool SnapshotWriter::flush() noexcept
+{
+	if (!m_failed && !writeAll(m_fd, m_buffer, m_used)) {
+		m_failed = true;
+	}
+	m_used = 0;
+	return !m_failed;
+}
+
+SnapshotReader::SnapshotReader(const void* data, size_t size) noexcept
+	: m_data(static_cast<const char*>(data))
+	, m_size(size)
+{
+}
+
+void SnapshotReader::read(void* data, size_t size)
+{
+	if (size > m_size - m_offset) {
+		throw std::runtime_error("SnapshotReader: unexpected end of snapshot");
+	}
+	std::memcpy(data, m_data + m_offset, size);
+	m_offset += size;
+}
+
+void writeFlowRecord(SnapshotWriter& writer, const FlowRecord& flowRecord) noexcept
+{
+	writer.put(flowRecord.src);
+	writer.put(flowRecord.dst);
+	writer.put(flowRecord.dstPort);
+	writer.put(flowRecord.tcpFlags);
+}
+
+FlowRecord readFlowRecord(SnapshotReader& reader)
+{
+	FlowRecord flowRecord;
+	flowRecord.src = reader.get<ip_addr_t>();
+	flowRecord.dst = reader.get<ip_addr_t>();
+	flowRecord.dstPort = reader.get<uint16_t>();
+	flowRecord.tcpFlags = reader.get<uint8_t>();
+	return flowRecord;
+}
+
+SnapshotFile::SnapshotFile(std::string path)
+	: m_path(std::move(path))
+	, m_tmpPath(m_path + ".tmp")
+{
+}
+
+SnapshotFile::~SnapshotFile()
+{
+	waitForSave();
+}
+
+int SnapshotFile::beginSave() const noexcept
+{
+	const int fd = open(m_tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return -1;
+	}
+
+	// space for the header, written once the payload is complete
+	if (lseek(fd, sizeof(SnapshotHeader), SEEK_SET) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+bool SnapshotFile::finishSave(int fd, uint32_t partitions, SnapshotWriter& writer) const noexcept
+{
+	bool saved = writer.flush();
+
+	SnapshotHeader header {};
+	std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	header.partitions = partitions;
+	header.payloadSize = writer.size();
+	header.payloadChecksum = writer.checksum();
+	header.headerChecksum = headerChecksum(header);
+
+	saved = saved && pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+	saved = saved && fsync(fd) == 0;
+	saved = close(fd) == 0 && saved;
+	saved = saved && rename(m_tmpPath.c_str(), m_path.c_str()) == 0;
+
+	if (!saved) {
+		unlink(m_tmpPath.c_str());
+	}
+	return saved;
+}
+
+bool SnapshotFile::isSaving()
+{
+	if (m_savingPid < 0) {
+		return false;
+	}
+
+	int status = 0;
+	const pid_t pid = waitpid(m_savingPid, &status, WNOHANG);
+	if (pid == 0) {
+		return true;
+	}
+
+	if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+		m_logger->error("Failed to write snapshot '{}'", m_path);
+	}
+	m_savingPid = -1;
+	return false;
+}
+
+void SnapshotFile::waitForSave()
+{
+	if (m_savingPid < 0) {
+		return;
+	}
+
+	int status = 0;
+	while (waitpid(m_savingPid, &status, 0) < 0 && errno == EINTR) {
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+		m_logger->error("Failed to write snapshot '{}'", m_path);
+	}
+	m_savingPid = -1;
+}
+
+std::shared_ptr<const void> SnapshotFile::map(size_t& size) const
+{
+	const int fd = open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		if (errno == ENOENT) {
+			return nullptr;
+		}
+		throw std::runtime_error("SnapshotFile: cannot open '" + m_path + "': " + strerror(errno));
+	}
+
+	struct stat fileStat {};
+	if (fstat(fd, &fileStat) != 0) {
+		close(fd);
+		throw std::runtime_error("SnapshotFile: cannot stat '" + m_path + "'");
+	}
+
+	size = static_cast<size_t>(fileStat.st_size);
+	if (size < sizeof(SnapshotHeader)) {
+		close(fd);
+		throw std::runtime_error("SnapshotFile: '" + m_path + "' is truncated");
+	}
+
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		throw std::runtime_error("SnapshotFile: cannot map '" + m_path + "'");
+	}
+
+	return std::shared_ptr<const void>(data, [size](const void* mapped) {
+		munmap(const_cast<void*>(mapped), size);
+	});
+}
+
+SnapshotReader SnapshotFile::validate(const void* data, size_t size, uint32_t partitions) const
+{
+	SnapshotHeader header;
+	std::memcpy(&header, data, sizeof(header));
+
+	if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+		|| header.headerChecksum != headerChecksum(header)) {
+		throw std::runtime_error("SnapshotFile: '" + m_path + "' is not a valid snapshot");
+	}
+	if (header.version != VERSION) {
+		throw std::runtime_error(
+			"SnapshotFile: unsupported snapshot version " + std::to_string(header.version));
+	}
+	if (header.partitions != partitions) {
+		throw std::runtime_error(
+			"SnapshotFile: snapshot has " + std::to_string(header.partitions)
+			+ " partitions, expected " + std::to_string(partitions));
+	}
+	if (header.payloadSize != size - sizeof(header)) {
+		throw std::runtime_error("SnapshotFile: '" + m_path + "' is truncated");
+	}
+
+	const char* payload = static_cast<const char*>(data) + sizeof(header);
+	if (crc32(0, payload, header.payloadSize) != header.payloadChecksum) {
+		throw std::runtime_error("SnapshotFile: checksum mismatch in '" + m_path + "'");
+	}
+
+	return SnapshotReader(payload, header.payloadSize);
+}
+
+} // namespace ScanDetector
@@ -0,0 +1,273 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Binary snapshots of the scan detector state
+ *
+ * A snapshot consists of a fixed header followed by the payload written by the detector. The
+ * header holds a magic value, the format version, the number of detector partitions and the
+ * size and CRC-32 of the payload, so a truncated, corrupted or incompatible snapshot is refused
+ * before any state is restored.
+ *
+ * Snapshots are written by a forked child process that serializes its copy-on-write view of the
+ * memory. The writing path does not allocate, so it is safe to run after `fork` in a
+ * multithreaded process. Snapshots are restored from a read-only `mmap` of the file.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "flowRecord.hpp"
+#include "logger/logger.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <type_traits>
+#include <unistd.h>
+
+namespace ScanDetector {
+
+/**
+ * @brief Computes CRC-32 (IEEE 802.3) of the data.
+ * @param crc CRC of the preceding data or zero.
+ */
+uint32_t crc32(uint32_t crc, const void* data, size_t size) noexcept;
+
+/**
+ * @brief Buffered writer of the snapshot payload.
+ *
+ * Errors are remembered instead of thrown, so the writer can be used in a forked child.
+ */
+class SnapshotWriter {
+public:
+	/**
+	 * @brief Constructs the writer appending to the file descriptor.
+	 */
+	explicit SnapshotWriter(int fd) noexcept;
+
+	/**
+	 * @brief Appends raw bytes.
+	 */
+	void write(const void* data, size_t size) noexcept;
+
+	/**
+	 * @brief Appends a trivially copyable value.
+	 */
+	template <typename T>
+	void put(const T& value) noexcept
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "value must be trivially copyable");
+		write(&value, sizeof(T));
+	}
+
+	/**
+	 * @brief Writes the buffered data to the file.
+	 * @return False if any write failed.
+	 */
+	bool flush() noexcept;
+
+	/**
+	 * @brief Returns the number of written bytes.
+	 */
+	uint64_t size() const noexcept { return m_size; }
+
+	/**
+	 * @brief Returns CRC-32 of the written bytes.
+	 */
+	uint32_t checksum() const noexcept { return m_checksum; }
+
+private:
+	static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+	int m_fd;
+	size_t m_used = 0;
+	uint64_t m_size = 0;
+	uint32_t m_checksum = 0;
+	bool m_failed = false;
+	char m_buffer[BUFFER_SIZE];
+};
+
+/**
+ * @brief Bounds-checked reader of the snapshot payload.
+ */
+class SnapshotReader {
+public:
+	/**
+	 * @brief Constructs the reader of the memory range.
+	 */
+	SnapshotReader(const void* data, size_t size) noexcept;
+
+	/**
+	 * @brief Reads raw bytes.
+	 * @throw std::runtime_error If the payload is too short.
+	 */
+	void read(void* data, size_t size);
+
+	/**
+	 * @brief Reads a trivially copyable value.
+	 * @throw std::runtime_error If the payload is too short.
+	 */
+	template <typename T>
+	T get()
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "value must be trivially copyable");
+		T value;
+		read(&value, sizeof(T));
+		return value;
+	}
+
+private:
+	const char* m_data;
+	size_t m_size;
+	size_t m_offset = 0;
+};
+
+/**
+ * @brief Writes the fields of a flow record without padding.
+ */
+void writeFlowRecord(SnapshotWriter& writer, const FlowRecord& flowRecord) noexcept;
+
+/**
+ * @brief Reads a flow record written by writeFlowRecord().
+ */
+FlowRecord readFlowRecord(SnapshotReader& reader);
+
+/**
+ * @brief Snapshot file of the scan detector.
+ *
+ * A snapshot is written into a temporary file and renamed over the previous one once complete,
+ * so the file always holds the last complete snapshot.
+ */
+class SnapshotFile {
+public:
+	/**
+	 * @brief Format version, incremented on every change of the payload layout.
+	 */
+	static constexpr uint32_t VERSION = 7;
+
+	/**
+	 * @brief Constructs the snapshot file.
+	 * @param path Path of the snapshot.
+	 */
+	explicit SnapshotFile(std::string path);
+
+	/**
+	 * @brief Waits for the running background save.
+	 */
+	~SnapshotFile();
+
+	SnapshotFile(const SnapshotFile&) = delete;
+	SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+	/**
+	 * @brief Writes a snapshot in the calling process.
+	 *
+	 * The method does not allocate and does not throw, it can be called in a forked child.
+	 *
+	 * @param partitions Number of detector partitions.
+	 * @param serialize Function called as `serialize(writer)` to write the payload.
+	 * @return True if the snapshot was written.
+	 */
+	template <typename Serialize>
+	bool save(uint32_t partitions, Serialize&& serialize) const noexcept
+	{
+		const int fd = beginSave();
+		if (fd < 0) {
+			return false;
+		}
+
+		SnapshotWriter writer(fd);
+		serialize(writer);
+		return finishSave(fd, partitions, writer);
+	}
+
+	/**
+	 * @brief Writes a snapshot from a forked child process.
+	 *
+	 * The child serializes its copy-on-write view of the memory, so the caller only has to keep
+	 * the state consistent during the `fork` call. Nothing is started if the previous snapshot
+	 * is still being written.
+	 *
+	 * @param partitions Number of detector partitions.
+	 * @param serialize Function called as `serialize(writer)` in the child.
+	 * @return True if the child was started.
+	 */
+	template <typename Serialize>
+	bool saveInBackground(uint32_t partitions, Serialize&& serialize)
+	{
+		if (isSaving()) {
+			return false;
+		}
+
+		const pid_t pid = fork();
+		if (pid == 0) {
+			const bool saved = save(partitions, serialize);
+			_exit(saved ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+		if (pid < 0) {
+			m_logger->error("Failed to fork the snapshot process");
+			return false;
+		}
+
+		m_savingPid = pid;
+		return true;
+	}
+
+	/**
+	 * @brief Checks whether a background save is running and reports its result once it ends.
+	 */
+	bool isSaving();
+
+	/**
+	 * @brief Waits until the background save ends.
+	 */
+	void waitForSave();
+
+	/**
+	 * @brief Restores the state from the snapshot.
+	 *
+	 * The file is mapped to memory and the header and the checksum are validated before the
+	 * payload is passed to the callback.
+	 *
+	 * @param partitions Number of detector partitions, must match the snapshot.
+	 * @param deserialize Function called as `deserialize(reader)` to restore the payload.
+	 * @return False if the snapshot does not exist.
+	 * @throw std::runtime_error If the snapshot is invalid or incompatible.
+	 */
+	template <typename Deserialize>
+	bool load(uint32_t partitions, Deserialize&& deserialize) const
+	{
+		size_t size = 0;
+		const std::shared_ptr<const void> mapping = map(size);
+		if (!mapping) {
+			return false;
+		}
+
+		SnapshotReader reader = validate(mapping.get(), size, partitions);
+		deserialize(reader);
+		return true;
+	}
+
+	/**
+	 * @brief Returns the path of the snapshot.
+	 */
+	const std::string& path() const noexcept { return m_path; }
+
+private:
+	int beginSave() const noexcept;
+	bool finishSave(int fd, uint32_t partitions, SnapshotWriter& writer) const noexcept;
+	std::shared_ptr<const void> map(size_t& size) const;
+	SnapshotReader validate(const void* data, size_t size, uint32_t partitions) const;
+
+	std::string m_path;
+	std::string m_tmpPath;
+	pid_t m_savingPid = -1;
+
+	std::shared_ptr<spdlog::logger> m_logger = Nm::loggerGet("SnapshotFile");
+};
+
+} // namespace ScanDetector
@@ -0,0 +1,448 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Memory-bounded table with Space-Saving eviction
+ *
+ * Implementation of the Stream-Summary data structure from Metwally et al., "Efficient
+ * Computation of Frequent and Top-k Elements in Data Streams". The table holds at most
+ * `capacity` entries. When a new key arrives to a full table, the entry with the minimal count
+ * is evicted and its slot is taken over by the new key, which inherits the minimal count as its
+ * overestimation error. Heavy keys therefore stay in the table with exact or nearly exact counts
+ * while the long tail shares the remaining slots.
+ *
+ * Entries are grouped into buckets of equal count kept in ascending order, so both the
+ * increment and the eviction are O(1).
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ScanDetector {
+
+/**
+ * @brief Memory-bounded associative table with Space-Saving eviction.
+ *
+ * References to values stay valid until the entry is erased or evicted.
+ *
+ * @tparam Key Type of the keys.
+ * @tparam Value Type of the values, must be default constructible.
+ * @tparam Hash Hash function of the keys.
+ * @tparam KeyEqual Equality of the keys.
+ */
+template <
+	typename Key,
+	typename Value,
+	typename Hash = std::hash<Key>,
+	typename KeyEqual = std::equal_to<Key>>
+class StreamSummary {
+public:
+	/**
+	 * @brief Constructs an empty table.
+	 * @param capacity Maximal number of entries.
+	 * @throw std::invalid_argument If the capacity is zero or too large.
+	 */
+	explicit StreamSummary(std::size_t capacity)
+		: m_capacity(capacity)
+	{
+		if (capacity == 0 || capacity >= NONE) {
+			throw std::invalid_argument("StreamSummary: invalid capacity");
+		}
+		// one more slot for the key that replaces an evicted entry
+		m_index.reserve(capacity + 1);
+	}
+
+	/**
+	 * @brief Accounts one occurrence of the key.
+	 *
+	 * If the key is not present and the table is full, the entry with the minimal count is
+	 * evicted first. The callback is called as `onEvict(key, value, count, error)` before the
+	 * slot is reused and must not access the table.
+	 *
+	 * @param key Key to account.
+	 * @param onEvict Callback invoked for the evicted entry.
+	 * @return Pointer to the value and true if the key was inserted.
+	 */
+	template <typename OnEvict>
+	std::pair<Value*, bool> increment(const Key& key, OnEvict&& onEvict)
+	{
+		// the key is hashed once, a new key reserves its index slot right away
+		auto [indexIt, inserted] = m_index.try_emplace(key, NONE);
+		if (!inserted) {
+			incrementNode(indexIt->second);
+			return {&m_nodes[indexIt->second].value, false};
+		}
+
+		if (m_index.size() <= m_capacity) {
+			const uint32_t node = allocateNode(key);
+			linkAsMinimal(node);
+			indexIt->second = node;
+			return {&m_nodes[node].value, true};
+		}
+
+		const uint32_t node = m_buckets[m_minBucket].head;
+		Node& victim = m_nodes[node];
+		const uint64_t minCount = m_buckets[m_minBucket].count;
+		try {
+			onEvict(static_cast<const Key&>(victim.key), victim.value, minCount, victim.error);
+		} catch (...) {
+			m_index.erase(indexIt);
+			throw;
+		}
+
+		m_index.erase(victim.key);
+		m_evictions++;
+		m_evictedCount += minCount - victim.error;
+
+		victim.key = key;
+		victim.value = Value();
+		victim.error = minCount;
+		indexIt->second = node;
+		incrementNode(node);
+		return {&victim.value, true};
+	}
+
+	/**
+	 * @brief Accounts one occurrence of the key without an eviction callback.
+	 */
+	std::pair<Value*, bool> increment(const Key& key)
+	{
+		return increment(key, [](const Key&, Value&, uint64_t, uint64_t) {});
+	}
+
+	/**
+	 * @brief Accounts one occurrence of the key only if it is already present.
+	 * @return Pointer to the value or nullptr if the key is not present.
+	 */
+	Value* incrementExisting(const Key& key)
+	{
+		auto indexIt = m_index.find(key);
+		if (indexIt == m_index.end()) {
+			return nullptr;
+		}
+		incrementNode(indexIt->second);
+		return &m_nodes[indexIt->second].value;
+	}
+
+	/**
+	 * @brief Finds the value of the key.
+	 * @return Pointer to the value or nullptr if the key is not present.
+	 */
+	Value* find(const Key& key) noexcept
+	{
+		auto indexIt = m_index.find(key);
+		return indexIt == m_index.end() ? nullptr : &m_nodes[indexIt->second].value;
+	}
+
+	/**
+	 * @brief Finds the value of the key.
+	 * @return Pointer to the value or nullptr if the key is not present.
+	 */
+	const Value* find(const Key& key) const noexcept
+	{
+		auto indexIt = m_index.find(key);
+		return indexIt == m_index.end() ? nullptr : &m_nodes[indexIt->second].value;
+	}
+
+	/**
+	 * @brief Returns the estimated count of the key or zero if the key is not present.
+	 *
+	 * The real count is in range [count - error, count].
+	 */
+	uint64_t count(const Key& key) const noexcept
+	{
+		auto indexIt = m_index.find(key);
+		if (indexIt == m_index.end()) {
+			return 0;
+		}
+		return m_buckets[m_nodes[indexIt->second].bucket].count;
+	}
+
+	/**
+	 * @brief Returns the overestimation error of the key or zero if the key is not present.
+	 */
+	uint64_t error(const Key& key) const noexcept
+	{
+		auto indexIt = m_index.find(key);
+		return indexIt == m_index.end() ? 0 : m_nodes[indexIt->second].error;
+	}
+
+	/**
+	 * @brief Removes the key from the table.
+	 * @return True if the key was present.
+	 */
+	bool erase(const Key& key)
+	{
+		auto indexIt = m_index.find(key);
+		if (indexIt == m_index.end()) {
+			return false;
+		}
+
+		const uint32_t node = indexIt->second;
+		m_index.erase(indexIt);
+		unlinkNode(node);
+		m_nodes[node].value = Value();
+		m_freeNodes.push_back(node);
+		return true;
+	}
+
+	/**
+	 * @brief Inserts a new entry with the given count.
+	 *
+	 * Used to restore a table from a snapshot. Entries have to be appended in non-decreasing
+	 * order of counts, as visited by forEach().
+	 *
+	 * @return Reference to the default constructed value.
+	 * @throw std::invalid_argument If the table is full, the key is present or the count is
+	 * lower than the maximal count in the table.
+	 */
+	Value& append(const Key& key, uint64_t count, uint64_t error)
+	{
+		if (size() >= m_capacity || count == 0 || m_index.find(key) != m_index.end()
+			|| (m_maxBucket != NONE && m_buckets[m_maxBucket].count > count)) {
+			throw std::invalid_argument("StreamSummary: invalid appended entry");
+		}
+
+		if (m_maxBucket == NONE || m_buckets[m_maxBucket].count != count) {
+			const uint32_t bucket = allocateBucket(count);
+			m_buckets[bucket].prev = m_maxBucket;
+			if (m_maxBucket != NONE) {
+				m_buckets[m_maxBucket].next = bucket;
+			} else {
+				m_minBucket = bucket;
+			}
+			m_maxBucket = bucket;
+		}
+
+		const uint32_t node = allocateNode(key);
+		m_nodes[node].error = error;
+		// appending to the tail keeps the order of entries within the bucket
+		linkNodeAtTail(node, m_maxBucket);
+		m_index.emplace(key, node);
+		return m_nodes[node].value;
+	}
+
+	/**
+	 * @brief Calls `function(key, value, count, error)` for every entry in ascending order of
+	 * counts.
+	 */
+	template <typename Function>
+	void forEach(Function&& function) const
+	{
+		for (uint32_t bucket = m_minBucket; bucket != NONE; bucket = m_buckets[bucket].next) {
+			for (uint32_t node = m_buckets[bucket].head; node != NONE; node = m_nodes[node].next) {
+				const Node& entry = m_nodes[node];
+				function(
+					static_cast<const Key&>(entry.key),
+					entry.value,
+					m_buckets[bucket].count,
+					entry.error);
+			}
+		}
+	}
+
+	/**
+	 * @brief Returns the number of entries.
+	 */
+	std::size_t size() const noexcept { return m_index.size(); }
+
+	/**
+	 * @brief Returns the maximal number of entries.
+	 */
+	std::size_t capacity() const noexcept { return m_capacity; }
+
+	/**
+	 * @brief Returns the number of evicted entries.
+	 */
+	uint64_t evictions() const noexcept { return m_evictions; }
+
+	/**
+	 * @brief Returns the sum of guaranteed counts of the evicted entries.
+	 */
+	uint64_t evictedCount() const noexcept { return m_evictedCount; }
+
+private:
+	static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+	struct Node {
+		Key key;
+		Value value;
+		uint64_t error = 0;
+		uint32_t bucket = NONE;
+		uint32_t prev = NONE;
+		uint32_t next = NONE;
+	};
+
+	struct Bucket {
+		uint64_t count = 0;
+		uint32_t head = NONE;
+		uint32_t tail = NONE;
+		uint32_t prev = NONE;
+		uint32_t next = NONE;
+	};
+
+	uint32_t allocateNode(const Key& key)
+	{
+		if (!m_freeNodes.empty()) {
+			const uint32_t node = m_freeNodes.back();
+			m_freeNodes.pop_back();
+			m_nodes[node].key = key;
+			m_nodes[node].error = 0;
+			return node;
+		}
+
+		m_nodes.emplace_back();
+		m_nodes.back().key = key;
+		return static_cast<uint32_t>(m_nodes.size() - 1);
+	}
+
+	uint32_t allocateBucket(uint64_t count)
+	{
+		uint32_t bucket;
+		if (!m_freeBuckets.empty()) {
+			bucket = m_freeBuckets.back();
+			m_freeBuckets.pop_back();
+		} else {
+			m_buckets.emplace_back();
+			bucket = static_cast<uint32_t>(m_buckets.size() - 1);
+		}
+
+		m_buckets[bucket] = Bucket();
+		m_buckets[bucket].count = count;
+		return bucket;
+	}
+
+	void freeBucket(uint32_t bucket)
+	{
+		const Bucket& entry = m_buckets[bucket];
+		if (entry.prev != NONE) {
+			m_buckets[entry.prev].next = entry.next;
+		} else {
+			m_minBucket = entry.next;
+		}
+		if (entry.next != NONE) {
+			m_buckets[entry.next].prev = entry.prev;
+		} else {
+			m_maxBucket = entry.prev;
+		}
+		m_freeBuckets.push_back(bucket);
+	}
+
+	void linkNode(uint32_t node, uint32_t bucket)
+	{
+		Node& entry = m_nodes[node];
+		entry.bucket = bucket;
+		entry.prev = NONE;
+		entry.next = m_buckets[bucket].head;
+		if (entry.next != NONE) {
+			m_nodes[entry.next].prev = node;
+		} else {
+			m_buckets[bucket].tail = node;
+		}
+		m_buckets[bucket].head = node;
+	}
+
+	void linkNodeAtTail(uint32_t node, uint32_t bucket)
+	{
+		Node& entry = m_nodes[node];
+		entry.bucket = bucket;
+		entry.next = NONE;
+		entry.prev = m_buckets[bucket].tail;
+		if (entry.prev != NONE) {
+			m_nodes[entry.prev].next = node;
+		} else {
+			m_buckets[bucket].head = node;
+		}
+		m_buckets[bucket].tail = node;
+	}
+
+	void unlinkNode(uint32_t node)
+	{
+		Node& entry = m_nodes[node];
+		if (entry.prev != NONE) {
+			m_nodes[entry.prev].next = entry.next;
+		} else {
+			m_buckets[entry.bucket].head = entry.next;
+		}
+		if (entry.next != NONE) {
+			m_nodes[entry.next].prev = entry.prev;
+		} else {
+			m_buckets[entry.bucket].tail = entry.prev;
+		}
+
+		if (m_buckets[entry.bucket].head == NONE) {
+			freeBucket(entry.bucket);
+		}
+		entry.bucket = NONE;
+	}
+
+	void linkAsMinimal(uint32_t node)
+	{
+		if (m_minBucket == NONE || m_buckets[m_minBucket].count != 1) {
+			const uint32_t bucket = allocateBucket(1);
+			m_buckets[bucket].next = m_minBucket;
+			if (m_minBucket != NONE) {
+				m_buckets[m_minBucket].prev = bucket;
+			} else {
+				m_maxBucket = bucket;
+			}
+			m_minBucket = bucket;
+		}
+		linkNode(node, m_minBucket);
+	}
+
+	void incrementNode(uint32_t node)
+	{
+		const uint32_t bucket = m_nodes[node].bucket;
+		const uint64_t newCount = m_buckets[bucket].count + 1;
+		const uint32_t next = m_buckets[bucket].next;
+
+		if (next != NONE && m_buckets[next].count == newCount) {
+			unlinkNode(node);
+			linkNode(node, next);
+			return;
+		}
+
+		if (m_buckets[bucket].head == node && m_nodes[node].next == NONE) {
+			// the only node of the bucket, the bucket keeps its position
+			m_buckets[bucket].count = newCount;
+			return;
+		}
+
+		const uint32_t newBucket = allocateBucket(newCount);
+		m_buckets[newBucket].prev = bucket;
+		m_buckets[newBucket].next = next;
+		if (next != NONE) {
+			m_buckets[next].prev = newBucket;
+		} else {
+			m_maxBucket = newBucket;
+		}
+		m_buckets[bucket].next = newBucket;
+
+		unlinkNode(node);
+		linkNode(node, newBucket);
+	}
+
+	std::size_t m_capacity;
+	std::deque<Node> m_nodes;
+	std::vector<uint32_t> m_freeNodes;
+	std::vector<Bucket> m_buckets;
+	std::vector<uint32_t> m_freeBuckets;
+	uint32_t m_minBucket = NONE;
+	uint32_t m_maxBucket = NONE;
+	std::unordered_map<Key, uint32_t, Hash, KeyEqual> m_index;
+	uint64_t m_evictions = 0;
+	uint64_t m_evictedCount = 0;
+};
+
+} // namespace ScanDetector
@@ -0,0 +1,425 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Implementation of the SubnetAggregator class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "subnetAggregator.hpp"
+#include "ipPrefix.hpp"
+#include "scanDetector.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr uint8_t TCP_FLAGS_SYN_ONLY = 0x02;
+constexpr size_t MAX_SAMPLE_TARGETS = 32;
+constexpr size_t MAX_REPORTED_PORTS = 64;
+constexpr size_t MAX_REPORTED_PORT_RANGES = 64;
+
+uint64_t mixTargetPort(const ip_addr_t& target, uint16_t port) noexcept
+{
+	uint64_t hash = ScanDetector::mixAddress(target) ^ (uint64_t(port) * 0x9e3779b97f4a7c15ULL);
+	hash ^= hash >> 31;
+	hash *= 0xbf58476d1ce4e5b9ULL;
+	hash ^= hash >> 29;
+	return hash;
+}
+
+} // namespace
+
+namespace ScanDetector {
+
+SubnetAggregator::SubnetAggregator(
+	const ScanDetectorConfig& config,
+	const ThresholdRandomWalk& trw,
+	uint64_t now)
+	: m_enabled(config.maxSubnets > 0)
+	, m_prefix4(config.subnetPrefix4)
+	, m_prefix6(config.subnetPrefix6)
+	, m_minSize(config.minSize)
+	, m_minSources(config.subnetMinSources)
+	, m_susNorRatio(config.susNorRatio)
+	, m_srcDstRatio(config.srcDstRatio)
+	, m_synSrcRatio(config.synSrcRatio)
+	, m_inactiveTimeout(config.inactiveTimeout)
+	, m_trw(trw)
+	, m_now(now)
+	, m_subnetMap(m_enabled ? config.maxSubnets : 1)
+	, m_susSubnetMap(m_enabled ? config.maxSuspectSubnets : 1)
+	, m_subnetTimers(now)
+	, m_suspectTimers(now)
+{
+	if (m_enabled && (m_prefix4 == 0 || m_prefix4 > 32 || m_prefix6 == 0 || m_prefix6 > 128)) {
+		throw std::invalid_argument("SubnetAggregator: prefix lengths must be in range 1-32 and 1-128");
+	}
+}
+
+ip_addr_t SubnetAggregator::subnetOf(const ip_addr_t& address) const noexcept
+{
+	return applyPrefix(address, m_prefix4, m_prefix6);
+}
+
+void SubnetAggregator::addSource(const FlowRecord& flow)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	const ip_addr_t subnet = subnetOf(flow.src);
+
+	SusSubnetData* suspect = m_susSubnetMap.incrementExisting(subnet);
+	if (suspect != nullptr) {
+		accountSuspect(subnet, *suspect, flow);
+		return;
+	}
+
+	auto [entry, inserted] = m_subnetMap.increment(subnet);
+	SubnetData& subnetData = *entry;
+	subnetData.lastSeen = m_now;
+	if (inserted) {
+		subnetData.expiresAt = m_now + m_inactiveTimeout;
+		subnetData.timer
+			= scheduleEntryTimer(m_subnetTimers, m_subnetMap, subnet, subnetData.expiresAt);
+	}
+
+	//the walk runs over the connections of all sources of the subnet
+	if (m_trw.update(subnetData.trw, flow.dst, flow.tcpFlags) == TrwDecision::Scanner) {
+		promoteToSuspect(subnet);
+	}
+}
+
+void SubnetAggregator::addDestination(const FlowRecord& flow)
+{
+	if (!m_enabled) {
+		return;
+	}
+
+	SusSubnetData* suspect = m_susSubnetMap.find(subnetOf(flow.dst));
+	if (suspect != nullptr) {
+		suspect->inFlows++;
+	}
+}
+
+void SubnetAggregator::advanceTime(uint64_t now)
+{
+	if (now <= m_now) {
+		return;
+	}
+	m_now = now;
+
+	m_subnetTimers.advance(m_now, [this](const ip_addr_t& subnet, uint64_t timer) {
+		expireSubnet(subnet, timer);
+	});
+	m_suspectTimers.advance(m_now, [this](const ip_addr_t& subnet, uint64_t timer) {
+		expireSuspect(subnet, timer);
+	});
+}
+
+void SubnetAggregator::setReportCallback(ReportCallback callback)
+{
+	m_reportCallback = std::move(callback);
+}
+
+void SubnetAggregator::fillStats(ScanDetectorStats& stats) const noexcept
+{
+	stats.subnets = m_enabled ? m_subnetMap.size() : 0;
+	stats.suspectSubnets = m_enabled ? m_susSubnetMap.size() : 0;
+	stats.detectedSubnets = m_detectedSubnets;
+	stats.expiredSubnets = m_expiredSubnets;
+	stats.evictedSubnets = m_subnetMap.evictions() + m_susSubnetMap.evictions();
+}
+
+void SubnetAggregator::promoteToSuspect(const ip_addr_t& subnet)
+{
+	m_subnetMap.erase(subnet);
+
+	auto onEvict = [this](const ip_addr_t& evicted, SusSubnetData& suspect, uint64_t, uint64_t) {
+		finalizeSuspect(evicted, suspect);
+	};
+
+	SusSubnetData& suspect = *m_susSubnetMap.increment(subnet, onEvict).first;
+	suspect.firstSeen = m_now;
+	suspect.lastSeen = m_now;
+	suspect.expiresAt = m_now + m_inactiveTimeout;
+	suspect.nextEvaluation = m_minSize;
+	suspect.sampleTargets.reserve(MAX_SAMPLE_TARGETS);
+	suspect.timer = scheduleEntryTimer(m_suspectTimers, m_susSubnetMap, subnet, suspect.expiresAt);
+}
+
+void SubnetAggregator::accountSuspect(
+	const ip_addr_t& subnet,
+	SusSubnetData& suspect,
+	const FlowRecord& flow)
+{
+	suspect.lastSeen = m_now;
+	suspect.flows++;
+	if (flow.tcpFlags == TCP_FLAGS_SYN_ONLY) {
+		suspect.syn++;
+	}
+	suspect.sources.add(mixAddress(flow.src));
+
+	suspect.ports.add(flow.dstPort);
+	suspect.targetPorts.add(mixTargetPort(flow.dst, flow.dstPort));
+
+	if (!suspect.targets.add(mixAddress(flow.dst))) {
+		return;
+	}
+
+	if (suspect.sampleTargets.size() < MAX_SAMPLE_TARGETS) {
+		suspect.sampleTargets.push_back(flow.dst);
+	}
+
+	if (suspect.targets.setBits() < suspect.nextEvaluation) {
+		return;
+	}
+
+	switch (evaluateSuspect(suspect)) {
+	case Verdict::Scanner:
+		if (!suspect.reported) {
+			reportScanner(subnet, suspect);
+		}
+		// re-evaluate once the number of targets doubles
+		suspect.nextEvaluation = 2 * static_cast<uint64_t>(suspect.targets.setBits());
+		break;
+	case Verdict::Benign:
+		m_susSubnetMap.erase(subnet);
+		break;
+	case Verdict::Undecided:
+		suspect.nextEvaluation = suspect.targets.setBits() + m_minSize;
+		break;
+	}
+}
+
+SubnetAggregator::Verdict SubnetAggregator::evaluateSuspect(const SusSubnetData& suspect) const
+{
+	const double targets = suspect.targets.estimate();
+	if (targets < static_cast<double>(m_minSize)
+		|| suspect.sources.estimate() < static_cast<double>(m_minSources)) {
+		//a single source is left to the per-address detection
+		return Verdict::Undecided;
+	}
+
+	const auto outFlows = static_cast<double>(suspect.flows);
+	const auto inFlows = static_cast<double>(suspect.inFlows);
+
+	if (inFlows > 0 && outFlows / inFlows < m_srcDstRatio) {
+		return Verdict::Benign;
+	}
+
+	if (suspect.syn > 0 && outFlows / static_cast<double>(suspect.syn) < m_synSrcRatio) {
+		return Verdict::Benign;
+	}
+
+	//probes of a scan hit every pair of a target and a port about once, several ports per target
+	//are fine, e.g. a botnet probing 22, 23 and 80 on every host
+	const double pairs = suspect.targetPorts.estimate();
+	return std::min(pairs / outFlows, 1.0) > m_susNorRatio ? Verdict::Scanner : Verdict::Benign;
+}
+
+void SubnetAggregator::reportScanner(const ip_addr_t& subnet, SusSubnetData& suspect)
+{
+	suspect.reported = true;
+	m_detectedSubnets++;
+
+	if (!m_reportCallback) {
+		return;
+	}
+
+	ScannerReport report;
+	report.source = subnet;
+	report.sourcePrefixLength = ip_is4(&subnet) ? m_prefix4 : m_prefix6;
+	report.sourceCount = static_cast<uint64_t>(suspect.sources.estimate() + 0.5);
+	report.firstSeen = suspect.firstSeen;
+	report.lastSeen = suspect.lastSeen;
+	report.detectTime = m_now;
+	report.targetCount = static_cast<uint64_t>(suspect.targets.estimate() + 0.5);
+	report.flowCount = suspect.flows;
+	report.synCount = suspect.syn;
+	report.targets = suspect.sampleTargets;
+	report.portCount = suspect.ports.cardinality();
+	report.scanType = classifyScan(
+		static_cast<double>(report.targetCount),
+		static_cast<double>(report.portCount),
+		suspect.targetPorts.estimate());
+
+	suspect.ports.forEachRange([&report](uint64_t first, uint64_t last) {
+		for (uint64_t port = first; port <= last && report.ports.size() < MAX_REPORTED_PORTS; port++) {
+			report.ports.push_back(static_cast<uint16_t>(port));
+		}
+		report.portRanges.emplace_back(first, last);
+		return report.portRanges.size() < MAX_REPORTED_PORT_RANGES;
+	});
+
+	m_reportCallback(report);
+}
+
+void SubnetAggregator::finalizeSuspect(const ip_addr_t& subnet, SusSubnetData& suspect)
+{
+	if (!suspect.reported && evaluateSuspect(suspect) == Verdict::Scanner) {
+		reportScanner(subnet, suspect);
+	}
+}
+
+void SubnetAggregator::expireSubnet(const ip_addr_t& subnet, uint64_t timer)
+{
+	SubnetData* entry = m_subnetMap.find(subnet);
+	if (entry == nullptr || entry->timer != timer) {
+		return;
+	}
+
+	if (entry->lastSeen + m_inactiveTimeout > m_now) {
+		entry->expiresAt = entry->lastSeen + m_inactiveTimeout;
+		entry->timer = scheduleEntryTimer(m_subnetTimers, m_subnetMap, subnet, entry->expiresAt);
+		return;
+	}
+
+	m_subnetMap.erase(subnet);
+	m_expiredSubnets++;
+}
+
+void SubnetAggregator::expireSuspect(const ip_addr_t& subnet, uint64_t timer)
+{
+	SusSubnetData* entry = m_susSubnetMap.find(subnet);
+	if (entry == nullptr || entry->timer != timer) {
+		return;
+	}
+
+	if (entry->lastSeen + m_inactiveTimeout > m_now) {
+		entry->expiresAt = entry->lastSeen + m_inactiveTimeout;
+		entry->timer
+			= scheduleEntryTimer(m_suspectTimers, m_susSubnetMap, subnet, entry->expiresAt);
+		return;
+	}
+
+	finalizeSuspect(subnet, *entry);
+	m_susSubnetMap.erase(subnet);
+	m_expiredSubnets++;
+}
+
+void SubnetAggregator::serialize(SnapshotWriter& writer) const noexcept
+{
+	writer.put(m_detectedSubnets);
+	writer.put(m_expiredSubnets);
+
+	writer.put<uint64_t>(m_enabled ? m_subnetMap.size() : 0);
+	if (m_enabled) {
+		m_subnetMap.forEach([&](const ip_addr_t& subnet,
+								const SubnetData& subnetData,
+								uint64_t count,
+								uint64_t error) {
+			writer.put(subnet);
+			writer.put(count);
+			writer.put(error);
+			writer.put(subnetData.lastSeen);
+			writer.put(subnetData.expiresAt);
+			writer.put(subnetData.trw.contactedTargets);
+			writer.put(subnetData.trw.logLikelihoodRatio);
+			writer.put(subnetData.trw.observations);
+		});
+	}
+
+	writer.put<uint64_t>(m_enabled ? m_susSubnetMap.size() : 0);
+	if (m_enabled) {
+		m_susSubnetMap.forEach([&](const ip_addr_t& subnet,
+								   const SusSubnetData& suspect,
+								   uint64_t count,
+								   uint64_t error) {
+			writer.put(subnet);
+			writer.put(count);
+			writer.put(error);
+			writer.put(suspect.targets);
+			writer.put(suspect.targetPorts);
+			writer.put(suspect.sources);
+			writer.put(suspect.flows);
+			writer.put(suspect.syn);
+			writer.put(suspect.inFlows);
+			writer.put(suspect.firstSeen);
+			writer.put(suspect.lastSeen);
+			writer.put(suspect.expiresAt);
+			writer.put(suspect.nextEvaluation);
+			writer.put<uint8_t>(suspect.reported ? 1 : 0);
+			writer.put<uint32_t>(static_cast<uint32_t>(suspect.sampleTargets.size()));
+			for (const auto& target : suspect.sampleTargets) {
+				writer.put(target);
+			}
+			suspect.ports.serialize(writer);
+		});
+	}
+}
+
+void SubnetAggregator::deserialize(SnapshotReader& reader)
+{
+	m_detectedSubnets = reader.get<uint64_t>();
+	m_expiredSubnets = reader.get<uint64_t>();
+
+	// entries come in ascending order of counts, the lightest ones are skipped if the table
+	// is smaller than the snapshot
+	const auto subnets = reader.get<uint64_t>();
+	const uint64_t skippedSubnets = !m_enabled ? subnets
+		: subnets > m_subnetMap.capacity()     ? subnets - m_subnetMap.capacity()
+											   : 0;
+	for (uint64_t i = 0; i < subnets; i++) {
+		const auto subnet = reader.get<ip_addr_t>();
+		const auto count = reader.get<uint64_t>();
+		const auto error = reader.get<uint64_t>();
+
+		SubnetData subnetData;
+		subnetData.lastSeen = reader.get<uint64_t>();
+		subnetData.expiresAt = std::max(reader.get<uint64_t>(), m_now + 1);
+		subnetData.trw.contactedTargets = reader.get<decltype(subnetData.trw.contactedTargets)>();
+		subnetData.trw.logLikelihoodRatio
+			= reader.get<decltype(subnetData.trw.logLikelihoodRatio)>();
+		subnetData.trw.observations = reader.get<decltype(subnetData.trw.observations)>();
+
+		if (i < skippedSubnets) {
+			continue;
+		}
+		SubnetData& appended = m_subnetMap.append(subnet, count, error);
+		appended = subnetData;
+		appended.timer
+			= scheduleEntryTimer(m_subnetTimers, m_subnetMap, subnet, appended.expiresAt);
+	}
+
+	const auto suspects = reader.get<uint64_t>();
+	const uint64_t skippedSuspects = !m_enabled ? suspects
+		: suspects > m_susSubnetMap.capacity()   ? suspects - m_susSubnetMap.capacity()
+												 : 0;
+	for (uint64_t i = 0; i < suspects; i++) {
+		const auto subnet = reader.get<ip_addr_t>();
+		const auto count = reader.get<uint64_t>();
+		const auto error = reader.get<uint64_t>();
+
+		SusSubnetData suspect;
+		suspect.targets = reader.get<decltype(suspect.targets)>();
+		suspect.targetPorts = reader.get<decltype(suspect.targetPorts)>();
+		suspect.sources = reader.get<decltype(suspect.sources)>();
+		suspect.flows = reader.get<uint64_t>();
+		suspect.syn = reader.get<uint64_t>();
+		suspect.inFlows = reader.get<uint64_t>();
+		suspect.firstSeen = reader.get<uint64_t>();
+		suspect.lastSeen = reader.get<uint64_t>();
+		suspect.expiresAt = std::max(reader.get<uint64_t>(), m_now + 1);
+		suspect.nextEvaluation = reader.get<uint64_t>();
+		suspect.reported = reader.get<uint8_t>() != 0;
+		const auto targets = std::min<uint32_t>(reader.get<uint32_t>(), MAX_SAMPLE_TARGETS);
+		for (uint32_t target = 0; target < targets; target++) {
+			suspect.sampleTargets.push_back(reader.get<ip_addr_t>());
+		}
+		suspect.ports.deserialize(reader);
+
+		if (i < skippedSuspects) {
+			continue;
+		}
+		SusSubnetData& appended = m_susSubnetMap.append(subnet, count, error);
+		appended = std::move(suspect);
+		appended.timer
+			= scheduleEntryTimer(m_suspectTimers, m_susSubnetMap, subnet, appended.expiresAt);
+	}
+}
+
+} // namespace ScanDetector
@@ -0,0 +1,167 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Declaration of the SubnetAggregator class
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "flowRecord.hpp"
+#include "ipAddressHash.hpp"
+#include "linearCounter.hpp"
+#include "roaringBitmap.hpp"
+#include "scannerReport.hpp"
+#include "snapshot.hpp"
+#include "streamSummary.hpp"
+#include "thresholdRandomWalk.hpp"
+#include "timerWheel.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ScanDetector {
+
+struct ScanDetectorConfig;
+struct ScanDetectorStats;
+
+/**
+ * @brief Detects scans distributed over the source addresses of a subnet.
+ *
+ * Sources are aggregated by a configurable prefix (IPv4 /24 and IPv6 /64 by default). Every
+ * subnet runs its own threshold random walk over the connections of all its sources, so a scan
+ * whose probes are spread over many sources is noticed even if every source stays inconspicuous.
+ * Subnets that cross the upper bound become suspects and their distinct targets and sources are
+ * counted in fixed-size linear counters, together with the distinct pairs of a target and a port.
+ * A suspect subnet is confirmed with the same ratios as a single source, and only if the probes
+ * come from at least the configured number of sources, so single scanners are left to the
+ * per-address detection.
+ *
+ * The memory is bounded the same way as for single addresses, both tables use Space-Saving
+ * eviction and every entry has a constant size.
+ *
+ * The class is not thread-safe.
+ */
+class SubnetAggregator {
+public:
+	/**
+	 * @brief Constructs the aggregator.
+	 * @param config Configuration of the detector, aggregation is disabled if maxSubnets is 0.
+	 * @param trw Parameters of the threshold random walk.
+	 * @param now Current time in seconds.
+	 */
+	SubnetAggregator(const ScanDetectorConfig& config, const ThresholdRandomWalk& trw, uint64_t now);
+
+	// the aggregator refers to the random walk of its owner
+	SubnetAggregator(const SubnetAggregator&) = delete;
+	SubnetAggregator& operator=(const SubnetAggregator&) = delete;
+	SubnetAggregator(SubnetAggregator&&) = delete;
+	SubnetAggregator& operator=(SubnetAggregator&&) = delete;
+
+	/**
+	 * @brief Accounts the source side of a record.
+	 */
+	void addSource(const FlowRecord& flow);
+
+	/**
+	 * @brief Accounts the destination side of a record.
+	 */
+	void addDestination(const FlowRecord& flow);
+
+	/**
+	 * @brief Advances time and expires inactive subnets.
+	 * @param now Current time in seconds.
+	 */
+	void advanceTime(uint64_t now);
+
+	/**
+	 * @brief Sets the callback invoked for every detected distributed scan.
+	 */
+	void setReportCallback(ReportCallback callback);
+
+	/**
+	 * @brief Fills the subnet statistics.
+	 */
+	void fillStats(ScanDetectorStats& stats) const noexcept;
+
+	/**
+	 * @brief Writes the tables into a snapshot, does not allocate.
+	 */
+	void serialize(SnapshotWriter& writer) const noexcept;
+
+	/**
+	 * @brief Restores the tables from a snapshot.
+	 *
+	 * If aggregation is disabled, the section is read and dropped.
+	 *
+	 * @throw std::runtime_error If the snapshot is malformed.
+	 */
+	void deserialize(SnapshotReader& reader);
+
+private:
+	struct SubnetData {
+		uint64_t lastSeen = 0;
+		uint64_t expiresAt = 0;
+		uint64_t timer = 0; ///< Id of the current expiration timer.
+		TrwState trw;
+	};
+
+	struct SusSubnetData {
+		LinearCounter<4096> targets;
+		LinearCounter<8192> targetPorts; ///< Distinct pairs of a target and a port.
+		LinearCounter<256> sources;
+		std::vector<ip_addr_t> sampleTargets;
+		RoaringBitmap ports;
+		uint64_t flows = 0;
+		uint64_t syn = 0;
+		uint64_t inFlows = 0;
+		uint64_t firstSeen = 0;
+		uint64_t lastSeen = 0;
+		uint64_t expiresAt = 0;
+		uint64_t timer = 0; ///< Id of the current expiration timer.
+		uint64_t nextEvaluation = 0;
+		bool reported = false;
+	};
+
+	enum class Verdict {
+		Undecided,
+		Scanner,
+		Benign,
+	};
+
+	ip_addr_t subnetOf(const ip_addr_t& address) const noexcept;
+
+	void promoteToSuspect(const ip_addr_t& subnet);
+	void accountSuspect(const ip_addr_t& subnet, SusSubnetData& suspect, const FlowRecord& flow);
+	Verdict evaluateSuspect(const SusSubnetData& suspect) const;
+	void reportScanner(const ip_addr_t& subnet, SusSubnetData& suspect);
+	void finalizeSuspect(const ip_addr_t& subnet, SusSubnetData& suspect);
+
+	void expireSubnet(const ip_addr_t& subnet, uint64_t timer);
+	void expireSuspect(const ip_addr_t& subnet, uint64_t timer);
+
+	bool m_enabled;
+	uint8_t m_prefix4;
+	uint8_t m_prefix6;
+	uint64_t m_minSize;
+	uint64_t m_minSources;
+	double m_susNorRatio;
+	double m_srcDstRatio;
+	double m_synSrcRatio;
+	uint64_t m_inactiveTimeout;
+
+	const ThresholdRandomWalk& m_trw;
+	uint64_t m_now;
+
+	StreamSummary<ip_addr_t, SubnetData, IPAddressHash, IPAddressEqual> m_subnetMap;
+	StreamSummary<ip_addr_t, SusSubnetData, IPAddressHash, IPAddressEqual> m_susSubnetMap;
+	TimerWheel<ip_addr_t> m_subnetTimers;
+	TimerWheel<ip_addr_t> m_suspectTimers;
+
+	ReportCallback m_reportCallback;
+	uint64_t m_detectedSubnets = 0;
+	uint64_t m_expiredSubnets = 0;
+};
+
+} // namespace ScanDetector
@@ -0,0 +1,58 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Counter owned by a single thread
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ScanDetector {
+
+/**
+ * @brief Counter written by one thread and read by any thread.
+ *
+ * The owning thread updates the counter by a relaxed load and store, which compiles to plain
+ * moves, so an update costs as much as incrementing an ordinary integer. Other threads, e.g. the
+ * telemetry, read the latest stored value without any synchronization with the owner.
+ */
+class ThreadCounter {
+public:
+	/**
+	 * @brief Adds to the counter, must only be called by the owning thread.
+	 */
+	void add(uint64_t value = 1) noexcept
+	{
+		m_value.store(m_value.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Sets the counter, must only be called by the owning thread.
+	 */
+	void set(uint64_t value) noexcept { m_value.store(value, std::memory_order_relaxed); }
+
+	/**
+	 * @brief Returns the current value, can be called by any thread.
+	 */
+	uint64_t load() const noexcept { return m_value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<uint64_t> m_value {0};
+};
+
+/**
+ * @brief Returns nanoseconds elapsed since the given time point.
+ */
+inline uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) noexcept
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+									 std::chrono::steady_clock::now() - start)
+									 .count());
+}
+
+} // namespace ScanDetector
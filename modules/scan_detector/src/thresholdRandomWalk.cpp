@@ -0,0 +1,141 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Implementation of the Threshold Random Walk sequential scan detector.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "thresholdRandomWalk.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint8_t TCP_FLAG_FIN = 0x01;
+constexpr uint8_t TCP_FLAG_SYN = 0x02;
+constexpr uint8_t TCP_FLAG_RST = 0x04;
+constexpr uint8_t TCP_FLAG_ACK = 0x10;
+
+uint64_t mixTarget(const ip_addr_t& target) noexcept
+{
+	// splitmix64 finalizer over both halves of the address
+	uint64_t hash = target.ui64[0] ^ (target.ui64[1] * 0x9e3779b97f4a7c15ULL);
+	hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+	return hash ^ (hash >> 31);
+}
+
+bool isProbability(double value) noexcept
+{
+	return value > 0.0 && value < 1.0;
+}
+
+} // namespace
+
+namespace ScanDetector {
+
+ConnectionOutcome classifyConnection(uint8_t tcpFlags) noexcept
+{
+	if ((tcpFlags & TCP_FLAG_ACK) != 0) {
+		return ConnectionOutcome::Success;
+	}
+
+	if ((tcpFlags & (TCP_FLAG_SYN | TCP_FLAG_RST | TCP_FLAG_FIN)) != 0) {
+		return ConnectionOutcome::Failure;
+	}
+
+	return ConnectionOutcome::Unknown;
+}
+
+ThresholdRandomWalk::ThresholdRandomWalk()
+	: ThresholdRandomWalk(TrwConfig())
+{
+}
+
+ThresholdRandomWalk::ThresholdRandomWalk(const TrwConfig& config)
+{
+	validate(config);
+
+	const double theta0 = config.benignSuccessProbability;
+	const double theta1 = config.scannerSuccessProbability;
+	const double detection = config.detectionProbability;
+	const double falsePositive = config.falsePositiveProbability;
+
+	m_successStep = static_cast<float>(std::log(theta1 / theta0));
+	m_failureStep = static_cast<float>(std::log((1.0 - theta1) / (1.0 - theta0)));
+	m_upperBound = static_cast<float>(std::log(detection / falsePositive));
+	m_lowerBound = static_cast<float>(std::log((1.0 - detection) / (1.0 - falsePositive)));
+}
+
+void ThresholdRandomWalk::validate(const TrwConfig& config)
+{
+	if (!isProbability(config.detectionProbability)
+		|| !isProbability(config.falsePositiveProbability)
+		|| !isProbability(config.benignSuccessProbability)
+		|| !isProbability(config.scannerSuccessProbability)) {
+		throw std::invalid_argument("ThresholdRandomWalk: probabilities must be in range (0, 1)");
+	}
+
+	if (config.scannerSuccessProbability >= config.benignSuccessProbability) {
+		throw std::invalid_argument(
+			"ThresholdRandomWalk: scanner success probability must be lower than the benign one");
+	}
+
+	if (config.falsePositiveProbability >= config.detectionProbability) {
+		throw std::invalid_argument(
+			"ThresholdRandomWalk: false positive probability must be lower than the detection "
+			"probability");
+	}
+}
+
+bool ThresholdRandomWalk::markFirstContact(TrwState& state, const ip_addr_t& target) noexcept
+{
+	constexpr unsigned FILTER_WORD_BITS = 64;
+	constexpr unsigned FILTER_INDEX_MASK = 127;
+
+	const uint64_t hash = mixTarget(target);
+	const unsigned firstBit = hash & FILTER_INDEX_MASK;
+	const unsigned secondBit = (hash >> 7U) & FILTER_INDEX_MASK;
+
+	uint64_t& firstWord = state.contactedTargets[firstBit / FILTER_WORD_BITS];
+	uint64_t& secondWord = state.contactedTargets[secondBit / FILTER_WORD_BITS];
+	const uint64_t firstMask = 1ULL << (firstBit % FILTER_WORD_BITS);
+	const uint64_t secondMask = 1ULL << (secondBit % FILTER_WORD_BITS);
+
+	const bool seen = (firstWord & firstMask) != 0 && (secondWord & secondMask) != 0;
+	firstWord |= firstMask;
+	secondWord |= secondMask;
+	return !seen;
+}
+
+TrwDecision
+ThresholdRandomWalk::update(TrwState& state, const ip_addr_t& target, uint8_t tcpFlags) const noexcept
+{
+	const ConnectionOutcome outcome = classifyConnection(tcpFlags);
+	if (outcome == ConnectionOutcome::Unknown) {
+		return TrwDecision::Pending;
+	}
+
+	if (!markFirstContact(state, target)) {
+		return TrwDecision::Pending;
+	}
+
+	state.logLikelihoodRatio
+		+= outcome == ConnectionOutcome::Success ? m_successStep : m_failureStep;
+	state.observations++;
+
+	if (state.logLikelihoodRatio >= m_upperBound) {
+		return TrwDecision::Scanner;
+	}
+
+	if (state.logLikelihoodRatio <= m_lowerBound) {
+		state = TrwState();
+		return TrwDecision::Benign;
+	}
+
+	return TrwDecision::Pending;
+}
+
+} // namespace ScanDetector
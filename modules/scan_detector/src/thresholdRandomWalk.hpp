@@ -0,0 +1,117 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Declaration of the Threshold Random Walk sequential scan detector.
+ *
+ * Implementation of the sequential hypothesis test described by Jung et al. in "Fast Portscan
+ * Detection Using Sequential Hypothesis Testing". Every first-contact connection of a source
+ * moves its likelihood ratio up (failure) or down (success). The source is declared a scanner
+ * as soon as the ratio crosses the upper bound and benign once it crosses the lower one.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unirec++/unirec.hpp>
+
+namespace ScanDetector {
+
+/**
+ * @brief Outcome of a connection attempt approximated from TCP flags of a flow.
+ */
+enum class ConnectionOutcome : uint8_t {
+	Unknown, ///< Flow does not carry enough information (e.g. non-TCP traffic).
+	Success, ///< Handshake was completed.
+	Failure, ///< Connection attempt was not answered or was rejected.
+};
+
+/**
+ * @brief Decision of the random walk after an update.
+ */
+enum class TrwDecision : uint8_t {
+	Pending, ///< Neither bound has been crossed yet.
+	Scanner, ///< Upper bound crossed, source is a scanner.
+	Benign, ///< Lower bound crossed, source is benign and the walk restarts.
+};
+
+/**
+ * @brief Parameters of the sequential hypothesis test.
+ */
+struct TrwConfig {
+	double detectionProbability = 0.99; ///< Desired detection probability (P_D).
+	double falsePositiveProbability = 0.01; ///< Maximal false positive probability (P_F).
+	double benignSuccessProbability = 0.8; ///< Probability of success for a benign source.
+	double scannerSuccessProbability = 0.2; ///< Probability of success for a scanner.
+};
+
+/**
+ * @brief Per-source state of the random walk.
+ *
+ * Only connections to previously unseen targets are accounted. The targets are remembered in
+ * a small fixed-size bit filter, so the state has a constant size regardless of the number of
+ * targets the source contacts.
+ */
+struct TrwState {
+	std::array<uint64_t, 2> contactedTargets {}; ///< First-contact filter.
+	float logLikelihoodRatio = 0; ///< Current logarithm of the likelihood ratio.
+	uint16_t observations = 0; ///< Number of first-contact connections accounted.
+};
+
+/**
+ * @brief Approximates the connection outcome from the cumulative TCP flags of a flow.
+ *
+ * A flow with the ACK flag is considered a completed handshake. A flow carrying SYN, RST or FIN
+ * without ACK is considered a failed attempt, a FIN without ACK is sent only by stealth FIN and
+ * Xmas probes. Anything else, e.g. a NULL probe without any flag, is unknown.
+ *
+ * @param tcpFlags Cumulative TCP flags of the flow.
+ * @return Approximated connection outcome.
+ */
+ConnectionOutcome classifyConnection(uint8_t tcpFlags) noexcept;
+
+/**
+ * @brief Threshold Random Walk engine.
+ *
+ * The engine itself is stateless, the per-source state is stored by the caller in TrwState.
+ */
+class ThresholdRandomWalk {
+public:
+	/**
+	 * @brief Constructs the engine with default parameters.
+	 */
+	ThresholdRandomWalk();
+
+	/**
+	 * @brief Constructs the engine with the given parameters.
+	 * @param config Parameters of the sequential hypothesis test.
+	 * @throw std::invalid_argument If the parameters do not form a valid test.
+	 */
+	explicit ThresholdRandomWalk(const TrwConfig& config);
+
+	/**
+	 * @brief Accounts a connection of the source and evaluates the walk.
+	 *
+	 * Repeated connections to the same target are ignored. When the lower bound is crossed the
+	 * state is reset, so the source remains monitored.
+	 *
+	 * @param state State of the source.
+	 * @param target Destination of the connection.
+	 * @param tcpFlags Cumulative TCP flags of the flow.
+	 * @return Decision after the update.
+	 */
+	TrwDecision update(TrwState& state, const ip_addr_t& target, uint8_t tcpFlags) const noexcept;
+
+private:
+	static void validate(const TrwConfig& config);
+	static bool markFirstContact(TrwState& state, const ip_addr_t& target) noexcept;
+
+	float m_successStep;
+	float m_failureStep;
+	float m_upperBound;
+	float m_lowerBound;
+};
+
+} // namespace ScanDetector
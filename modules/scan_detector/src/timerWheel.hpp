@@ -0,0 +1,219 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Hierarchical timer wheel
+ *
+ * Timer wheel with four levels of 64 slots. Scheduling and expiration are amortized O(1), the
+ * cost of advancing time does not depend on the number of scheduled timers. Timers can not be
+ * cancelled one by one. Every timer gets a unique id, the owner keeps the id of the current
+ * timer of an entry, ignores other timers when they expire and removes them in bulk by
+ * removeIf() when they pile up, e.g. after evictions.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ScanDetector {
+
+/**
+ * @brief Hierarchical timer wheel with tick resolution.
+ *
+ * @tparam Key Type identifying the owner of a timer.
+ */
+template <typename Key>
+class TimerWheel {
+public:
+	/**
+	 * @brief Constructs the wheel.
+	 * @param now Current tick.
+	 */
+	explicit TimerWheel(uint64_t now = 0)
+		: m_currentTick(now)
+	{
+	}
+
+	/**
+	 * @brief Schedules a timer.
+	 *
+	 * Timers scheduled to the current tick or to the past expire on the next tick.
+	 *
+	 * @param key Owner of the timer.
+	 * @param expiresAt Tick at which the timer expires.
+	 * @return Id of the timer, unique within the wheel.
+	 */
+	uint64_t schedule(const Key& key, uint64_t expiresAt)
+	{
+		if (expiresAt <= m_currentTick) {
+			expiresAt = m_currentTick + 1;
+		}
+		const uint64_t id = ++m_lastId;
+		place({key, expiresAt, id});
+		m_size++;
+		return id;
+	}
+
+	/**
+	 * @brief Removes the timers for which `isStale(key, id)` returns true.
+	 *
+	 * The cost is linear in the number of scheduled timers.
+	 */
+	template <typename Predicate>
+	void removeIf(Predicate&& isStale)
+	{
+		for (auto& level : m_levels) {
+			for (auto& slot : level) {
+				const auto end = std::remove_if(slot.begin(), slot.end(), [&](const Timer& timer) {
+					return isStale(timer.key, timer.id);
+				});
+				m_size -= static_cast<std::size_t>(slot.end() - end);
+				slot.erase(end, slot.end());
+			}
+		}
+	}
+
+	/**
+	 * @brief Advances the wheel and expires timers.
+	 *
+	 * The callback is called as `onExpire(key, id)` and may schedule new timers.
+	 *
+	 * @param now Current tick.
+	 * @param onExpire Callback invoked for every expired timer.
+	 */
+	template <typename Callback>
+	void advance(uint64_t now, Callback&& onExpire)
+	{
+		if (m_size == 0 && now > m_currentTick) {
+			m_currentTick = now;
+			return;
+		}
+
+		while (m_currentTick < now) {
+			m_currentTick++;
+			cascade();
+			expireCurrentSlot(onExpire);
+		}
+	}
+
+	/**
+	 * @brief Returns the number of scheduled timers.
+	 */
+	std::size_t size() const noexcept { return m_size; }
+
+	/**
+	 * @brief Returns the current tick.
+	 */
+	uint64_t now() const noexcept { return m_currentTick; }
+
+private:
+	static constexpr unsigned SLOT_BITS = 6;
+	static constexpr std::size_t SLOTS = 1U << SLOT_BITS;
+	static constexpr std::size_t SLOT_MASK = SLOTS - 1;
+	static constexpr std::size_t LEVELS = 4;
+
+	struct Timer {
+		Key key;
+		uint64_t expiresAt;
+		uint64_t id;
+	};
+
+	using Slot = std::vector<Timer>;
+
+	void place(Timer&& timer)
+	{
+		const uint64_t delta
+			= timer.expiresAt > m_currentTick ? timer.expiresAt - m_currentTick : 0;
+		const uint64_t tick = timer.expiresAt > m_currentTick ? timer.expiresAt : m_currentTick;
+
+		std::size_t level = 0;
+		while (level + 1 < LEVELS && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+			level++;
+		}
+
+		const std::size_t slot = (tick >> (SLOT_BITS * level)) & SLOT_MASK;
+		m_levels[level][slot].emplace_back(std::move(timer));
+	}
+
+	void cascade()
+	{
+		for (std::size_t level = LEVELS - 1; level > 0; level--) {
+			const uint64_t levelMask = (uint64_t(1) << (SLOT_BITS * level)) - 1;
+			if ((m_currentTick & levelMask) != 0) {
+				continue;
+			}
+
+			const std::size_t slot = (m_currentTick >> (SLOT_BITS * level)) & SLOT_MASK;
+			std::swap(m_scratch, m_levels[level][slot]);
+			for (auto& timer : m_scratch) {
+				place(std::move(timer));
+			}
+			m_scratch.clear();
+		}
+	}
+
+	template <typename Callback>
+	void expireCurrentSlot(Callback& onExpire)
+	{
+		std::swap(m_scratch, m_levels[0][m_currentTick & SLOT_MASK]);
+		for (auto& timer : m_scratch) {
+			if (timer.expiresAt > m_currentTick) {
+				// timer beyond the range of the wheel, it goes around once more
+				place(std::move(timer));
+				continue;
+			}
+			m_size--;
+			onExpire(timer.key, timer.id);
+		}
+		m_scratch.clear();
+	}
+
+	std::array<std::array<Slot, SLOTS>, LEVELS> m_levels;
+	Slot m_scratch;
+	uint64_t m_currentTick;
+	uint64_t m_lastId = 0;
+	std::size_t m_size = 0;
+};
+
+/**
+ * @brief Schedules the timer of an entry of a table with a bounded number of entries.
+ *
+ * The entries keep the id of their current timer in a `timer` member, other timers of the key
+ * are stale. Stale timers, e.g. of evicted entries, are removed once the wheel holds more than
+ * twice as many timers as the table can hold entries, so the wheel stays bounded by the
+ * capacity of the table and the removal is amortized over the scheduled timers.
+ *
+ * @param timers Wheel of the timers of the table.
+ * @param table Table of the entries, a StreamSummary.
+ * @param key Key of the entry.
+ * @param expiresAt Tick at which the timer expires.
+ * @return Id of the timer, to be stored in the entry.
+ */
+template <typename Key, typename Table>
+uint64_t scheduleEntryTimer(
+	TimerWheel<Key>& timers,
+	const Table& table,
+	const Key& key,
+	uint64_t expiresAt)
+{
+	const uint64_t id = timers.schedule(key, expiresAt);
+	if (timers.size() > 2 * table.capacity()) {
+		// the entry stores the id only when this returns, the new timer must survive the sweep
+		timers.removeIf([&table, id](const Key& timerKey, uint64_t timer) {
+			if (timer == id) {
+				return false;
+			}
+			const auto* entry = table.find(timerKey);
+			return entry == nullptr || entry->timer != timer;
+		});
+	}
+	return id;
+}
+
+} // namespace ScanDetector
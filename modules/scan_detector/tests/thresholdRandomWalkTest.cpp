@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Tests of the Threshold Random Walk scan detector
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "thresholdRandomWalk.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+#define CHECK(condition)                                                                           \
+	do {                                                                                           \
+		if (!(condition)) {                                                                        \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n";        \
+			return false;                                                                          \
+		}                                                                                          \
+	} while (false)
+
+constexpr uint8_t FIN = 0x01;
+constexpr uint8_t SYN = 0x02;
+constexpr uint8_t RST = 0x04;
+constexpr uint8_t PSH = 0x08;
+constexpr uint8_t ACK = 0x10;
+constexpr uint8_t URG = 0x20;
+
+using ScanDetector::ConnectionOutcome;
+using ScanDetector::TrwDecision;
+
+bool testClassifiesProbes()
+{
+	CHECK(ScanDetector::classifyConnection(0) == ConnectionOutcome::Unknown);
+	CHECK(ScanDetector::classifyConnection(SYN) == ConnectionOutcome::Failure);
+	CHECK(ScanDetector::classifyConnection(RST) == ConnectionOutcome::Failure);
+	CHECK(ScanDetector::classifyConnection(SYN | RST) == ConnectionOutcome::Failure);
+	CHECK(ScanDetector::classifyConnection(FIN) == ConnectionOutcome::Failure);
+	CHECK(ScanDetector::classifyConnection(FIN | PSH | URG) == ConnectionOutcome::Failure);
+	CHECK(ScanDetector::classifyConnection(PSH | URG) == ConnectionOutcome::Unknown);
+	CHECK(ScanDetector::classifyConnection(SYN | ACK) == ConnectionOutcome::Success);
+	CHECK(ScanDetector::classifyConnection(ACK | RST) == ConnectionOutcome::Success);
+	CHECK(ScanDetector::classifyConnection(SYN | ACK | FIN | PSH) == ConnectionOutcome::Success);
+	return true;
+}
+
+bool testClassifiesEveryCombination()
+{
+	for (unsigned flags = 0; flags <= 0xFF; flags++) {
+		ConnectionOutcome expected = ConnectionOutcome::Unknown;
+		if ((flags & ACK) != 0) {
+			expected = ConnectionOutcome::Success;
+		} else if ((flags & (SYN | RST | FIN)) != 0) {
+			expected = ConnectionOutcome::Failure;
+		}
+		CHECK(ScanDetector::classifyConnection(static_cast<uint8_t>(flags)) == expected);
+	}
+	return true;
+}
+
+bool testDetectsScanner()
+{
+	const ScanDetector::ThresholdRandomWalk trw;
+	ScanDetector::TrwState state;
+
+	TrwDecision decision = TrwDecision::Pending;
+	uint32_t target = 0x0A000001;
+	while (decision == TrwDecision::Pending && state.observations < 100) {
+		decision = trw.update(state, ip_from_int(target++), SYN);
+	}
+	CHECK(decision == TrwDecision::Scanner);
+	// with the default parameters four failures cross the upper bound
+	CHECK(state.observations == 4);
+	return true;
+}
+
+bool testIgnoresRepeatedTargetsAndUnknownFlows()
+{
+	const ScanDetector::ThresholdRandomWalk trw;
+	ScanDetector::TrwState state;
+
+	for (int attempt = 0; attempt < 100; attempt++) {
+		CHECK(trw.update(state, ip_from_int(0x0A000001), SYN) == TrwDecision::Pending);
+		CHECK(trw.update(state, ip_from_int(0x0A000100 + attempt), 0) == TrwDecision::Pending);
+	}
+	CHECK(state.observations == 1);
+	return true;
+}
+
+bool testRestartsBenignWalk()
+{
+	const ScanDetector::ThresholdRandomWalk trw;
+	ScanDetector::TrwState state;
+
+	TrwDecision decision = TrwDecision::Pending;
+	uint32_t target = 0x0A000001;
+	while (decision == TrwDecision::Pending && state.observations < 100) {
+		decision = trw.update(state, ip_from_int(target++), SYN | ACK);
+	}
+	CHECK(decision == TrwDecision::Benign);
+	CHECK(state.observations == 0);
+	CHECK(state.logLikelihoodRatio == 0);
+	return true;
+}
+
+} // namespace
+
+int main()
+{
+	bool passed = true;
+	passed &= testClassifiesProbes();
+	passed &= testClassifiesEveryCombination();
+	passed &= testDetectsScanner();
+	passed &= testIgnoresRepeatedTargetsAndUnknownFlows();
+	passed &= testRestartsBenignWalk();
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
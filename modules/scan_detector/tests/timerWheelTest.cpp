@@ -0,0 +1,105 @@
+/**
+ * @file
+ * @author Michal Matejka <xmatejm00@stud.fit.vutbr.cz>
+ * @brief Tests of the timer wheel and of the timers of bounded tables
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "streamSummary.hpp"
+#include "timerWheel.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+namespace {
+
+#define CHECK(condition)                                                                           \
+	do {                                                                                           \
+		if (!(condition)) {                                                                        \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n";        \
+			return false;                                                                          \
+		}                                                                                          \
+	} while (false)
+
+struct Entry {
+	uint64_t timer = 0;
+};
+
+using Table = ScanDetector::StreamSummary<uint32_t, Entry>;
+
+bool testExpiresInOrder()
+{
+	ScanDetector::TimerWheel<uint32_t> timers;
+	timers.schedule(1, 5);
+	timers.schedule(2, 70);
+	timers.schedule(3, 5000);
+
+	std::map<uint32_t, uint64_t> expiredAt;
+	auto onExpire = [&](uint32_t key, uint64_t) { expiredAt[key] = timers.now(); };
+	timers.advance(10'000, onExpire);
+
+	CHECK(timers.size() == 0);
+	CHECK(expiredAt[1] == 5);
+	CHECK(expiredAt[2] == 70);
+	CHECK(expiredAt[3] == 5000);
+	return true;
+}
+
+bool testSweepKeepsNewTimer()
+{
+	constexpr size_t CAPACITY = 2;
+	Table table(CAPACITY);
+	ScanDetector::TimerWheel<uint32_t> timers;
+
+	// rescheduling leaves stale timers of the key in the wheel
+	Entry* first = table.increment(1).first;
+	for (uint64_t expiresAt = 10; expiresAt < 10 + 2 * CAPACITY; expiresAt++) {
+		first->timer = ScanDetector::scheduleEntryTimer(timers, table, uint32_t(1), expiresAt);
+	}
+
+	// the timer of the new entry exceeds the bound and sweeps the wheel before it is stored
+	Entry* second = table.increment(2).first;
+	second->timer = ScanDetector::scheduleEntryTimer(timers, table, uint32_t(2), 20);
+	CHECK(timers.size() == 2);
+
+	std::map<uint32_t, uint64_t> expired;
+	timers.advance(100, [&](uint32_t key, uint64_t timer) {
+		const Entry* entry = table.find(key);
+		if (entry != nullptr && entry->timer == timer) {
+			expired[key] = timers.now();
+		}
+	});
+
+	CHECK(expired.count(1) == 1);
+	CHECK(expired.count(2) == 1);
+	CHECK(expired[2] == 20);
+	return true;
+}
+
+bool testSweepRemovesEvictedTimers()
+{
+	constexpr size_t CAPACITY = 4;
+	Table table(CAPACITY);
+	ScanDetector::TimerWheel<uint32_t> timers;
+
+	for (uint32_t key = 0; key < 1000; key++) {
+		Entry* entry = table.increment(key).first;
+		entry->timer = ScanDetector::scheduleEntryTimer(timers, table, key, 1000 + key);
+		CHECK(timers.size() <= 2 * CAPACITY + 1);
+	}
+	return true;
+}
+
+} // namespace
+
+int main()
+{
+	bool passed = true;
+	passed &= testExpiresInOrder();
+	passed &= testSweepKeepsNewTimer();
+	passed &= testSweepRemovesEvictedTimers();
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
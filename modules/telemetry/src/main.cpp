@@ -10,8 +10,10 @@
  */
 
 #include "factory/pluginFactory.hpp"
+#include "instrumentation/instrumentation.hpp"
 #include "logger/logger.hpp"
 #include "outputPlugin.hpp"
+#include "unirec/record-loop.hpp"
 #include "unirec/unirec-telemetry.hpp"
 
 #include <appFs.hpp>
@@ -37,54 +39,40 @@ void signalHandler(int signum)
 }
 
 /**
- * @brief Handle a format change exception by adjusting the template.
- *
- * This function is called when a `FormatChangeException` is caught in the main loop.
- * It adjusts the template in the bidirectional interface to handle the format change.
- *
- * @param biInterface Bidirectional interface for Unirec communication.
+ * @brief Handler of the received records forwarding them unchanged.
  */
-void handleFormatChange(UnirecBidirectionalInterface& biInterface)
-{
-	biInterface.changeTemplate();
-}
+class ForwardHandler : public Nm::RecordHandler {
+public:
+	explicit ForwardHandler(UnirecBidirectionalInterface& biInterface)
+		: m_biInterface(biInterface)
+	{
+	}
 
-/**
- * @brief Forward unirec record from input to output interface.
- *
- * @param biInterface Bidirectional interface for Unirec communication.
- */
-void processNextRecord(UnirecBidirectionalInterface& biInterface)
-{
-	std::optional<UnirecRecordView> unirecRecord = biInterface.receive();
-	if (!unirecRecord) {
-		return;
+	void processRecord(UnirecRecordView& unirecRecord)
+	{
+		const Nm::ScopedTimer sendTimer(Nm::g_sendProbe);
+		m_biInterface.send(unirecRecord);
 	}
-	biInterface.send(*unirecRecord);
-}
+
+	void changeTemplate() { m_biInterface.changeTemplate(); }
+
+private:
+	UnirecBidirectionalInterface& m_biInterface;
+};
 
 /**
  * @brief Process Unirec records.
  *
- * The `processUnirecRecords` function continuously receives Unirec records through the provided
- * bidirectional interface (`biInterface`). Each received record is simply forwarded to the
- * output interface.
+ * The `processUnirecRecords` function continuously receives Unirec records one at a time through
+ * the provided bidirectional interface (`biInterface`). Each received record is simply
+ * forwarded to the output interface.
  *
  * @param biInterface Bidirectional interface for Unirec communication.
  */
 void processUnirecRecords(UnirecBidirectionalInterface& biInterface)
 {
-	while (!g_stopFlag.load()) {
-		try {
-			processNextRecord(biInterface);
-		} catch (FormatChangeException& ex) {
-			handleFormatChange(biInterface);
-		} catch (EoFException& ex) {
-			break;
-		} catch (std::exception& ex) {
-			throw;
-		}
-	}
+	ForwardHandler handler(biInterface);
+	Nm::processRecords(biInterface, handler, g_stopFlag);
 }
 
 std::pair<std::string, std::string> splitPluginParams(const std::string& pluginParams)
@@ -161,6 +149,7 @@ int main(int argc, char** argv)
 		const telemetry::FileOps inputFileOps
 			= {[&biInterface]() { return Nm::getInterfaceTelemetry(biInterface); }, nullptr};
 		const auto inputFile = telemetryInputDirectory->addFile("stats", inputFileOps);
+		Nm::Instrumentation::setTelemetryDirectory(telemetryRootDirectory);
 
 		std::unique_ptr<TelemetryStats::OutputPlugin> outputPlugin;
 
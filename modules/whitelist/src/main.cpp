@@ -13,7 +13,9 @@
  */
 
 #include "csvConfigParser.hpp"
+#include "instrumentation/instrumentation.hpp"
 #include "logger/logger.hpp"
+#include "unirec/record-loop.hpp"
 #include "unirec/unirec-telemetry.hpp"
 #include "whitelist.hpp"
 
@@ -37,46 +39,50 @@ void signalHandler(int signum)
 }
 
 /**
- * @brief Handle a format change exception by adjusting the template.
+ * @brief Handler of the received records checking them against the whitelist.
  *
- * This function is called when a `FormatChangeException` is caught in the main loop.
- * It adjusts the template in the bidirectional interface to handle the format change.
- *
- * @param biInterface Bidirectional interface for Unirec communication.
+ * Records that are not whitelisted are forwarded through the bidirectional interface. On a
+ * format change, the template of the bidirectional interface is adjusted. The statistics of the
+ * rules are published also when the input is idle or ends.
  */
-static void handleFormatChange(UnirecBidirectionalInterface& biInterface)
-{
-	biInterface.changeTemplate();
-}
+class WhitelistHandler : public Nm::RecordHandler {
+public:
+	WhitelistHandler(UnirecBidirectionalInterface& biInterface, Whitelist::Whitelist& whitelist)
+		: m_biInterface(biInterface)
+		, m_whitelist(whitelist)
+	{
+	}
 
-/**
- * @brief Process the next Unirec record and forward if not whitelisted.
- *
- * This function receives the next Unirec record through the bidirectional interface.
- * If the record is not whitelisted, it is forwarded using the same interface.
- *
- * @param biInterface Bidirectional interface for Unirec communication.
- * @param whitelist Whitelist instance for checking Unirec records.
- */
-static void
-processNextRecord(UnirecBidirectionalInterface& biInterface, Whitelist::Whitelist& whitelist)
-{
-	std::optional<UnirecRecordView> unirecRecord = biInterface.receive();
-	if (!unirecRecord) {
-		return;
+	void processRecord(UnirecRecordView& unirecRecord)
+	{
+		if (!m_whitelist.isWhitelisted(unirecRecord)) {
+			const Nm::ScopedTimer sendTimer(Nm::g_sendProbe);
+			m_biInterface.send(unirecRecord);
+		}
 	}
 
-	if (!whitelist.isWhitelisted(*unirecRecord)) {
-		biInterface.send(*unirecRecord);
+	void changeTemplate() { m_biInterface.changeTemplate(); }
+
+	void endRound(bool idle)
+	{
+		if (idle) {
+			m_whitelist.publishStats();
+		}
 	}
-}
+
+	void endOfInput() { m_whitelist.publishStats(); }
+
+private:
+	UnirecBidirectionalInterface& m_biInterface;
+	Whitelist::Whitelist& m_whitelist;
+};
 
 /**
  * @brief Process Unirec records based on the whitelist.
  *
- * The `processUnirecRecords` function continuously receives Unirec records through the provided
- * bidirectional interface (`biInterface`). Each received record is checked against the
- * specified whitelist. If the record is not whitelisted, it is forwarded using the
+ * The `processUnirecRecords` function continuously receives Unirec records one at a time through
+ * the provided bidirectional interface (`biInterface`). Each received record is checked against
+ * the specified whitelist. If the record is not whitelisted, it is forwarded using the
  * bidirectional interface. The loop runs indefinitely until an end-of-file condition
  * is encountered.
  *
@@ -86,17 +92,8 @@ processNextRecord(UnirecBidirectionalInterface& biInterface, Whitelist::Whitelis
 static void
 processUnirecRecords(UnirecBidirectionalInterface& biInterface, Whitelist::Whitelist& whitelist)
 {
-	while (!g_stopFlag.load()) {
-		try {
-			processNextRecord(biInterface, whitelist);
-		} catch (FormatChangeException& ex) {
-			handleFormatChange(biInterface);
-		} catch (EoFException& ex) {
-			break;
-		} catch (std::exception& ex) {
-			throw;
-		}
-	}
+	WhitelistHandler handler(biInterface, whitelist);
+	Nm::processRecords(biInterface, handler, g_stopFlag);
 }
 
 int main(int argc, char** argv)
@@ -177,6 +174,7 @@ int main(int argc, char** argv)
 		const telemetry::FileOps inputFileOps
 			= {[&biInterface]() { return Nm::getInterfaceTelemetry(biInterface); }, nullptr};
 		const auto inputFile = telemetryInputDirectory->addFile("stats", inputFileOps);
+		Nm::Instrumentation::setTelemetryDirectory(telemetryRootDirectory);
 
 		Whitelist::Whitelist whitelist(whitelistConfigParser.get());
 		auto telemetryWhitelistDirectory = telemetryRootDirectory->addDir("whitelist");
@@ -24,7 +24,7 @@ namespace Whitelist {
 
 static telemetry::Content createWhitelistRuleTelemetryContent(const WhitelistRule& rule)
 {
-	const RuleStats& ruleStats = rule.getStats();
+	const RuleStats ruleStats = rule.getStats();
 	telemetry::Dict dict;
 	dict["matchedCount"] = telemetry::Scalar(ruleStats.matchedCount);
 	return dict;
@@ -37,8 +37,7 @@ Whitelist::Whitelist(const ConfigParser* configParser)
 	WhitelistRuleBuilder whitelistRuleBuilder(unirecTemplateDescription);
 
 	for (const auto& ruleDescription : configParser->getWhitelistRulesDescription()) {
-		auto rule = whitelistRuleBuilder.build(ruleDescription);
-		m_whitelistRules.emplace_back(rule);
+		m_whitelistRules.emplace_back(whitelistRuleBuilder.build(ruleDescription));
 	}
 }
 
@@ -47,7 +46,20 @@ bool Whitelist::isWhitelisted(const Nemea::UnirecRecordView& unirecRecordView)
 	auto lambdaPredicate
 		= [&](auto& whitelistRule) { return !whitelistRule.isMatched(unirecRecordView); };
 
-	return std::any_of(m_whitelistRules.begin(), m_whitelistRules.end(), lambdaPredicate);
+	const bool whitelisted
+		= std::any_of(m_whitelistRules.begin(), m_whitelistRules.end(), lambdaPredicate);
+	if (--m_recordsUntilPublish == 0) {
+		publishStats();
+	}
+	return whitelisted;
+}
+
+void Whitelist::publishStats() noexcept
+{
+	for (auto& whitelistRule : m_whitelistRules) {
+		whitelistRule.publishStats();
+	}
+	m_recordsUntilPublish = PUBLISH_INTERVAL;
 }
 
 void Whitelist::setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory)
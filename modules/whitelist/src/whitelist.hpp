@@ -37,6 +37,14 @@ public:
 	 */
 	bool isWhitelisted(const Nemea::UnirecRecordView& unirecRecordView);
 
+	/**
+	 * @brief Publishes the statistics of the rules to the telemetry.
+	 *
+	 * The statistics are published every 256 records, the owner of the whitelist publishes them
+	 * also when the input is idle or ends.
+	 */
+	void publishStats() noexcept;
+
 	/**
 	 * @brief Sets the telemetry directory for the whitelist.
 	 * @param directory directory for whitelist telemetry.
@@ -44,8 +52,11 @@ public:
 	void setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory);
 
 private:
+	static constexpr uint64_t PUBLISH_INTERVAL = 256;
+
 	telemetry::Holder m_holder;
 	std::vector<WhitelistRule> m_whitelistRules;
+	uint64_t m_recordsUntilPublish = PUBLISH_INTERVAL;
 };
 
 } // namespace Whitelist
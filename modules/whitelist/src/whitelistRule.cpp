@@ -88,7 +88,7 @@ isRuleFieldMatched(const RuleField& ruleField, const Nemea::UnirecRecordView& un
 
 WhitelistRule::WhitelistRule(const std::vector<RuleField>& ruleFields)
 	: m_ruleFields(ruleFields)
-	, m_stats()
+	, m_stats(std::make_unique<Nm::CounterBlock<RuleStats>>())
 {
 }
 
@@ -100,15 +100,20 @@ bool WhitelistRule::isMatched(const Nemea::UnirecRecordView& unirecRecordView)
 	const bool isMatched = std::any_of(m_ruleFields.begin(), m_ruleFields.end(), lambdaPredicate);
 
 	if (!isMatched) {
-		m_stats.matchedCount++;
+		m_stats->local().matchedCount++;
 	}
 
 	return isMatched;
 }
 
-const RuleStats& WhitelistRule::getStats() const noexcept
+void WhitelistRule::publishStats() noexcept
 {
-	return m_stats;
+	m_stats->publish();
+}
+
+RuleStats WhitelistRule::getStats() const noexcept
+{
+	return m_stats->snapshot();
 }
 
 } // namespace Whitelist
@@ -9,9 +9,11 @@
 
 #pragma once
 
+#include "counters/counterBlock.hpp"
 #include "ipAddressPrefix.hpp"
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <regex>
 #include <unirec++/unirec.hpp>
@@ -25,7 +27,7 @@ namespace Whitelist {
  * @brief Stores statistics about a whitelist rule.
  */
 struct RuleStats {
-	uint64_t matchedCount; /**< Number of times the rule has been matched. */
+	uint64_t matchedCount = 0; /**< Number of times the rule has been matched. */
 };
 
 /**
@@ -68,14 +70,21 @@ public:
 	bool isMatched(const Nemea::UnirecRecordView& unirecRecordView);
 
 	/**
-	 * @brief Gets the statistics for this rule.
-	 * @return A constant reference to the RuleStats structure.
+	 * @brief Publishes the statistics to getStats(), must be called by the thread matching the
+	 * records.
 	 */
-	const RuleStats& getStats() const noexcept;
+	void publishStats() noexcept;
+
+	/**
+	 * @brief Gets the last published statistics for this rule, can be called by any thread.
+	 * @return A copy of the RuleStats structure.
+	 */
+	RuleStats getStats() const noexcept;
 
 private:
 	const std::vector<RuleField> m_ruleFields;
-	RuleStats m_stats;
+	// the counter block can be neither copied nor moved, the rules are moved into the whitelist
+	std::unique_ptr<Nm::CounterBlock<RuleStats>> m_stats;
 };
 
 } // namespace Whitelist
@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Implementation of the WhitelistStage class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "whitelistStage.hpp"
+
+#include "csvConfigParser.hpp"
+#include "factory/pluginFactoryRegistrator.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace Whitelist {
+
+WhitelistStage::WhitelistStage(const std::string& params)
+{
+	auto paramsMap = parseParams(params);
+	if (paramsMap.size() != 1 || paramsMap.count("file") == 0) {
+		throw std::runtime_error("WhitelistStage: exactly the file parameter is expected");
+	}
+
+	m_configParser = std::make_unique<CsvConfigParser>(paramsMap["file"]);
+
+	// the rules resolve the field ids on construction, before the chain sets the required
+	// format of its input
+	const std::string templateDescription = m_configParser->getUnirecTemplateDescription();
+	if (ur_define_set_fields(templateDescription.c_str()) != UR_OK) {
+		throw std::runtime_error(
+			"WhitelistStage: cannot define the fields '" + templateDescription + "'");
+	}
+
+	m_whitelist = std::make_unique<Whitelist>(m_configParser.get());
+}
+
+std::string WhitelistStage::getRequiredFormat() const
+{
+	return m_configParser->getUnirecTemplateDescription();
+}
+
+void WhitelistStage::setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory)
+{
+	m_whitelist->setTelemetryDirectory(directory);
+}
+
+static void whitelistStageUsage()
+{
+	std::cout << "whitelist\n";
+	std::cout << "  Usage: whitelist:file=PATH\n";
+	std::cout << "  Parameters:\n";
+	std::cout << "    file  Whitelist rules in CSV format, matching records are dropped. "
+				 "[required]\n";
+}
+
+static Nm::PluginManifest g_whitelistStageManifest {
+	"whitelist",
+	"Drops records matching the whitelist rules.",
+	"1.0.0",
+	whitelistStageUsage,
+};
+
+static Nm::PluginFactoryRegistrator<Nm::Stage, WhitelistStage>
+	g_whitelistStageRegistration(g_whitelistStageManifest);
+
+} // namespace Whitelist
@@ -0,0 +1,55 @@
+/**
+ * @file
+ * @author Pavel Siska <siska@cesnet.cz>
+ * @brief Declaration of the WhitelistStage class.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "configParser.hpp"
+#include "stage/stage.hpp"
+#include "whitelist.hpp"
+
+#include <memory>
+#include <string>
+
+namespace Whitelist {
+
+/**
+ * @brief Stage of a chain dropping the whitelisted records.
+ *
+ * Parameters: `file=PATH` of the CSV whitelist.
+ */
+class WhitelistStage : public Nm::Stage {
+public:
+	/**
+	 * @brief Loads the whitelist and defines the Unirec fields it uses.
+	 * @param params Parameters of the stage.
+	 * @throw std::runtime_error If the parameters or the whitelist are invalid.
+	 */
+	explicit WhitelistStage(const std::string& params);
+
+	std::string getRequiredFormat() const override;
+
+	bool processRecord(const Nemea::UnirecRecordView& unirecRecordView) override
+	{
+		return !m_whitelist->isWhitelisted(unirecRecordView);
+	}
+
+	void endRound(bool idle) override
+	{
+		if (idle) {
+			m_whitelist->publishStats();
+		}
+	}
+
+	void setTelemetryDirectory(const std::shared_ptr<telemetry::Directory>& directory) override;
+
+private:
+	std::unique_ptr<ConfigParser> m_configParser;
+	std::unique_ptr<Whitelist> m_whitelist;
+};
+
+} // namespace Whitelist